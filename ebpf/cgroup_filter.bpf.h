@@ -0,0 +1,81 @@
+#ifndef __CGROUP_FILTER_BPF_H
+#define __CGROUP_FILTER_BPF_H
+
+// Cgroup-scoped event filtering shared by all monitors.
+// BpfLoader creates both maps once and reuses them in every object, so all
+// probes see the same state, which CgroupFilter seeds and keeps current.
+
+#define CGROUP_FILTER_MAX_ENTRIES 16384
+
+#define CGROUP_VERDICT_ALLOW 1
+#define CGROUP_VERDICT_DENY 2
+
+#define CGROUP_FILTER_MODE_OFF 0
+#define CGROUP_FILTER_MODE_ALLOWLIST 1
+#define CGROUP_FILTER_MODE_DENYLIST 2
+
+struct cgroup_filter_config
+{
+    __u32 mode;
+    __u32 self_tgid;
+};
+
+// cgroup id -> verdict
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, CGROUP_FILTER_MAX_ENTRIES);
+    __type(key, __u64);
+    __type(value, __u8);
+} cgroup_filter SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct cgroup_filter_config);
+} cgroup_filter_config SEC(".maps");
+
+static __always_inline int cgroup_verdict_allowed(const struct cgroup_filter_config *cfg, __u64 cgroup_id)
+{
+    __u8 *verdict = bpf_map_lookup_elem(&cgroup_filter, &cgroup_id);
+    if (verdict && *verdict == CGROUP_VERDICT_DENY)
+        return 0;
+
+    if (cfg->mode == CGROUP_FILTER_MODE_ALLOWLIST)
+        return verdict && *verdict == CGROUP_VERDICT_ALLOW;
+
+    return 1;
+}
+
+// Returns non-zero when the current task should be traced
+static __always_inline int cgroup_event_allowed(void)
+{
+    __u32 zero = 0;
+    struct cgroup_filter_config *cfg = bpf_map_lookup_elem(&cgroup_filter_config, &zero);
+    if (!cfg || cfg->mode == CGROUP_FILTER_MODE_OFF)
+        return 1;
+
+    // Never trace the agent itself
+    if (cfg->self_tgid && (bpf_get_current_pid_tgid() >> 32) == cfg->self_tgid)
+        return 0;
+
+    return cgroup_verdict_allowed(cfg, bpf_get_current_cgroup_id());
+}
+
+// Same for another task, e.g. one being woken up, given its cgroup and tgid
+static __always_inline int cgroup_task_allowed(__u64 cgroup_id, __u32 tgid)
+{
+    __u32 zero = 0;
+    struct cgroup_filter_config *cfg = bpf_map_lookup_elem(&cgroup_filter_config, &zero);
+    if (!cfg || cfg->mode == CGROUP_FILTER_MODE_OFF)
+        return 1;
+
+    if (cfg->self_tgid && tgid == cfg->self_tgid)
+        return 0;
+
+    return cgroup_verdict_allowed(cfg, cgroup_id);
+}
+
+#endif /* __CGROUP_FILTER_BPF_H */
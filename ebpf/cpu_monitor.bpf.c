@@ -2,6 +2,8 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_tracing.h>
 #include <bpf/bpf_core_read.h>
+#include "cgroup_filter.bpf.h"
+#include "ringbuf_wakeup.bpf.h"
 
 char __license[] SEC("license") = "GPL";
 
@@ -62,6 +64,10 @@ int BPF_PROG(trace_sched_switch, bool preempt, struct task_struct *prev, struct
     if (prev_tgid == 0)
         return 0;
 
+    // prev is still current here, so its cgroup is the current one
+    if (!cgroup_event_allowed())
+        return 0;
+
     __u64 *prev_runtime_ptr = bpf_map_lookup_elem(&prev_task_runtime, &prev_pid);
     __u64 current_runtime = get_task_runtime(prev);
 
@@ -85,7 +91,7 @@ int BPF_PROG(trace_sched_switch, bool preempt, struct task_struct *prev, struct
     event->cpu_id = bpf_get_smp_processor_id();
     bpf_get_current_comm(&event->comm, sizeof(event->comm));
 
-    bpf_ringbuf_submit(event, 0);
+    bpf_ringbuf_submit(event, ringbuf_submit_flags(&cpu_rb));
 
     return 0;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <linux/bpf.h>
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_tracing.h>
+#include "cgroup_filter.bpf.h"
+#include "ringbuf_wakeup.bpf.h"
 
 struct
 {
@@ -22,6 +24,9 @@ int hello_ring_buffer(void *ctx)
 {
     struct data_t *data;
 
+    if (!cgroup_event_allowed())
+        return 0;
+
     // reserva espaço no ringbuf
     data = bpf_ringbuf_reserve(&output, sizeof(*data), 0);
     if (!data)
@@ -34,7 +39,7 @@ int hello_ring_buffer(void *ctx)
     __builtin_memcpy(&data->message, "Hello World", sizeof(data->message));
 
     // publica no ringbuf
-    bpf_ringbuf_submit(data, 0);
+    bpf_ringbuf_submit(data, ringbuf_submit_flags(&output));
     return 0;
 }
 
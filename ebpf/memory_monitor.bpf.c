@@ -1,9 +1,16 @@
 #include "vmlinux.h"
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_tracing.h>
+#include "cgroup_filter.bpf.h"
+#include "ringbuf_wakeup.bpf.h"
 
 char __license[] SEC("license") = "GPL";
 
+// Same values as in RingBufReaderK8s.hpp
+#define EVENT_MEMORY_ALLOC 2
+#define EVENT_MEMORY_FREE 3
+
+// Layout shared with user space (RingBufReaderK8s.hpp)
 struct memory_event
 {
     __u32 pid;
@@ -11,7 +18,8 @@ struct memory_event
     __u64 timestamp;
     char comm[16];
     __u64 rss_kb;
-    __u64 swap_kb;
+    __u64 cache_kb;
+    __u32 event_type;
 };
 
 struct
@@ -24,13 +32,17 @@ struct
 SEC("tracepoint/kmem/mm_page_alloc")
 int trace_mm_page_alloc(struct trace_event_raw_mm_page_alloc *args)
 {
-    __u32 pid = bpf_get_current_pid_tgid() >> 32;
-    __u32 tgid = (__u32)bpf_get_current_pid_tgid();
+    __u64 pid_tgid = bpf_get_current_pid_tgid();
+    __u32 pid = (__u32)pid_tgid;
+    __u32 tgid = pid_tgid >> 32;
 
     // Skip kernel threads
     if (tgid == 0)
         return 0;
 
+    if (!cgroup_event_allowed())
+        return 0;
+
     struct memory_event *event = bpf_ringbuf_reserve(&memory_rb, sizeof(*event), 0);
     if (!event)
         return 0;
@@ -43,9 +55,10 @@ int trace_mm_page_alloc(struct trace_event_raw_mm_page_alloc *args)
     // Calculate memory allocated (order is log2 of number of pages)
     // Each page is typically 4KB
     event->rss_kb = (1 << args->order) * 4;
-    event->swap_kb = 0;
+    event->cache_kb = 0;
+    event->event_type = EVENT_MEMORY_ALLOC;
 
-    bpf_ringbuf_submit(event, 0);
+    bpf_ringbuf_submit(event, ringbuf_submit_flags(&memory_rb));
     return 0;
 }
 
@@ -53,12 +66,16 @@ int trace_mm_page_alloc(struct trace_event_raw_mm_page_alloc *args)
 SEC("tracepoint/kmem/mm_page_free")
 int trace_mm_page_free(struct trace_event_raw_mm_page_free *args)
 {
-    __u32 pid = bpf_get_current_pid_tgid() >> 32;
-    __u32 tgid = (__u32)bpf_get_current_pid_tgid();
+    __u64 pid_tgid = bpf_get_current_pid_tgid();
+    __u32 pid = (__u32)pid_tgid;
+    __u32 tgid = pid_tgid >> 32;
 
     if (tgid == 0)
         return 0;
 
+    if (!cgroup_event_allowed())
+        return 0;
+
     struct memory_event *event = bpf_ringbuf_reserve(&memory_rb, sizeof(*event), 0);
     if (!event)
         return 0;
@@ -70,8 +87,9 @@ int trace_mm_page_free(struct trace_event_raw_mm_page_free *args)
 
     // Calculate memory freed
     event->rss_kb = (1 << args->order) * 4;
-    event->swap_kb = 0;
+    event->cache_kb = 0;
+    event->event_type = EVENT_MEMORY_FREE;
 
-    bpf_ringbuf_submit(event, 0);
+    bpf_ringbuf_submit(event, ringbuf_submit_flags(&memory_rb));
     return 0;
 }
\ No newline at end of file
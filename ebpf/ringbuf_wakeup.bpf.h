@@ -0,0 +1,20 @@
+#ifndef __RINGBUF_WAKEUP_BPF_H
+#define __RINGBUF_WAKEUP_BPF_H
+
+// Wakeup coalescing for ring buffer submissions.
+// Records are submitted without waking the consumer until the unconsumed
+// data crosses the watermark; user space drains the tail on a timer.
+// Set by BpfLoader before load, 0 wakes the consumer for every record.
+const volatile __u64 ringbuf_wakeup_watermark = 0;
+
+static __always_inline __u64 ringbuf_submit_flags(void *ringbuf)
+{
+    if (!ringbuf_wakeup_watermark)
+        return 0;
+
+    // Includes the record being submitted, reserve already advanced the producer
+    __u64 avail = bpf_ringbuf_query(ringbuf, BPF_RB_AVAIL_DATA);
+    return avail >= ringbuf_wakeup_watermark ? BPF_RB_FORCE_WAKEUP : BPF_RB_NO_WAKEUP;
+}
+
+#endif /* __RINGBUF_WAKEUP_BPF_H */
@@ -0,0 +1,151 @@
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+#include <bpf/bpf_core_read.h>
+#include "cgroup_filter.bpf.h"
+
+char __license[] SEC("license") = "GPL";
+
+// Must match RUNQUEUE_LATENCY_SLOTS in include/RunqueueLatencyReader.hpp
+#define RUNQUEUE_LATENCY_SLOTS 32
+
+#define TASK_RUNNING 0
+
+// Per-CPU values cost 272 bytes x CPUs x entries of locked memory (about 35 MB
+// at 64 CPUs and 2048 entries), so size for pod cgroups rather than the filter.
+// Readers remove idle cgroups every flush.
+#define RUNQUEUE_LATENCY_MAX_CGROUPS 2048
+
+// Run-queue delays of one cgroup, slot i counts delays of [2^i, 2^(i+1)) us (slot 0 from 0)
+struct runqueue_histogram
+{
+    __u64 slots[RUNQUEUE_LATENCY_SLOTS];
+    __u64 count;
+    __u64 sum_ns;
+};
+
+struct runqueue_entry
+{
+    __u64 enqueued_ns;
+    __u64 cgroup_id;
+};
+
+// Tasks waiting for a CPU; LRU so tasks that exit before running cannot fill it
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 10240);
+    __type(key, __u32);
+    __type(value, struct runqueue_entry);
+} runqueue_start SEC(".maps");
+
+// Aggregated in the kernel, read periodically instead of one ring buffer record per switch
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+    __uint(max_entries, RUNQUEUE_LATENCY_MAX_CGROUPS);
+    __type(key, __u64);
+    __type(value, struct runqueue_histogram);
+} runqueue_latency SEC(".maps");
+
+// Kernels before 5.14 name the field state
+struct task_struct___o
+{
+    volatile long int state;
+} __attribute__((preserve_access_index));
+
+static __always_inline long task_state(struct task_struct *task)
+{
+    if (bpf_core_field_exists(task->__state))
+        return BPF_CORE_READ(task, __state);
+    return BPF_CORE_READ((struct task_struct___o *)task, state);
+}
+
+static __always_inline __u64 task_cgroup_id(struct task_struct *task)
+{
+    // cgroup v2 id, as returned by bpf_get_current_cgroup_id() for the current task
+    return BPF_CORE_READ(task, cgroups, dfl_cgrp, kn, id);
+}
+
+static __always_inline __u32 log2_u64(__u64 value)
+{
+    __u32 result = 0;
+
+#pragma unroll
+    for (__u32 shift = 32; shift > 0; shift >>= 1)
+    {
+        if (value >> shift)
+        {
+            value >>= shift;
+            result += shift;
+        }
+    }
+    return result;
+}
+
+static __always_inline void enqueue(struct task_struct *task)
+{
+    __u32 pid = BPF_CORE_READ(task, pid);
+    if (pid == 0)
+        return; // idle
+
+    struct runqueue_entry entry = {
+        .enqueued_ns = bpf_ktime_get_ns(),
+        .cgroup_id = task_cgroup_id(task),
+    };
+    if (!cgroup_task_allowed(entry.cgroup_id, BPF_CORE_READ(task, tgid)))
+        return;
+
+    bpf_map_update_elem(&runqueue_start, &pid, &entry, BPF_ANY);
+}
+
+SEC("tp_btf/sched_wakeup")
+int BPF_PROG(trace_sched_wakeup, struct task_struct *task)
+{
+    enqueue(task);
+    return 0;
+}
+
+SEC("tp_btf/sched_wakeup_new")
+int BPF_PROG(trace_sched_wakeup_new, struct task_struct *task)
+{
+    enqueue(task);
+    return 0;
+}
+
+SEC("tp_btf/sched_switch")
+int BPF_PROG(trace_sched_switch, bool preempt, struct task_struct *prev, struct task_struct *next)
+{
+    // A preempted task goes straight back to the run queue
+    if (task_state(prev) == TASK_RUNNING)
+        enqueue(prev);
+
+    __u32 pid = BPF_CORE_READ(next, pid);
+    struct runqueue_entry *entry = bpf_map_lookup_elem(&runqueue_start, &pid);
+    if (!entry)
+        return 0;
+
+    __u64 now = bpf_ktime_get_ns();
+    __u64 cgroup_id = entry->cgroup_id;
+    __u64 delay_ns = now > entry->enqueued_ns ? now - entry->enqueued_ns : 0;
+    bpf_map_delete_elem(&runqueue_start, &pid);
+
+    struct runqueue_histogram *histogram = bpf_map_lookup_elem(&runqueue_latency, &cgroup_id);
+    if (!histogram)
+    {
+        struct runqueue_histogram zero = {};
+        bpf_map_update_elem(&runqueue_latency, &cgroup_id, &zero, BPF_NOEXIST);
+        histogram = bpf_map_lookup_elem(&runqueue_latency, &cgroup_id);
+        if (!histogram)
+            return 0;
+    }
+
+    // Per-CPU value: plain increments are enough
+    __u32 slot = log2_u64(delay_ns / 1000);
+    if (slot >= RUNQUEUE_LATENCY_SLOTS)
+        slot = RUNQUEUE_LATENCY_SLOTS - 1;
+    histogram->slots[slot]++;
+    histogram->count++;
+    histogram->sum_ns += delay_ns;
+    return 0;
+}
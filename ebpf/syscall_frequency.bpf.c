@@ -1,93 +1,89 @@
 #include <linux/bpf.h>
 #include <bpf/bpf_helpers.h>
+#include "cgroup_filter.bpf.h"
 
+// Highest syscall number (exclusive) that is counted
+#define MAX_SYSCALL_NR 512
+
+#define SYSCALL_COUNTS_CONFIG_PER_CGROUP 0
+
+struct syscall_cgroup_key
+{
+    __u64 cgroup_id;
+    __u32 syscall_id;
+    __u32 pad;
+};
+
+// One counter per syscall number and per CPU, so increments never contend
 struct
 {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
-    __uint(key_size, sizeof(int));
-    __uint(value_size, sizeof(long));
-    __uint(max_entries, 8);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, MAX_SYSCALL_NR);
+    __type(key, __u32);
+    __type(value, __u64);
 } syscall_counts SEC(".maps");
 
-int update_elem(int key)
+// Optional per-cgroup breakdown, enabled through syscall_counts_config.
+// User space deletes keys that stay idle for a sampling interval.
+struct
 {
-    long init_val = 1;
-    long *value = bpf_map_lookup_elem(&syscall_counts, &key);
-    if (value)
-        __sync_fetch_and_add(value, 1);
-    else
-    {
-        bpf_map_update_elem(&syscall_counts, &key, &init_val, BPF_ANY);
-    }
-    return 0;
-}
+    __uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+    __uint(max_entries, 65536);
+    __type(key, struct syscall_cgroup_key);
+    __type(value, __u64);
+} cgroup_syscall_counts SEC(".maps");
 
-// File System Operations (extremely frequent)
-SEC("tracepoint/syscalls/sys_enter_read")
-int trace_sys_enter_read(void *ctx)
+struct
 {
-    int key = 0;
-    update_elem(key);
-    return 0;
-}
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, __u32);
+} syscall_counts_config SEC(".maps");
 
-SEC("tracepoint/syscalls/sys_enter_write")
-int trace_sys_enter_write(void *ctx)
+static __always_inline void count_per_cgroup(__u32 syscall_id)
 {
-    int key = 1;
-    update_elem(key);
-    return 0;
-}
+    __u32 config_key = SYSCALL_COUNTS_CONFIG_PER_CGROUP;
+    __u32 *per_cgroup = bpf_map_lookup_elem(&syscall_counts_config, &config_key);
+    if (!per_cgroup || !*per_cgroup)
+        return;
 
-SEC("tracepoint/syscalls/sys_enter_openat")
-int trace_sys_enter_openat(void *ctx)
-{
-    int key = 2;
-    update_elem(key);
-    return 0;
-}
+    struct syscall_cgroup_key key = {
+        .cgroup_id = bpf_get_current_cgroup_id(),
+        .syscall_id = syscall_id,
+    };
 
-SEC("tracepoint/syscalls/sys_enter_close")
-int trace_sys_enter_close(void *ctx)
-{
-    int key = 3;
-    update_elem(key);
-    return 0;
+    __u64 *count = bpf_map_lookup_elem(&cgroup_syscall_counts, &key);
+    if (count)
+    {
+        (*count)++;
+    }
+    else
+    {
+        __u64 init_val = 1;
+        bpf_map_update_elem(&cgroup_syscall_counts, &key, &init_val, BPF_NOEXIST);
+    }
 }
 
-// Memory Operations (very frequent)
-SEC("tracepoint/syscalls/sys_enter_mmap")
-int trace_sys_enter_mmap(void *ctx)
+// Single program for every syscall number
+SEC("raw_tp/sys_enter")
+int count_sys_enter(struct bpf_raw_tracepoint_args *ctx)
 {
-    int key = 4;
-    update_elem(key);
-    return 0;
-}
+    // ctx->args[1] contains the syscall number
+    __u32 syscall_id = ctx->args[1];
+    if (syscall_id >= MAX_SYSCALL_NR)
+        return 0;
 
-SEC("tracepoint/syscalls/sys_enter_brk")
-int trace_sys_enter_brk(void *ctx)
-{
-    int key = 5;
-    update_elem(key);
-    return 0;
-}
+    if (!cgroup_event_allowed())
+        return 0;
 
-// Process Operations
-SEC("tracepoint/syscalls/sys_enter_getpid")
-int trace_sys_enter_getpid(void *ctx)
-{
-    int key = 6;
-    update_elem(key);
-    return 0;
-}
+    // Per-CPU slot: a plain increment is enough
+    __u64 *count = bpf_map_lookup_elem(&syscall_counts, &syscall_id);
+    if (count)
+        (*count)++;
 
-// Time Operations
-SEC("tracepoint/syscalls/sys_enter_clock_gettime")
-int trace_sys_enter_clock_gettime(void *ctx)
-{
-    int key = 7;
-    update_elem(key);
+    count_per_cgroup(syscall_id);
     return 0;
 }
 
-char _license[] SEC("license") = "GPL";
\ No newline at end of file
+char _license[] SEC("license") = "GPL";
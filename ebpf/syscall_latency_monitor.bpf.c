@@ -2,6 +2,12 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_tracing.h>
 #include <linux/sched.h>
+#include "cgroup_filter.bpf.h"
+#include "ringbuf_wakeup.bpf.h"
+
+// Highest syscall number (exclusive) that can be selected for tracing
+#define MAX_SYSCALL_NR 512
+#define SYSCALL_FILTER_WORDS (MAX_SYSCALL_NR / 64)
 
 struct syscall_event {
     __u32 pid;
@@ -12,6 +18,11 @@ struct syscall_event {
     int syscall_id;
 };
 
+struct syscall_start {
+    __u64 ts;
+    __u64 syscall_id;
+};
+
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
     __uint(max_entries, 256 * 1024);
@@ -21,9 +32,18 @@ struct {
     __uint(type, BPF_MAP_TYPE_HASH);
     __uint(max_entries, 10240);
     __type(key, __u32);
-    __type(value, __u64);
+    __type(value, struct syscall_start);
 } start_times SEC(".maps");
 
+// Bitmap of syscalls to trace, populated from user space.
+// Bit (nr % 64) of word (nr / 64) is set when syscall nr is selected.
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, SYSCALL_FILTER_WORDS);
+    __type(key, __u32);
+    __type(value, __u64);
+} syscall_filter SEC(".maps");
+
 static inline __u32 get_tgid(void) {
     return (__u32)(bpf_get_current_pid_tgid() >> 32);
 }
@@ -32,12 +52,29 @@ static inline __u32 get_pid(void) {
     return (__u32)bpf_get_current_pid_tgid();
 }
 
+static inline int is_syscall_selected(__u64 syscall_id) {
+    if (syscall_id >= MAX_SYSCALL_NR) return 0;
+
+    __u32 word = syscall_id / 64;
+    __u64 *bits = bpf_map_lookup_elem(&syscall_filter, &word);
+    if (!bits) return 0;
+
+    return (*bits >> (syscall_id % 64)) & 1;
+}
+
 SEC("raw_tp/sys_enter")
 int trace_syscall_enter(struct bpf_raw_tracepoint_args *ctx) {
-    // ctx->args[0] contains the syscall number
+    // ctx->args[1] contains the syscall number
+    __u64 syscall_id = ctx->args[1];
+    if (!is_syscall_selected(syscall_id)) return 0;
+    if (!cgroup_event_allowed()) return 0;
+
     __u32 pid = get_pid();
-    __u64 ts = bpf_ktime_get_tai_ns();
-    bpf_map_update_elem(&start_times, &pid, &ts, BPF_ANY);
+    struct syscall_start start = {
+        .ts = bpf_ktime_get_tai_ns(),
+        .syscall_id = syscall_id,
+    };
+    bpf_map_update_elem(&start_times, &pid, &start, BPF_ANY);
     return 0;
 }
 
@@ -46,11 +83,13 @@ int trace_syscall_exit(struct bpf_raw_tracepoint_args *ctx) {
     __u32 pid = get_pid();
     __u32 tgid = get_tgid();
     
-    __u64 *start_ts = bpf_map_lookup_elem(&start_times, &pid);
-    if (!start_ts) return 0;
+    // Only selected syscalls have a start entry
+    struct syscall_start *start = bpf_map_lookup_elem(&start_times, &pid);
+    if (!start) return 0;
     
     __u64 end_ts = bpf_ktime_get_tai_ns();
-    __u64 duration = end_ts - *start_ts;
+    __u64 duration = end_ts - start->ts;
+    int syscall_id = start->syscall_id; // ctx->args[1] is the return value here
     
     bpf_map_delete_elem(&start_times, &pid);
     
@@ -61,11 +100,11 @@ int trace_syscall_exit(struct bpf_raw_tracepoint_args *ctx) {
     event->tgid = tgid;
     event->timestamp = end_ts;
     event->runtime_ns = duration;
-    event->syscall_id = ctx->args[1]; // syscall number from context
+    event->syscall_id = syscall_id;
     bpf_get_current_comm(&event->comm, sizeof(event->comm));
     
-    bpf_ringbuf_submit(event, 0);
+    bpf_ringbuf_submit(event, ringbuf_submit_flags(&events));
     return 0;
 }
 
-char _license[] SEC("license") = "GPL";
\ No newline at end of file
+char _license[] SEC("license") = "GPL";
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+// Single-threaded event loop shared by the probe modules of the agent:
+// epoll over ring buffer (or any) fds plus periodic timerfd timers.
+// Register everything before run(); callbacks run on the loop thread.
+class AgentLoop
+{
+public:
+    using Callback = std::function<void()>;
+
+private:
+    struct Handler
+    {
+        int fd;
+        bool timer; // timerfd, read to rearm
+        Callback callback;
+    };
+
+    int epoll_fd_;
+    int wake_fd_; // eventfd written by stop()
+    std::vector<std::unique_ptr<Handler>> handlers_;
+    std::atomic<bool> running_;
+    std::atomic<bool> stopping_;
+
+    bool watch(std::unique_ptr<Handler> handler);
+
+public:
+    AgentLoop();
+    ~AgentLoop();
+
+    AgentLoop(const AgentLoop &) = delete;
+    AgentLoop &operator=(const AgentLoop &) = delete;
+
+    bool open();
+    void close();
+
+    // Call on_readable whenever fd has data
+    bool add_fd(int fd, Callback on_readable);
+    // Call on_expiry every interval
+    bool add_timer(std::chrono::milliseconds interval, Callback on_expiry);
+
+    // Dispatch until stop() is called, from any thread or a callback (also before run())
+    void run();
+    void stop();
+    bool is_running() const { return running_; }
+};
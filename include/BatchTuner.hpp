@@ -0,0 +1,45 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "InfluxClient.hpp"
+
+// AIMD tuning of the export batch size and flush interval. Fast writes grow
+// the batch additively and shorten the interval; slow, throttled or failed
+// writes halve the batch and double the interval, so the exporter settles
+// just below the latency the backend can sustain.
+class BatchTuner
+{
+private:
+    std::atomic<size_t> batch_size_;
+    std::atomic<long> flush_interval_ms_;
+
+    size_t min_batch_size_;
+    size_t max_batch_size_;
+    size_t batch_size_step_;
+    long min_flush_interval_ms_;
+    long max_flush_interval_ms_;
+    long flush_interval_step_ms_;
+
+    std::mutex mutex_;
+    double target_latency_ms_;
+    double latency_ewma_ms_;
+    std::chrono::steady_clock::time_point last_decrease_;
+
+    void increase();
+    void decrease();
+
+public:
+    BatchTuner(size_t initial_batch_size = 1000,
+               std::chrono::milliseconds initial_flush_interval = std::chrono::seconds(10));
+
+    // Feed the outcome of every write request
+    void on_write(const InfluxClient::WriteResult &result);
+
+    void set_target_latency(std::chrono::milliseconds latency);
+    void set_batch_size_limits(size_t min_size, size_t max_size);
+
+    size_t batch_size() const { return batch_size_; }
+    std::chrono::milliseconds flush_interval() const { return std::chrono::milliseconds(flush_interval_ms_.load()); }
+    double latency_ewma_ms();
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <type_traits>
+#include <condition_variable>
+
+// File layout: a header, then entries that start with a kind byte. Site
+// entries always precede the first record that references them.
+#define BINLOG_MAGIC 0x474c4245 // "EBLG" little endian
+#define BINLOG_VERSION 3
+#define BINLOG_ENTRY_PAD 0     // single filler byte, skipped by readers
+#define BINLOG_ENTRY_SITE 1    // u32 id, u8 level, u32 line, u8 nargs, u16 format len, u16 file len, types, format, file
+#define BINLOG_ENTRY_RECORD 2  // u32 id, u32 argument bytes, u64 wall clock ns, arguments
+#define BINLOG_ENTRY_DROPPED 3 // u64 records lost to full thread buffers
+#define BINLOG_ENTRY_DRAIN 4   // ends one drain pass; its thread buffers follow each other, readers sort by time
+#define BINLOG_MAX_STRING 4096
+#define BINLOG_THREAD_BUFFER (1024 * 1024)
+
+struct binlog_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+// Call site of a binary log statement, registered on its first use
+struct BinaryLogSite
+{
+    uint8_t level;
+    const char *file;
+    int line;
+    std::atomic<uint32_t> id{0};
+};
+
+// NanoLog-style deferred formatting: a statement stores its site id, a
+// timestamp and its raw arguments in a per-thread buffer, a background thread
+// copies the buffers to the log file and the log decoder formats them offline.
+class BinaryLog
+{
+public:
+    struct ThreadBuffer;
+
+private:
+    static std::atomic<bool> open_;
+    static int fd_;
+    static std::mutex mutex_;
+    static std::condition_variable cv_;
+    static std::thread thread_;
+    static bool stopping_;
+    static int flush_waiters_;
+    static std::atomic<bool> wakeup_; // a thread buffer is more than half full
+    static uint64_t passes_;
+    static std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    static std::vector<std::string> sites_; // encoded site entries, index = id - 1
+    static size_t sites_written_;
+
+    static ThreadBuffer &threadBuffer();
+    static uint32_t registerSite(BinaryLogSite &site, std::string_view format, const std::string &types);
+    static char *reserve(size_t bytes);
+    static void commit();
+    static uint64_t now();
+    static void drainLoop();
+    static void drain();
+    static bool writeAll(const char *data, size_t size);
+
+    template <typename T>
+    static constexpr char typeCode()
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            return 'u';
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            return 'i';
+        else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+            return 'u';
+        else if constexpr (std::is_floating_point_v<T>)
+            return 'd';
+        else
+        {
+            static_assert(std::is_convertible_v<const T &, std::string_view>, "unsupported binary log argument");
+            return 's';
+        }
+    }
+
+    template <typename T>
+    static size_t argSize(const T &value)
+    {
+        if constexpr (typeCode<T>() == 's')
+            return 2 + std::min<size_t>(std::string_view(value).size(), BINLOG_MAX_STRING);
+        else
+            return 8;
+    }
+
+    template <typename T>
+    static char *encode(char *out, const T &value)
+    {
+        if constexpr (typeCode<T>() == 's')
+        {
+            std::string_view text(value);
+            uint16_t length = static_cast<uint16_t>(std::min<size_t>(text.size(), BINLOG_MAX_STRING));
+            memcpy(out, &length, 2);
+            memcpy(out + 2, text.data(), length);
+            return out + 2 + length;
+        }
+        else if constexpr (typeCode<T>() == 'd')
+        {
+            double number = static_cast<double>(value);
+            memcpy(out, &number, 8);
+            return out + 8;
+        }
+        else
+        {
+            uint64_t number = static_cast<uint64_t>(value);
+            memcpy(out, &number, 8);
+            return out + 8;
+        }
+    }
+
+public:
+    // Truncates path and starts the background writer
+    static bool open(const std::string &path);
+    static void close();
+    static bool isOpen() { return open_.load(std::memory_order_relaxed); }
+    // Wait until every record logged so far is in the file
+    static void flush();
+
+    template <typename... Args>
+    static void write(BinaryLogSite &site, std::format_string<Args...> format, Args &&...args)
+    {
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0)
+            id = registerSite(site, format.get(), std::string{typeCode<std::remove_cvref_t<Args>>()...});
+
+        uint32_t arg_bytes = static_cast<uint32_t>((argSize(args) + ... + 0));
+        char *out = reserve(1 + 4 + 4 + 8 + arg_bytes);
+        if (!out)
+            return;
+
+        uint64_t timestamp = now();
+        *out++ = BINLOG_ENTRY_RECORD;
+        memcpy(out, &id, 4);
+        memcpy(out + 4, &arg_bytes, 4);
+        memcpy(out + 8, &timestamp, 8);
+        out += 16;
+        ((out = encode(out, args)), ...);
+        commit();
+    }
+
+    // Pre-formatted text, used by the string based Logger calls
+    static void writeText(uint8_t level, std::string_view message);
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <chrono>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "Logger.hpp"
+
+// Skeletons generated from ebpf/*.bpf.c at build time
+struct cpu_monitor;
+struct memory_monitor;
+struct syscall_latency_monitor;
+struct syscall_frequency;
+struct hello_ring_buffer;
+struct runqueue_latency;
+
+// Embedded BPF objects that can be loaded
+#define BPF_PROBE_CPU (1u << 0)
+#define BPF_PROBE_MEMORY (1u << 1)
+#define BPF_PROBE_SYSCALL_LATENCY (1u << 2)
+#define BPF_PROBE_SYSCALL_FREQUENCY (1u << 3)
+#define BPF_PROBE_HELLO_RING_BUFFER (1u << 4)
+#define BPF_PROBE_RUNQUEUE_LATENCY (1u << 5)
+
+// Loads and attaches the embedded BPF skeletons, so no external pinning
+// step is needed. Independent objects are loaded in parallel; maps shared
+// between them (the cgroup filter) are created up front and reused.
+class BpfLoader
+{
+private:
+    struct cpu_monitor *cpu_skel;
+    struct memory_monitor *memory_skel;
+    struct syscall_latency_monitor *syscall_latency_skel;
+    struct syscall_frequency *syscall_frequency_skel;
+    struct hello_ring_buffer *hello_ring_buffer_skel;
+    struct runqueue_latency *runqueue_latency_skel;
+
+    int cgroup_filter_map_fd;
+    int cgroup_filter_config_map_fd;
+    __u32 ringbuf_size;
+    __u64 wakeup_watermark;
+    std::chrono::milliseconds startup_time;
+
+    bool create_shared_maps();
+    bool share_cgroup_filter(struct bpf_map *filter_map, struct bpf_map *config_map);
+    bool size_ring(struct bpf_map *ring_map, __u32 size);
+    __u64 watermark_for(__u32 ring_size) const;
+
+    bool load_cpu_monitor();
+    bool load_memory_monitor();
+    bool load_syscall_latency_monitor();
+    bool load_syscall_frequency();
+    bool load_hello_ring_buffer();
+    bool load_runqueue_latency();
+
+public:
+    explicit BpfLoader(__u32 ringbuf_bytes = default_ringbuf_size());
+    ~BpfLoader();
+
+    // Load and attach the given BPF_PROBE_* objects
+    bool load(unsigned probes);
+    void destroy();
+
+    // Power of two ring size scaled with the number of CPUs
+    static __u32 default_ringbuf_size();
+
+    // Unconsumed bytes after which probes wake the reader (0 = every record),
+    // must be set before load()
+    void set_wakeup_watermark(__u64 bytes) { wakeup_watermark = bytes; }
+    std::chrono::milliseconds get_startup_time() const { return startup_time; }
+
+    // Map fds, owned by the loader and valid until destroy()
+    int cpu_events_fd() const;
+    int memory_events_fd() const;
+    int syscall_latency_events_fd() const;
+    int syscall_filter_fd() const;
+    int syscall_counts_fd() const;
+    int cgroup_syscall_counts_fd() const;
+    int syscall_counts_config_fd() const;
+    int hello_output_fd() const;
+    int runqueue_latency_fd() const;
+    int cgroup_filter_fd() const { return cgroup_filter_map_fd; }
+    int cgroup_filter_config_fd() const { return cgroup_filter_config_map_fd; }
+};
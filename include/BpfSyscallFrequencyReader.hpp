@@ -3,15 +3,52 @@
 #include <string>
 #include <unordered_map>
 #include <stdexcept>
+#include <chrono>
+#include <vector>
+
+struct SyscallFrequency
+{
+    long count;          // total since the probe was loaded
+    double rate_per_sec; // since the previous sample
+};
 
 class BpfSyscallFrequencyReader
 {
 private:
     int mapFd;
     std::string mapPath;
+    int cgroupMapFd;
+    std::string cgroupMapPath;
+    int configMapFd;
+    std::string configMapPath;
+    int numCpus;
+    std::vector<__u64> percpuValues;
+
+    std::unordered_map<int, long> previousCounts;
+    std::unordered_map<__u64, std::unordered_map<int, long>> previousCgroupCounts;
+    std::chrono::steady_clock::time_point previousSample;
+
+    long sumPerCpu(int fd, const void *key);
+    void initPerCpuBuffer();
 
 public:
-    explicit BpfSyscallFrequencyReader();
+    explicit BpfSyscallFrequencyReader(const std::string &pinnedPath = "/sys/fs/bpf/syscall_counts",
+                                       const std::string &cgroupPinnedPath = "/sys/fs/bpf/cgroup_syscall_counts",
+                                       const std::string &configPinnedPath = "/sys/fs/bpf/syscall_counts_config");
+    // Use map fds owned by someone else (e.g. BpfLoader)
+    BpfSyscallFrequencyReader(int countsFd, int cgroupCountsFd, int configFd);
+    ~BpfSyscallFrequencyReader();
+
+    // Totals per syscall number, summed over all CPUs (non-zero only)
     std::unordered_map<int, long> readAll();
+
+    // Totals plus per-second rates since the previous call
+    std::unordered_map<int, SyscallFrequency> sample();
+
+    // Optional per-cgroup counting: cgroup id -> syscall number -> total.
+    // Counters idle for a whole interval are deleted and restart from zero.
+    bool enablePerCgroup(bool enable);
+    std::unordered_map<__u64, std::unordered_map<int, long>> readPerCgroup();
+
     std::string getSyscallName(int key);
 };
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <bpf/bpf.h>
+#include "Logger.hpp"
+
+// Must match ebpf/cgroup_filter.bpf.h
+#define CGROUP_VERDICT_ALLOW 1
+#define CGROUP_VERDICT_DENY 2
+
+enum class CgroupFilterMode : __u32
+{
+    OFF = 0,
+    ALLOWLIST = 1,
+    DENYLIST = 2
+};
+
+struct cgroup_filter_config
+{
+    __u32 mode;
+    __u32 self_tgid;
+};
+
+// Keeps the in-kernel cgroup allow/deny maps in sync with the kubepods
+// cgroup hierarchy, so probes discard non-workload events before they
+// reach the ring buffers. Requires the cgroup v2 (unified) hierarchy,
+// where a cgroup id is the inode number of its directory.
+class CgroupFilter
+{
+private:
+    std::string cgroup_root;
+    int filter_map_fd;
+    int config_map_fd;
+
+    std::unordered_set<__u64> allowed_cgroups;
+    std::unordered_set<__u64> denied_cgroups;
+    std::mutex cgroups_mutex;
+
+    std::atomic<bool> running;
+    std::thread refresh_thread;
+    std::mutex refresh_mutex;
+    std::condition_variable refresh_cv;
+
+    std::unordered_set<__u64> scan_workload_cgroups() const;
+    __u64 self_cgroup_id() const;
+    bool write_config(CgroupFilterMode mode);
+    void refresh_loop(std::chrono::seconds interval);
+
+public:
+    explicit CgroupFilter(const std::string &cgroup_mount = "/sys/fs/cgroup");
+    ~CgroupFilter();
+
+    // Use the shared filter maps created by BpfLoader
+    bool open(int filter_fd, int config_fd);
+    void close();
+
+    // Sync the maps with the current pods; safe to call at any time
+    void refresh();
+    bool enable(CgroupFilterMode mode);
+    bool disable() { return write_config(CgroupFilterMode::OFF); }
+
+    void start_refreshing(std::chrono::seconds interval = std::chrono::seconds(5));
+    void stop_refreshing();
+
+    size_t allowed_count();
+};
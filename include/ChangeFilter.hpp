@@ -0,0 +1,55 @@
+#pragma once
+#include <string_view>
+#include <span>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+#define CHANGE_FILTER_DEFAULT_EPSILON 0.01    // relative change that makes a series worth writing again
+#define CHANGE_FILTER_DEFAULT_MAX_SILENCE_S 300
+
+// Suppresses repeated writes of aggregated series. A series is written when
+// one of its fields moved by more than epsilon (relative) since it was last
+// written, or as a heartbeat once max_silence has passed. Only a hash, the
+// last written value and its time are kept per field.
+class ChangeFilter
+{
+public:
+    using Field = std::pair<const char *, double>;
+
+private:
+    struct Entry
+    {
+        float value;
+        uint32_t emitted_s;
+    };
+
+    std::unordered_map<uint64_t, Entry> last_emitted_;
+    double epsilon_;
+    int64_t max_silence_s_;
+    uint64_t emitted_;
+    uint64_t suppressed_;
+
+    static uint64_t key(std::string_view series, std::string_view field);
+    bool changed(const Entry &entry, double value, int64_t now_s) const;
+
+public:
+    explicit ChangeFilter(double epsilon = CHANGE_FILTER_DEFAULT_EPSILON,
+                          std::chrono::seconds max_silence = std::chrono::seconds(CHANGE_FILTER_DEFAULT_MAX_SILENCE_S));
+
+    // max_silence 0 writes every series every time
+    void configure(double epsilon, std::chrono::seconds max_silence);
+    bool enabled() const { return max_silence_s_ > 0; }
+
+    // True when the series should be written, its fields are then recorded as written
+    bool admit(std::string_view series, std::span<const Field> fields, int64_t now_s);
+    bool admit(std::string_view series, double value, int64_t now_s);
+
+    // Forget series not seen for longer than a heartbeat, they have ended
+    void prune(int64_t now_s);
+
+    size_t size() const { return last_emitted_.size(); }
+    uint64_t emitted() const { return emitted_; }
+    uint64_t suppressed() const { return suppressed_; }
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <variant>
+#include <unordered_map>
+#include <condition_variable>
+#include "RingBufReaderK8s.hpp"
+#include "SpaceSaving.hpp"
+#include "WindowAggregator.hpp"
+#include "PodMetadataCache.hpp"
+
+#define COLLECTOR_MAX_QUEUED_BYTES (64u << 20) // events all lagging shards together may have queued
+
+using PodMetrics = std::unordered_map<std::string, std::unordered_map<std::string, double>>;
+
+// Per pod/command aggregates of one flush interval
+struct IntervalAggregates
+{
+    PodMetrics pod_metrics;
+    PodMetrics io_pod_metrics;
+
+    // Heavy hitters of the interval, only they are exported per pod/command
+    SpaceSaving top_pods_cpu;
+    SpaceSaving top_pods_syscalls;
+    SpaceSaving top_pods_latency;
+    SpaceSaving top_commands_cpu;
+    SpaceSaving top_commands_syscalls;
+
+    explicit IntervalAggregates(size_t top_k_capacity);
+    // Shards see different processes of the same pod, their sums add up
+    void merge(const IntervalAggregates &other);
+    void clear();
+};
+
+using CollectorEvent = std::variant<cpu_event, memory_event, syscall_latency_event>;
+
+// Slice of the collector's event processing. Events are routed to shards by
+// TGID, so a process is always handled by the same shard and its metadata
+// lookups stay in that shard's slice; aggregates are merged at flush time.
+struct CollectorShard
+{
+    std::mutex mutex; // state below, taken while processing and by flushes
+    IntervalAggregates aggregates;
+    WindowAggregator rollups;
+    std::vector<std::string> batch_buffer;
+    std::chrono::steady_clock::time_point last_batch_flush;
+
+    // Metadata slice of the shard's processes, dropped when the shared cache refreshes
+    std::unordered_map<__u32, PodInfoPtr> pods;
+    uint64_t metadata_generation;
+
+    // Filled by the reader between ticks, then handed over to the worker's queue
+    std::vector<CollectorEvent> pending;
+    std::vector<CollectorEvent> queue;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::thread worker; // only with more than one shard
+    uint64_t dropped;   // events not handed over because the queue budget was used up
+
+    explicit CollectorShard(size_t top_k_capacity)
+        : aggregates(top_k_capacity), last_batch_flush(std::chrono::steady_clock::now()), metadata_generation(0),
+          dropped(0)
+    {
+    }
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include "MetricSink.hpp"
+
+// Appends batches as line protocol to a file, or to stdout for path "-"
+class FileSink : public MetricSink
+{
+private:
+    std::string path_;
+    int fd_;
+
+protected:
+    bool deliver(const MetricBatchPtr &batch) override;
+
+public:
+    explicit FileSink(const std::string &path, size_t max_queued = 64);
+    ~FileSink() override;
+
+    bool start() override;
+    void stop() override;
+};
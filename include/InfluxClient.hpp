@@ -1,20 +1,176 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <chrono>
 #include <vector>
+#include <cstdint>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include "LineBatch.hpp"
+
+typedef void CURL;
+typedef void CURLM;
+struct curl_slist;
 
 class InfluxClient
 {
+public:
+    // Called from the async worker thread once a write completes,
+    // must not block on further asynchronous writes
+    using CompletionCallback = std::function<void(bool success)>;
+
+    // Receives the encoded body of a batch that failed with a retryable outcome.
+    // Blocking writes make one attempt and hand such batches over right away.
+    using FailedWriteHandler = std::function<void(std::span<const std::string> chunks,
+                                                  bool newlineTerminated, bool gzip)>;
+
+    // How InfluxDB answered one write request
+    enum class WriteOutcome
+    {
+        OK,        // 2xx, every point stored
+        PARTIAL,   // 400 partial write, the valid points were stored
+        TOO_LARGE, // 413, the body has to be split
+        RETRY,     // 429, 5xx or transport error, worth another attempt
+        REJECTED   // other 4xx, resending cannot help
+    };
+
+    struct WriteResult
+    {
+        WriteOutcome outcome;
+        long status; // 0 when no HTTP response arrived
+        double latencyMs;
+        size_t bytes;
+    };
+
+    // Called after every write attempt, e.g. to tune batch sizes
+    using WriteObserver = std::function<void(const WriteResult &result)>;
+
+    // Timestamp precision of written points, NS is the line protocol default
+    enum class Precision : uint32_t
+    {
+        NS = 0,
+        US,
+        MS,
+        S
+    };
+
 private:
     std::string baseUrl_;
     std::string database_;
 
+    // v2 API (/api/v2/write with org, bucket and token) instead of v1 /write?db=
+    bool v2_;
+    std::string org_;
+    std::string bucket_;
+    std::string token_;
+    Precision precision_;
+
+    // Prebuilt request state shared by every call
+    std::string writeUrl_;
+    std::string pingUrl_;
+    std::string queryUrl_;
+    struct curl_slist *writeHeaders_;
+    struct curl_slist *gzipWriteHeaders_;
+
+    // Batch compression (0 = off, 1-9 = gzip level) and its effect
+    int compressionLevel_;
+    std::atomic<uint64_t> rawBytesWritten_;
+    std::atomic<uint64_t> encodedBytesWritten_;
+
+    // Reusable easy handles, each keeps its connection alive between requests
+    std::vector<CURL *> idleHandles_;
+    std::mutex poolMutex_;
+    static const size_t maxIdleHandles_ = 8;
+
+    // Streams a list of chunks as one request body without concatenating
+    // them, optionally writing a '\n' after every chunk
+    struct ChunkUpload
+    {
+        std::span<const std::string> chunks;
+        bool newlineTerminated = false;
+        size_t index = 0;
+        size_t offset = 0;
+
+        size_t read(char *buffer, size_t capacity);
+        void rewind();
+        size_t size() const;
+    };
+
+    void buildRequestState();
+    std::string buildWriteUrl(Precision precision) const;
+
     static size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *response);
+    static size_t ReadCallback(char *buffer, size_t size, size_t nitems, void *userdata);
+    static int SeekCallback(void *userdata, int64_t offset, int origin);
+
+    CURL *acquireHandle();
+    void releaseHandle(CURL *curl);
+    void setWriteOptions(CURL *curl, const std::string &url, std::string_view body, bool gzip, std::string *response);
+    void setUploadOptions(CURL *curl, ChunkUpload *upload, bool gzip, std::string *response);
+    WriteOutcome post(const std::string &url, std::string_view body, bool gzip, bool observed = true);
+    bool postChunks(std::span<const std::string> chunks, bool newlineTerminated, bool gzip);
+    bool postAsync(std::shared_ptr<const std::vector<std::string>> owner, bool newlineTerminated, bool gzip, CompletionCallback callback);
+
+    // Response handling shared by the blocking and asynchronous paths
+    static const int maxRetries_ = 3;
+    WriteObserver writeObserver_;
+    static WriteOutcome classify(bool transportOk, long status);
+    WriteOutcome finishRequest(CURL *curl, bool transportOk, const std::string &response, size_t bytes,
+                               std::chrono::milliseconds *retryAfter, bool observed);
+    static std::chrono::milliseconds retryDelay(int attempt, std::chrono::milliseconds retryAfter);
+    static size_t bodySize(std::span<const std::string> chunks, bool newlineTerminated);
+
+    // Asynchronous mode: a worker drives N pipelined writes with curl multi
+    struct AsyncWrite
+    {
+        // Split halves of a too large batch share the chunks of the original
+        std::shared_ptr<const std::vector<std::string>> owner;
+        std::span<const std::string> chunks;
+        bool newlineTerminated = false;
+        size_t bytes = 0;
+        ChunkUpload upload;
+        bool gzip = false;
+        std::string response;
+        CompletionCallback callback;
+        CURL *curl = nullptr;
+        int attempts = 0;
+        std::chrono::steady_clock::time_point notBefore;
+    };
+
+    CURLM *multi_;
+    std::thread asyncThread_;
+    std::atomic<bool> asyncRunning_;
+    std::mutex asyncMutex_;
+    std::condition_variable asyncCv_;
+    std::deque<AsyncWrite *> pendingWrites_;
+    size_t inFlight_;
+    size_t outstandingBytes_;
+    size_t maxInFlight_;
+    size_t maxOutstandingBytes_;
+
+    // Set before enableAsync(); failed and overflowing batches are handed over
+    FailedWriteHandler failedWriteHandler_;
+
+    void asyncLoop();
+    void startPendingWrites();
+    void completeWrite(AsyncWrite *write, bool transportOk);
+    void finishWrite(AsyncWrite *write, bool success);
 
 public:
     InfluxClient(const std::string &protocol = "http",
                  const std::string &host = "localhost",
                  int port = 8086,
                  const std::string &database = "mydb");
+    ~InfluxClient();
+
+    InfluxClient(const InfluxClient &) = delete;
+    InfluxClient &operator=(const InfluxClient &) = delete;
 
     // Write single data point
     bool write(const std::string &measurement,
@@ -27,10 +183,54 @@ public:
 
     // Batch write multiple lines
     bool writeBatch(const std::vector<std::string> &lines);
+    bool writeBatch(LineBatch &batch);
+
+    // Write an already encoded body, failures are not passed to the failed write handler
+    // nor reported to the write observer. Too large uncompressed bodies are split at line boundaries.
+    WriteOutcome writeEncoded(std::string_view body, bool gzip, Precision precision);
+
+    // Switch to the v2 write API (call before writing)
+    void useV2(const std::string &org, const std::string &bucket, const std::string &token);
+    bool isV2() const { return v2_; }
+
+    // Precision of timestamps in written lines (call before writing)
+    void setPrecision(Precision precision);
+    Precision precision() const { return precision_; }
+    static bool parsePrecision(const std::string &name, Precision *precision);
+    // Truncate a nanosecond timestamp to the configured precision
+    uint64_t timestamp(uint64_t ns) const;
+
+    // gzip batch bodies (Content-Encoding: gzip), 0 disables
+    void setCompression(int level) { compressionLevel_ = level; }
+    int compressionLevel() const { return compressionLevel_; }
+    LineBatch newBatch() const { return LineBatch(compressionLevel_); }
+    // Raw / encoded bytes over every batch written so far
+    double compressionRatio() const;
+
+    // Asynchronous writes: keep up to maxInFlight requests on the wire and
+    // block submitters while more than maxOutstandingBytes are unacknowledged
+    bool enableAsync(size_t maxInFlight = 4, size_t maxOutstandingBytes = 16 * 1024 * 1024);
+    void disableAsync();
+    bool isAsync() const { return asyncRunning_; }
+    // With a handler, async batches over maxOutstandingBytes are handed to it instead of blocking
+    void setFailedWriteHandler(FailedWriteHandler handler) { failedWriteHandler_ = std::move(handler); }
+    // Hand lines that were never sent to the failed write handler, false without one
+    bool divertLines(std::span<const std::string> lines);
+    // Set before enableAsync() and spool replay; sees the outcome and latency of
+    // every request except the replay of encoded bodies (writeEncoded)
+    void setWriteObserver(WriteObserver observer) { writeObserver_ = std::move(observer); }
+    bool writeRawAsync(std::string lineProtocol, CompletionCallback callback = nullptr);
+    bool writeBatchAsync(const std::vector<std::string> &lines, CompletionCallback callback = nullptr);
+    bool writeBatchAsync(LineBatch &&batch, CompletionCallback callback = nullptr);
+    // Lines shared with the caller, e.g. one batch fanned out to several sinks
+    bool writeBatchAsync(std::shared_ptr<const std::vector<std::string>> lines, CompletionCallback callback = nullptr);
+
+    // Wait until every queued asynchronous write has completed
+    void flushAsync();
 
     // Health check
     bool ping();
 
     // Create database
     bool createDatabase(const std::string &dbName);
-};
\ No newline at end of file
+};
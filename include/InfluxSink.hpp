@@ -0,0 +1,20 @@
+#pragma once
+#include "MetricSink.hpp"
+#include "InfluxClient.hpp"
+
+// Writes batches through an InfluxClient (v1 or v2 as configured on it),
+// pipelined when the client is in asynchronous mode
+class InfluxSink : public MetricSink
+{
+private:
+    InfluxClient &client_;
+
+protected:
+    bool deliver(const MetricBatchPtr &batch) override;
+    // Overflowing batches go to the client's failed write handler (the spool)
+    bool divert(const MetricBatchPtr &batch) override;
+
+public:
+    explicit InfluxSink(InfluxClient &client, size_t max_queued = 64);
+    ~InfluxSink() override;
+};
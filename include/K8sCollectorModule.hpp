@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include "ProbeModule.hpp"
+#include "K8sPerformanceCollector.hpp"
+
+// The probes of the K8sPerformanceCollector (CPU, memory, syscall and
+// run-queue latency), read and aggregated on the agent loop
+class K8sCollectorModule : public ProbeModule
+{
+private:
+    unsigned probes_;
+    std::unique_ptr<K8sPerformanceCollector> collector_;
+
+public:
+    // probes: any of K8S_RING_PROBES and BPF_PROBE_RUNQUEUE_LATENCY
+    explicit K8sCollectorModule(unsigned probes) : probes_(probes) {}
+
+    const char *name() const override { return "k8s"; }
+    bool start(AgentContext &context) override;
+    void stop() override;
+};
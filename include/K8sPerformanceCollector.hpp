@@ -2,80 +2,244 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <unordered_set>
+#include <algorithm>
 #include "InfluxClient.hpp"
+#include "BpfLoader.hpp"
 #include "RingBufReaderK8s.hpp"
+#include "CgroupFilter.hpp"
+#include "WriteSpool.hpp"
+#include "BatchTuner.hpp"
+#include "MetricSink.hpp"
+#include "SyscallNames.hpp"
+#include "CollectorShard.hpp"
+#include "RunqueueLatencyReader.hpp"
+#include "ChangeFilter.hpp"
+#include "PodMetadataCache.hpp"
+#include "AgentLoop.hpp"
 #include "Logger.hpp"
 
+#define TOPK_DEFAULT 20
+#define TOPK_CAPACITY_FACTOR 4 // counters per reported key, more means tighter estimates
+
+// Probes that report through ring buffers, the others are aggregated in the kernel
+#define K8S_RING_PROBES (BPF_PROBE_CPU | BPF_PROBE_MEMORY | BPF_PROBE_SYSCALL_LATENCY)
+
 class K8sPerformanceCollector
 {
 private:
-    InfluxClient influx_;
+    // Exporter and metadata, owned unless shared with the other probes of the agent
+    std::unique_ptr<InfluxClient> own_influx_;
+    InfluxClient &influx_;
+    MetricFanout own_sinks_;
+    std::unique_ptr<PodMetadataCache> own_metadata_;
+    PodMetadataCache &metadata_;
+    bool shared_;
+
+    BpfLoader bpf_loader_;
+    unsigned probes_;
     RingBufReaderK8s ring_reader_;
+    std::unique_ptr<RunqueueLatencyReader> runqueue_reader_; // in-kernel histograms, read at flush
+    CgroupFilter cgroup_filter_;
+    CgroupFilterMode cgroup_filter_mode_;
     std::atomic<bool> running_;
     std::thread process_thread_;
+    std::thread update_thread_;     // metadata refresh and aggregate flush when not on the agent loop
+    std::mutex update_mutex_;
+    std::condition_variable update_cv_;
+
+    // Flushes come from the update thread or agent timer and from stop(); they
+    // run one at a time since they share the run-queue reader and the filters
+    std::mutex flush_mutex_;
+
+    // Events are processed by shards, on their own workers when there are several
+    size_t num_shards_;
+    std::vector<std::unique_ptr<CollectorShard>> shards_;
+    std::atomic<bool> workers_running_;
+    std::atomic<size_t> queued_events_; // handed over to workers and not yet taken, over every shard
+
+    // Shards pass their event lines on in slices, published as one batch so
+    // the number and size of batches does not depend on the shard count
+    std::mutex outgoing_mutex_;
+    std::vector<std::string> outgoing_batch_;
+    std::chrono::steady_clock::time_point last_outgoing_flush_;
 
     // Batch processing
-    std::vector<std::string> batch_buffer_;
-    std::chrono::steady_clock::time_point last_batch_flush_;
-    static const size_t max_batch_size_ = 1000;
-    static const std::chrono::seconds batch_flush_interval_;
+    BatchTuner batch_tuner_; // batch size and flush interval follow write latency
 
-    // Pod tracking
-    std::unordered_map<__u32, std::string> pid_to_pod_;
-    std::unordered_map<__u32, std::string> pid_to_container_;
-    std::unordered_map<__u32, std::string> pid_to_namespace_;
+    // Batches InfluxDB could not take, replayed once it is reachable again
+    std::unique_ptr<WriteSpool> spool_;
+    size_t spool_replay_rate_;
 
-    // Metrics aggregation
-    std::unordered_map<std::string, std::unordered_map<std::string, double>> pod_metrics_;
+    // Destinations of event and aggregate batches, InfluxDB when none are added
+    MetricFanout &sinks_;
 
-    // IO-specific tracking
-    std::unordered_map<std::string, std::unordered_map<std::string, double>> io_pod_metrics_;
+    // Heavy hitters exported per pod/command, tracked in every shard's aggregates
+    size_t top_k_;
+
+    // Per pod/container rollups over tumbling windows, closed on the reader thread
+    std::vector<std::chrono::seconds> rollup_windows_;
+    bool rollup_only_;
+    int num_cpus_;
+
+    // Aggregated series are only rewritten when they change or their heartbeat is due
+    ChangeFilter aggregate_filter_;
+    // Aggregate series of the previous and the current flush with their field
+    // names, so a series that stops getting events is written once as 0
+    struct AggregateSeries
+    {
+        std::vector<const char *> names;
+        const char *counter = nullptr; // written as an integer field
+    };
+    std::unordered_map<std::string, AggregateSeries> previous_aggregates_;
+    std::unordered_map<std::string, AggregateSeries> current_aggregates_;
+    ChangeFilter rollup_filter_;
+    // Rollup series of the last closed window of every duration, by window
+    // length, so a pod or container that goes idle is written once as 0
+    using RollupSeriesNames = std::unordered_map<std::string, std::vector<const char *>>;
+    struct WrittenRollups
+    {
+        int64_t start_ns = 0;
+        RollupSeriesNames series;
+    };
+    std::unordered_map<int64_t, WrittenRollups> previous_rollups_;
+
+    // Syscalls selected for latency tracing (pushed to the in-kernel bitmap)
+    std::unordered_set<int> traced_syscalls_;
+    bool kernel_syscall_filter_;
 
 public:
     K8sPerformanceCollector(const std::string &protocol = "http",
                             const std::string &host = "localhost",
                             int port = 8086,
                             const std::string &database = "k8s_metrics");
+    // Export through the agent's client and sinks, started and stopped by the agent
+    K8sPerformanceCollector(InfluxClient &influx, MetricFanout &sinks, PodMetadataCache &metadata);
     ~K8sPerformanceCollector();
 
-    void start();
+    // Without a loop, events are read and aggregates flushed on own threads
+    void start(AgentLoop *loop = nullptr);
     void stop();
     bool is_running() const { return running_; }
 
     bool test_connection() { return influx_.ping(); }
 
+    // Probe, filter and aggregation settings from the K8S_* environment (call before start())
+    void configure_from_env();
+
+    // K8S_RING_PROBES and/or BPF_PROBE_RUNQUEUE_LATENCY to load (call before start())
+    void set_probes(unsigned probes) { probes_ = probes; }
+
+    // Select the syscalls traced by the latency probe (call before start())
+    void set_traced_syscalls(const std::unordered_set<int> &syscall_ids) { traced_syscalls_ = syscall_ids; }
+    static std::unordered_set<int> default_traced_syscalls();
+
+    // Restrict tracing to Kubernetes workloads (call before start())
+    void set_cgroup_filter_mode(CgroupFilterMode mode) { cgroup_filter_mode_ = mode; }
+
+    // gzip level for batches sent to InfluxDB, 0 disables (call before start())
+    void set_compression_level(int level) { influx_.setCompression(level); }
+
+    // Write through the InfluxDB v2 API instead of v1 (call before start())
+    void use_influx_v2(const std::string &org, const std::string &bucket, const std::string &token)
+    {
+        influx_.useV2(org, bucket, token);
+    }
+
+    // Precision of exported timestamps, coarser ones make shorter lines (call before start())
+    void set_timestamp_precision(InfluxClient::Precision precision) { influx_.setPrecision(precision); }
+
+    // Spool undeliverable batches to dir, an empty dir disables spooling (call before start())
+    void set_spool(const std::string &dir, size_t max_bytes, size_t replay_bytes_per_sec);
+
+    // Export to sink in addition to the others (call before start())
+    void add_sink(std::unique_ptr<MetricSink> sink) { sinks_.add(std::move(sink)); }
+    MetricFanout &sinks() { return sinks_; }
+    InfluxClient &influx_client() { return influx_; }
+
+    // Export only the k heaviest pods and commands per interval plus an other=true sum, 0 exports all (call before start())
+    void set_top_k(size_t k);
+
+    // Tumbling window durations of the pod/container rollups, none disables them (call before start())
+    void set_rollup_windows(const std::vector<std::chrono::seconds> &durations) { rollup_windows_ = durations; }
+    // Export rollups instead of one line per event (call before start())
+    void set_rollup_only(bool rollup_only) { rollup_only_ = rollup_only; }
+
+    // Rewrite aggregated series only when they move by more than epsilon (relative) or
+    // max_silence has passed, max_silence 0 writes every interval (call before start())
+    void set_change_suppression(double epsilon, std::chrono::seconds max_silence)
+    {
+        aggregate_filter_.configure(epsilon, max_silence);
+        rollup_filter_.configure(epsilon, max_silence);
+    }
+
+    // Process events on n shards routed by TGID, 1 processes them on the reader thread (call before start())
+    void set_shards(size_t n) { num_shards_ = std::max<size_t>(n, 1); }
+
+    // Write latency the batch tuner aims for (call before start())
+    void set_target_write_latency(std::chrono::milliseconds latency) { batch_tuner_.set_target_latency(latency); }
+
+    // Ring buffer bytes pending before the probes wake the reader (call before start())
+    void set_ringbuf_wakeup_watermark(__u64 bytes) { bpf_loader_.set_wakeup_watermark(bytes); }
+
 private:
+    // Shared parts are used when given, owned ones created otherwise
+    K8sPerformanceCollector(std::unique_ptr<InfluxClient> own_influx, InfluxClient *influx,
+                            MetricFanout *sinks, PodMetadataCache *metadata);
+
     void process_events();
-    void flush_batch();
+    void flush_batch(CollectorShard &shard);
+    void publish_outgoing(bool force);
+    void on_reader_tick();
+    void advance_rollups(int64_t now_ns, bool final);
+    void append_rollup(const RollupWindow &window, std::vector<std::string> &batch);
+    void append_rollup_line(const std::string &series, const RollupCounters &counters, double seconds,
+                            int64_t window_start_s, uint64_t timestamp, RollupSeriesNames &written,
+                            std::vector<std::string> &batch);
+    void append_silent_rollups(const WrittenRollups &previous, const RollupSeriesNames &current, int64_t start_ns,
+                               std::vector<std::string> &batch);
+
+    // Sharding
+    void start_shards();
+    void stop_shards();
+    void dispatch(__u32 tgid, const CollectorEvent &event);
+    void hand_over();
+    void shard_worker(CollectorShard &shard);
+    void process(CollectorShard &shard, const CollectorEvent &event);
 
-    // Event handlers
-    void handle_cpu_event(const cpu_event &event);
-    void handle_memory_event(const memory_event &event);
-    void handle_syscall_latency_event(const syscall_latency_event &event);
+    // Event handlers, called with the shard locked
+    void handle_cpu_event(CollectorShard &shard, const cpu_event &event);
+    void handle_memory_event(CollectorShard &shard, const memory_event &event);
+    void handle_syscall_latency_event(CollectorShard &shard, const syscall_latency_event &event);
 
     // Metric formatting
-    std::string format_cpu_metric(const cpu_event &event, const std::string &pod_info);
-    std::string format_memory_metric(const memory_event &event, const std::string &pod_info);
-    std::string format_syscall_latency_metric(const syscall_latency_event &event, const std::string &pod_info);
-
-    // Kubernetes info extraction
-    std::string get_pod_info(__u32 pid);
-    std::string get_container_info(__u32 pid);
-    std::string get_namespace_info(__u32 pid);
-    void update_k8s_info_cache();
-    std::string extract_pod_from_cgroup(const std::string &cgroup_line);
-    std::string extract_container_from_cgroup(const std::string &cgroup_line);
+    std::string format_cpu_metric(const cpu_event &event, const PodInfo &pod_info);
+    std::string format_memory_metric(const memory_event &event, const PodInfo &pod_info);
+    std::string format_syscall_latency_metric(const syscall_latency_event &event, const PodInfo &pod_info);
+
+    // Kubernetes info of a process, from the shard's slice of the metadata cache
+    const PodInfo &get_pod_info(CollectorShard &shard, __u32 tgid);
 
     // Metrics aggregation
-    void update_pod_metrics(const std::string &pod_name, const std::string &metric_name, double value);
-    void update_io_pod_metrics(const std::string &pod_name, const std::string &metric_name, double value);
     void flush_aggregated_metrics();
+    void append_runqueue_latency(std::vector<std::string> &batch, const std::string &timestamp, int64_t now_s);
+    // counter names the field written as an integer (e.g. event counts), the others are floats
+    void append_aggregate(std::vector<std::string> &batch, const std::string &series,
+                          const std::vector<ChangeFilter::Field> &fields, const std::string &timestamp, int64_t now_s,
+                          const char *counter = nullptr);
+    void append_silent_aggregates(std::vector<std::string> &batch, const std::unordered_set<std::string> &folded_pods,
+                                  const std::string &timestamp, int64_t now_s);
+    void append_top_k(std::vector<std::string> &batch, const SpaceSaving &tracker, const char *dimension,
+                      const char *metric, const std::string &timestamp);
 
     // Syscall utilities
     std::string get_syscall_name(int syscall_id);
     bool is_io_syscall(int syscall_id);
-    bool is_important_syscall(int syscall_id);
+    bool is_traced_syscall(int syscall_id);
+    bool load_syscall_filter();
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+struct z_stream_s;
+
+// Backslash the characters line protocol treats as tag separators
+std::string escape_tag(const std::string &value);
+
+// Float field value in its shortest exact form, ostream's 6 digits round
+// nanosecond totals
+std::string format_field(double value);
+
+// Line protocol batch that is encoded while it is built. Without
+// compression the lines are kept as separate chunks and streamed to the
+// socket as they are (newline-terminated on the wire). With a compression
+// level > 0 every added line is fed to a streaming gzip deflater whose
+// output is kept in bounded chunks, so the batch never exists uncompressed
+// and is never concatenated into one buffer.
+class LineBatch
+{
+private:
+    int compression_level_;
+    std::unique_ptr<z_stream_s> stream_; // heap allocated, zlib keeps a back pointer
+    std::vector<std::string> chunks_;
+    size_t lines_;
+    size_t raw_bytes_;
+    size_t encoded_bytes_;
+    bool finished_;
+
+    void deflate_chunk(const char *data, size_t size, int flush);
+    void init_stream();
+
+public:
+    explicit LineBatch(int compression_level = 0);
+    ~LineBatch();
+
+    LineBatch(LineBatch &&other) noexcept;
+    LineBatch &operator=(LineBatch &&other) noexcept;
+    LineBatch(const LineBatch &) = delete;
+    LineBatch &operator=(const LineBatch &) = delete;
+
+    // Append one line without its newline; pass an rvalue to avoid a copy
+    void add(std::string line);
+
+    // Complete the encoding, no lines can be added afterwards
+    void finish();
+
+    // Drop all lines and start a new batch with the same settings
+    void clear();
+
+    bool compressed() const { return compression_level_ > 0; }
+    bool empty() const { return lines_ == 0; }
+    size_t size() const { return lines_; }
+    size_t raw_bytes() const { return raw_bytes_; }
+    size_t encoded_bytes() const { return encoded_bytes_; }
+    double compression_ratio() const;
+
+    // Encoded payload as a list of chunks, valid after finish().
+    // Uncompressed chunks are lines that need a '\n' after each one.
+    const std::vector<std::string> &chunks() const { return chunks_; }
+    bool newline_terminated() const { return !compressed(); }
+    std::vector<std::string> release_chunks();
+};
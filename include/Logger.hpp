@@ -9,6 +9,22 @@
 #include <sstream>
 #include <unordered_map>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <format>
+#include "BinaryLog.hpp"
+#include "TimeSeriesStore.hpp"
+
+// Statements below this level compile to nothing when using the LOG_* macros.
+// Release builds keep INFO and above unless the build overrides it.
+#ifndef LOGGER_MIN_LEVEL
+#ifdef NDEBUG
+#define LOGGER_MIN_LEVEL 2 // LogLevel::INFO
+#else
+#define LOGGER_MIN_LEVEL 0 // LogLevel::TRACE
+#endif
+#endif
 
 enum class LogLevel
 {
@@ -24,18 +40,41 @@ class Logger
 {
 private:
     static std::mutex log_mutex_;
-    static LogLevel current_level_;
+    static std::atomic<LogLevel> current_level_;
     static std::unique_ptr<std::ofstream> file_stream_;
     static bool console_output_;
     static bool file_output_;
     static std::string log_filename_;
 
-    // Time series data storage
-    static std::unordered_map<std::string, std::vector<std::pair<std::chrono::system_clock::time_point, std::string>>> time_series_data_;
+    // Time series data storage, bounded per series and compressed
+    static TimeSeriesStore time_series_data_;
+    static void addTimeSeriesMessage(const std::string &key, std::chrono::system_clock::time_point time,
+                                     const std::string &message);
+
+    // Asynchronous mode: every thread owns a lock-free queue of records that a
+    // background thread drains, formats and writes in batches
+    struct AsyncRecord;
+    struct AsyncQueue;
+    static std::atomic<bool> async_enabled_;
+    static std::mutex async_mutex_;
+    static std::condition_variable async_cv_;
+    static std::vector<std::shared_ptr<AsyncQueue>> async_queues_;
+    static std::thread async_thread_;
+    static bool async_stopping_;
+    static uint64_t async_passes_;
+    static int async_flush_waiters_;
+    static std::vector<AsyncRecord> async_overflow_; // shared by threads whose queue is full
+    static std::atomic<uint64_t> async_overflows_;
 
     static std::string getCurrentTimestamp();
     static std::string levelToString(LogLevel level);
-    static void writeLog(LogLevel level, const std::string &message, const std::string &time_series_key = "");
+    static void openLogFile(const std::string &filename);
+    static void writeLog(LogLevel level, std::string message, const std::string &time_series_key = "");
+    static void writeEntries(std::vector<AsyncRecord> &records);
+    static AsyncQueue &threadQueue();
+    static bool pushOverflow(AsyncRecord &&record);
+    static size_t drainQueues(std::vector<AsyncRecord> &records);
+    static void asyncLoop();
 
 public:
     // Configuration methods
@@ -44,89 +83,126 @@ public:
     static void enableFileOutput(bool enable, const std::string &filename = "");
     static void setLogFile(const std::string &filename);
 
+    // Format and write on a background thread; callers only enqueue the message.
+    // Disable after the logging threads have stopped, FATAL is always flushed.
+    static void enableAsync(bool enable);
+    static bool isAsync() { return async_enabled_; }
+
+    // Write raw arguments to a binary file instead of text, rendered offline
+    // by ebpf-log-decoder. Empty path switches back to text output.
+    static bool enableBinaryOutput(const std::string &filename);
+
     // Logging methods
-    static void trace(const std::string &message, const std::string &time_series_key = "");
-    static void debug(const std::string &message, const std::string &time_series_key = "");
-    static void info(const std::string &message, const std::string &time_series_key = "");
-    static void warn(const std::string &message, const std::string &time_series_key = "");
-    static void error(const std::string &message, const std::string &time_series_key = "");
-    static void fatal(const std::string &message, const std::string &time_series_key = "");
+    static void trace(std::string message, const std::string &time_series_key = "");
+    static void debug(std::string message, const std::string &time_series_key = "");
+    static void info(std::string message, const std::string &time_series_key = "");
+    static void warn(std::string message, const std::string &time_series_key = "");
+    static void error(std::string message, const std::string &time_series_key = "");
+    static void fatal(std::string message, const std::string &time_series_key = "");
 
     // Time series methods
-    static void addTimeSeriesData(const std::string &key, const std::string &value);
-    static std::vector<std::pair<std::chrono::system_clock::time_point, std::string>>
-    getTimeSeriesData(const std::string &key);
+    // Blocks of ~512 bytes kept per series, points averaged per resolution, retention 0 keeps all blocks
+    static void configureTimeSeries(size_t blocks_per_series, std::chrono::milliseconds resolution,
+                                    std::chrono::seconds retention);
+    static void addTimeSeriesData(const std::string &key, double value);
+    static std::vector<std::pair<std::chrono::system_clock::time_point, double>>
+    getTimeSeriesData(const std::string &key,
+                      std::chrono::system_clock::time_point from = std::chrono::system_clock::time_point::min(),
+                      std::chrono::system_clock::time_point to = std::chrono::system_clock::time_point::max());
     static void clearTimeSeriesData(const std::string &key = "");
-    static void exportTimeSeriesToCSV(const std::string &filename, const std::string &key = "");
+    // Streams the points in [from, to] without copying the series
+    static void exportTimeSeriesToCSV(const std::string &filename, const std::string &key = "",
+                                      std::chrono::system_clock::time_point from = std::chrono::system_clock::time_point::min(),
+                                      std::chrono::system_clock::time_point to = std::chrono::system_clock::time_point::max());
 
     // Utility methods
     static void flush();
     static std::string getLogLevelString();
 
-    // Structured logging
-    template <typename... Args>
-    static void trace(const std::string &format, Args... args)
+    // Whether a statement at level would be written, checked before formatting
+    static bool enabled(LogLevel level)
     {
-        logFormatted(LogLevel::TRACE, format, args...);
+        return static_cast<int>(level) >= LOGGER_MIN_LEVEL &&
+               level >= current_level_.load(std::memory_order_relaxed);
     }
 
+    // Structured logging, format strings are checked at compile time
     template <typename... Args>
-    static void debug(const std::string &format, Args... args)
+    static void log(LogLevel level, std::format_string<Args...> format, Args &&...args)
     {
-        logFormatted(LogLevel::DEBUG, format, args...);
+        writeLog(level, std::format(format, std::forward<Args>(args)...));
     }
 
     template <typename... Args>
-    static void info(const std::string &format, Args... args)
+    static void trace(std::format_string<Args...> format, Args &&...args)
     {
-        logFormatted(LogLevel::INFO, format, args...);
+        if (enabled(LogLevel::TRACE))
+            log(LogLevel::TRACE, format, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    static void warn(const std::string &format, Args... args)
+    static void debug(std::format_string<Args...> format, Args &&...args)
     {
-        logFormatted(LogLevel::WARN, format, args...);
+        if (enabled(LogLevel::DEBUG))
+            log(LogLevel::DEBUG, format, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    static void error(const std::string &format, Args... args)
+    static void info(std::format_string<Args...> format, Args &&...args)
     {
-        logFormatted(LogLevel::ERROR, format, args...);
+        if (enabled(LogLevel::INFO))
+            log(LogLevel::INFO, format, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    static void fatal(const std::string &format, Args... args)
+    static void warn(std::format_string<Args...> format, Args &&...args)
     {
-        logFormatted(LogLevel::FATAL, format, args...);
+        if (enabled(LogLevel::WARN))
+            log(LogLevel::WARN, format, std::forward<Args>(args)...);
     }
 
-private:
     template <typename... Args>
-    static void logFormatted(LogLevel level, const std::string &format, Args... args)
+    static void error(std::format_string<Args...> format, Args &&...args)
     {
-        if (level < current_level_)
-            return;
-
-        std::ostringstream ss;
-        formatMessage(ss, format, args...);
-        writeLog(level, ss.str());
+        if (enabled(LogLevel::ERROR))
+            log(LogLevel::ERROR, format, std::forward<Args>(args)...);
     }
 
-    template <typename T, typename... Args>
-    static void formatMessage(std::ostringstream &ss, const std::string &format, T value, Args... args)
+    template <typename... Args>
+    static void fatal(std::format_string<Args...> format, Args &&...args)
     {
-        size_t pos = format.find("{}");
-        if (pos == std::string::npos)
-        {
-            ss << format;
-            return;
-        }
-        ss << format.substr(0, pos) << value;
-        formatMessage(ss, format.substr(pos + 2), args...);
+        log(LogLevel::FATAL, format, std::forward<Args>(args)...);
     }
+};
 
-    static void formatMessage(std::ostringstream &ss, const std::string &format)
-    {
-        ss << format;
-    }
-};
\ No newline at end of file
+// Level checked before the arguments are evaluated, statements below
+// LOGGER_MIN_LEVEL are discarded at compile time. In binary mode every
+// statement is a site registered on first use, only its arguments are stored.
+#define LOG_AT(level, ...)                                                                           \
+    do                                                                                               \
+    {                                                                                                \
+        if constexpr (static_cast<int>(level) >= LOGGER_MIN_LEVEL)                                   \
+        {                                                                                            \
+            if (Logger::enabled(level))                                                              \
+            {                                                                                        \
+                if (BinaryLog::isOpen())                                                             \
+                {                                                                                    \
+                    static BinaryLogSite log_site_{static_cast<uint8_t>(level), __FILE__, __LINE__}; \
+                    BinaryLog::write(log_site_, __VA_ARGS__);                                        \
+                    if constexpr (level == LogLevel::FATAL)                                          \
+                        BinaryLog::flush();                                                          \
+                }                                                                                    \
+                else                                                                                 \
+                {                                                                                    \
+                    Logger::log(level, __VA_ARGS__);                                                 \
+                }                                                                                    \
+            }                                                                                        \
+        }                                                                                            \
+    } while (0)
+
+#define LOG_TRACE(...) LOG_AT(LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+#define LOG_FATAL(...) LOG_AT(LogLevel::FATAL, __VA_ARGS__)
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include "MetricSink.hpp"
+
+#define METRIC_BATCHER_DEFAULT_MAX_LINES 5000
+#define METRIC_BATCHER_DEFAULT_MAX_BYTES (1024 * 1024)
+#define METRIC_BATCHER_DEFAULT_MAX_DELAY_MS 1000
+
+// Collects single lines into batches for a MetricFanout. A batch is published
+// once it holds max_lines or max_bytes, or by the background thread max_delay
+// after its first line, so producers never wait on an export round trip.
+class MetricBatcher
+{
+private:
+    MetricFanout &sinks_;
+    bool aggregated_;
+    size_t max_lines_;
+    size_t max_bytes_;
+    std::chrono::milliseconds max_delay_;
+
+    std::vector<std::string> pending_;
+    size_t pending_bytes_;
+    std::chrono::steady_clock::time_point first_line_time_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_;
+
+    uint64_t size_flushes_;
+    uint64_t time_flushes_;
+    uint64_t lines_;
+
+    // Takes the pending batch, mutex_ held
+    std::vector<std::string> take();
+    void worker_loop();
+
+public:
+    MetricBatcher(MetricFanout &sinks, bool aggregated = false,
+                  size_t max_lines = METRIC_BATCHER_DEFAULT_MAX_LINES,
+                  size_t max_bytes = METRIC_BATCHER_DEFAULT_MAX_BYTES,
+                  std::chrono::milliseconds max_delay = std::chrono::milliseconds(METRIC_BATCHER_DEFAULT_MAX_DELAY_MS));
+    ~MetricBatcher();
+
+    MetricBatcher(const MetricBatcher &) = delete;
+    MetricBatcher &operator=(const MetricBatcher &) = delete;
+
+    bool start();
+    // Publish what is pending, then stop the flush thread
+    void stop();
+
+    void add(std::string line);
+    void add(std::vector<std::string> lines);
+    // Publish the pending lines now
+    void flush();
+
+    void report(const std::string &name) const;
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+
+class InfluxClient;
+
+// Line protocol encoded once by the producer and shared read-only by every sink
+struct MetricBatch
+{
+    std::vector<std::string> lines; // without trailing newlines
+    bool aggregated = false;        // per-interval aggregates rather than raw events
+};
+using MetricBatchPtr = std::shared_ptr<const MetricBatch>;
+
+// Destination for metric batches. Every sink drains its own bounded queue on
+// its own worker thread, so a slow backend only delays itself; when the queue
+// is full the oldest batch is diverted (see divert()) or dropped instead of
+// blocking the producer.
+class MetricSink
+{
+private:
+    std::string name_;
+    bool wants_events_;
+    size_t max_queued_;
+
+    std::deque<MetricBatchPtr> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_;
+    bool busy_;
+
+    std::atomic<uint64_t> delivered_;
+    std::atomic<uint64_t> failed_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> diverted_;
+
+    void worker_loop();
+
+protected:
+    // Called on the worker thread for every queued batch
+    virtual bool deliver(const MetricBatchPtr &batch) = 0;
+    // Called on the producer's thread for a batch pushed out of a full queue;
+    // returns true when it was kept elsewhere (e.g. spooled to disk)
+    virtual bool divert(const MetricBatchPtr &) { return false; }
+
+public:
+    MetricSink(const std::string &name, bool wants_events = true, size_t max_queued = 64);
+    // Derived sinks call stop() in their destructor, before their state goes away
+    virtual ~MetricSink();
+
+    MetricSink(const MetricSink &) = delete;
+    MetricSink &operator=(const MetricSink &) = delete;
+
+    virtual bool start();
+    // Deliver what is still queued, then stop the worker
+    virtual void stop();
+
+    void submit(const MetricBatchPtr &batch);
+    // Wait until every submitted batch has been delivered
+    void flush();
+
+    const std::string &name() const { return name_; }
+    // Sinks such as the Prometheus endpoint only take aggregates
+    bool wants_events() const { return wants_events_; }
+    uint64_t delivered() const { return delivered_; }
+    uint64_t failed() const { return failed_; }
+    uint64_t dropped() const { return dropped_; }
+    uint64_t diverted() const { return diverted_; }
+};
+
+// Hands each batch, encoded once, to every registered sink
+class MetricFanout
+{
+private:
+    std::vector<std::unique_ptr<MetricSink>> sinks_;
+
+public:
+    void add(std::unique_ptr<MetricSink> sink) { sinks_.push_back(std::move(sink)); }
+    bool empty() const { return sinks_.empty(); }
+
+    bool start();
+    void stop();
+    void flush();
+
+    void publish(std::vector<std::string> lines, bool aggregated);
+    void report() const;
+};
+
+// Add sinks from a comma-separated list: influx, stdout, file:<path>, prometheus[:<port>].
+// prometheus_gzip lets the endpoint answer with a gzip encoded snapshot.
+bool add_sinks_from_spec(MetricFanout &fanout, const std::string &spec, InfluxClient &influx,
+                         bool prometheus_gzip = true);
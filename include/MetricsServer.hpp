@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// Minimal HTTP server for Prometheus scrapes. The exposition text is rendered
+// once per aggregation interval and published as an immutable snapshot (plus
+// its gzip encoding); scrapers only copy a pointer to the current snapshot,
+// so serving never touches the collector's data structures.
+class MetricsServer
+{
+private:
+    struct Snapshot
+    {
+        std::string text;
+        std::string gzip;
+    };
+
+    int port_;
+    bool gzip_;
+    int listen_fd_;
+    int wake_fd_;
+    std::atomic<bool> running_;
+    std::thread serve_thread_;
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    std::atomic<uint64_t> scrapes_;
+
+    void serve_loop();
+    void handle_connection(int fd);
+
+public:
+    explicit MetricsServer(int port = 9400, bool gzip = true);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    bool start();
+    void stop();
+
+    // Replace the served payload, encoded once here rather than per scrape
+    void publish(std::string text);
+
+    int port() const { return port_; }
+    uint64_t scrapes() const { return scrapes_; }
+};
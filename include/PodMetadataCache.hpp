@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+
+struct PodInfo
+{
+    std::string pod;
+    std::string container;
+    std::string namespace_name;
+};
+using PodInfoPtr = std::shared_ptr<const PodInfo>;
+
+// Pod, container and namespace of processes and cgroups, shared by every
+// probe. Process entries are read from /proc/<pid>/cgroup on first lookup
+// and dropped by refresh() since pids get reused; cgroup entries come from
+// walking the kubepods hierarchy in refresh(). Safe to use from any thread.
+class PodMetadataCache
+{
+private:
+    std::string proc_root_;
+    std::string cgroup_root_;
+    std::unordered_map<uint32_t, PodInfoPtr> by_pid_;
+    std::unordered_map<uint64_t, PodInfoPtr> by_cgroup_;
+    PodInfoPtr unknown_;
+    std::atomic<uint64_t> generation_;
+    mutable std::shared_mutex mutex_;
+
+    PodInfoPtr read_pid(uint32_t pid) const;
+
+public:
+    explicit PodMetadataCache(const std::string &proc_root = "/proc",
+                              const std::string &cgroup_root = "/sys/fs/cgroup");
+
+    PodInfoPtr for_pid(uint32_t pid);
+    // Cgroups created since the last refresh() are unknown
+    PodInfoPtr for_cgroup(uint64_t cgroup_id) const;
+
+    void refresh();
+    // Bumped by every refresh(), copies of entries are stale once it changes
+    uint64_t generation() const { return generation_; }
+    size_t pid_count() const;
+    size_t cgroup_count() const;
+
+    // "pod-<uid prefix>" from a cgroup path, "unknown" when it is not a pod
+    static std::string pod_from_cgroup(const std::string &cgroup_path);
+    // "container-<id prefix>" from a cgroup path, empty when there is none
+    static std::string container_from_cgroup(const std::string &cgroup_path);
+};
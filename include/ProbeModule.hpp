@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "AgentLoop.hpp"
+#include "PodMetadataCache.hpp"
+#include "InfluxClient.hpp"
+#include "MetricSink.hpp"
+
+// What the agent shares with its probe modules: one event loop, one
+// metadata cache and one exporter instead of one of each per probe
+struct AgentContext
+{
+    AgentLoop &loop;
+    PodMetadataCache &metadata;
+    InfluxClient &influx;
+    MetricFanout &sinks;
+};
+
+// A probe family run by the agent. start() loads the probes and registers
+// fds and timers on the loop; stop() runs once the loop has returned.
+class ProbeModule
+{
+public:
+    virtual ~ProbeModule() = default;
+
+    virtual const char *name() const = 0;
+    virtual bool start(AgentContext &context) = 0;
+    virtual void stop() = 0;
+};
+
+// Create modules from a comma-separated list: cpu, memory, syscall_latency, runqueue_latency,
+// syscall_frequency. The probes of the K8s collector (all but syscall_frequency) share one module.
+bool make_probe_modules(const std::string &spec, std::vector<std::unique_ptr<ProbeModule>> &modules);
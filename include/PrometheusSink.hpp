@@ -0,0 +1,49 @@
+#pragma once
+#include <map>
+#include <chrono>
+#include "MetricSink.hpp"
+#include "MetricsServer.hpp"
+#include "ChangeFilter.hpp"
+
+// Longer than the change filter heartbeat, so suppressed series keep their value
+#define PROMETHEUS_SERIES_TTL_S (2 * CHANGE_FILTER_DEFAULT_MAX_SILENCE_S)
+
+// Serves aggregate series on a /metrics endpoint. Every batch is converted
+// from line protocol on the sink thread and merged into the series seen so
+// far, each keeping its last value until it is not updated for series_ttl;
+// the merged text is published as the snapshot scrapers read.
+class PrometheusSink : public MetricSink
+{
+private:
+    struct Sample
+    {
+        std::string value;
+        std::chrono::steady_clock::time_point updated;
+    };
+    // Family name -> sample (name and labels) -> last value
+    using Families = std::map<std::string, std::map<std::string, Sample>>;
+
+    MetricsServer server_;
+    std::chrono::seconds series_ttl_;
+    Families families_; // only used on the worker thread
+
+    static void merge(Families &families, const std::vector<std::string> &lines,
+                      std::chrono::steady_clock::time_point now);
+    static std::string render(const Families &families);
+
+protected:
+    bool deliver(const MetricBatchPtr &batch) override;
+
+public:
+    explicit PrometheusSink(int port = 9400, bool gzip = true,
+                            std::chrono::seconds series_ttl = std::chrono::seconds(PROMETHEUS_SERIES_TTL_S));
+    ~PrometheusSink() override;
+
+    bool start() override;
+    void stop() override;
+
+    // Numeric fields become gauges named <measurement>_<field>. For lines
+    // tagged metric= they are <measurement>_<metric> for the "value" field and
+    // <measurement>_<metric>_<field> for the others, e.g. topk_cpu_time_ns_error
+    static std::string render(const std::vector<std::string> &lines);
+};
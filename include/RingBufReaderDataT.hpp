@@ -7,6 +7,7 @@
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
 #include "Logger.hpp"
+#include "RingBufStats.hpp"
 
 struct data_t
 {
@@ -24,6 +25,8 @@ private:
     struct ring_buffer *rb;
     std::atomic<bool> running;
     std::thread read_thread;
+    int drain_interval_ms;
+    RingBufStats stats;
 
     static int handle_ringbuf_event(void *ctx, void *data, size_t size);
 
@@ -34,12 +37,19 @@ public:
     ~RingBufReaderDataT();
 
     bool open();
+    // Open from a map fd owned by someone else (e.g. BpfLoader)
+    bool open(int fd);
     void close();
     void start_reading(EventCallback callback);
     void stop_reading();
     bool is_running() const { return running; }
 
+    // Probes only wake us past their watermark, the rest is drained on this timer
+    void set_drain_interval(int interval_ms) { drain_interval_ms = interval_ms; }
+    const RingBufStats &get_stats() const { return stats; }
+
 private:
     EventCallback user_callback;
     void read_loop();
+    bool open_ring_buffer();
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
 #include "Logger.hpp"
+#include "RingBufStats.hpp"
 
 // CPU event structure
 struct cpu_event
@@ -61,6 +62,8 @@ private:
     struct ring_buffer *rb;
     std::atomic<bool> running;
     std::thread read_thread;
+    int drain_interval_ms;
+    RingBufStats stats;
 
     static int handle_cpu_event(void *ctx, void *data, size_t size);
     static int handle_memory_event(void *ctx, void *data, size_t size);
@@ -70,6 +73,7 @@ public:
     using CpuEventCallback = std::function<void(const cpu_event &)>;
     using MemoryEventCallback = std::function<void(const memory_event &)>;
     using SyscallLatencyCallback = std::function<void(const syscall_latency_event &)>;
+    using TickCallback = std::function<void()>;
 
     RingBufReaderK8s(const std::string &cpu_pinned_path = "/sys/fs/bpf/cpu_events",
                      const std::string &memory_pinned_path = "/sys/fs/bpf/memory_events",
@@ -77,6 +81,8 @@ public:
     ~RingBufReaderK8s();
 
     bool open();
+    // Open from map fds owned by someone else (e.g. BpfLoader)
+    bool open(int cpu_fd, int memory_fd, int syscall_latency_fd);
     void close();
     void start_reading(CpuEventCallback cpu_callback, 
                       MemoryEventCallback memory_callback,
@@ -84,9 +90,26 @@ public:
     void stop_reading();
     bool is_running() const { return running; }
 
+    // Event loop mode, no reader thread: poll epoll_fd() and call consume() when
+    // it is readable and on a drain timer; callbacks run inside consume()
+    void set_callbacks(CpuEventCallback cpu_callback,
+                       MemoryEventCallback memory_callback,
+                       SyscallLatencyCallback syscall_latency_callback = nullptr);
+    int epoll_fd() const;
+    void consume();
+
+    // Probes only wake us past their watermark, the rest is drained on this timer
+    void set_drain_interval(int interval_ms) { drain_interval_ms = interval_ms; }
+    const RingBufStats &get_stats() const { return stats; }
+
+    // Called on the reader thread after every poll, at least once per drain interval (call before start_reading())
+    void set_tick_callback(TickCallback callback) { tick_callback = std::move(callback); }
+
 private:
     CpuEventCallback cpu_callback;
     MemoryEventCallback memory_callback;
     SyscallLatencyCallback syscall_latency_callback;
+    TickCallback tick_callback;
     void read_loop();
+    bool open_ring_buffers();
 };
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <sys/resource.h>
+#include "Logger.hpp"
+
+// Consumer-side counters for a ring buffer read loop, used to check how
+// many wakeups and context switches each event costs.
+struct RingBufStats
+{
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> wakeups{0};      // poll returned because the kernel woke us
+    std::atomic<uint64_t> timer_drains{0}; // poll timed out and we drained the tail
+    std::atomic<uint64_t> context_switches{0};
+
+    // Context switches of the calling (read loop) thread
+    static uint64_t thread_context_switches()
+    {
+        struct rusage usage;
+        if (getrusage(RUSAGE_THREAD, &usage) != 0)
+            return 0;
+        return usage.ru_nvcsw + usage.ru_nivcsw;
+    }
+
+    void report(const std::string &name) const
+    {
+        uint64_t n = events.load();
+        double per_event = n > 0 ? 1.0 / n : 0.0;
+        Logger::info(name + " ring buffer: " + std::to_string(n) + " events, " +
+                     std::to_string(wakeups.load()) + " wakeups (" +
+                     std::to_string(wakeups.load() * per_event) + "/event), " +
+                     std::to_string(timer_drains.load()) + " timer drains, " +
+                     std::to_string(context_switches.load() * per_event) + " context switches/event");
+    }
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <bpf/bpf.h>
+
+// Must match ebpf/runqueue_latency.bpf.c
+#define RUNQUEUE_LATENCY_SLOTS 32
+
+// Log2 histogram of run-queue delays, slot i counts [2^i, 2^(i+1)) us (slot 0 from 0)
+struct runqueue_histogram
+{
+    __u64 slots[RUNQUEUE_LATENCY_SLOTS];
+    __u64 count;
+    __u64 sum_ns;
+
+    void merge(const runqueue_histogram &other);
+    // Delay in us below which a share q of the samples fall, interpolated within the slot
+    double percentile_us(double q) const;
+    double average_us() const { return count ? sum_ns / 1000.0 / count : 0; }
+};
+
+// Reads the per-CPU, per-cgroup histograms the run-queue probe keeps in the
+// kernel. The map is cumulative; sample() returns what was added since the
+// previous call and removes cgroups that saw no scheduling, so exited
+// containers do not fill the map.
+class RunqueueLatencyReader
+{
+private:
+    int map_fd;
+    std::vector<runqueue_histogram> percpu_values;
+    std::unordered_map<__u64, runqueue_histogram> previous;
+
+    bool read(__u64 cgroup_id, runqueue_histogram &total);
+
+public:
+    // Uses a map fd owned by someone else (e.g. BpfLoader)
+    explicit RunqueueLatencyReader(int histogram_fd);
+    ~RunqueueLatencyReader();
+
+    RunqueueLatencyReader(const RunqueueLatencyReader &) = delete;
+    RunqueueLatencyReader &operator=(const RunqueueLatencyReader &) = delete;
+
+    bool is_open() const { return map_fd >= 0; }
+
+    // Histograms of the delays since the previous call, by cgroup id. Not
+    // thread safe, callers serialize reads (the collector under its flush lock)
+    std::unordered_map<__u64, runqueue_histogram> sample();
+};
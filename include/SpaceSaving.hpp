@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Weighted Space-Saving heavy hitters (Metwally et al.) in fixed memory.
+// Up to capacity keys are counted; a new key replaces the smallest counter
+// and inherits its count as error, so estimates never undercount. Every key
+// whose true weight exceeds total / capacity is guaranteed to be tracked.
+class SpaceSaving
+{
+public:
+    struct Entry
+    {
+        std::string key;
+        double count; // upper bound of the key's weight
+        double error; // count - error is a lower bound
+    };
+
+private:
+    std::vector<Entry> heap_; // min-heap on count
+    std::unordered_map<std::string, size_t> index_;
+    size_t capacity_;
+    double total_;
+
+    void sift_down(size_t i);
+    double floor() const;
+    void swap_entries(size_t a, size_t b);
+
+public:
+    explicit SpaceSaving(size_t capacity = 128);
+
+    void add(const std::string &key, double weight = 1);
+    // Fold in a summary of other weights (mergeable summaries, Agarwal et al.),
+    // bounds stay valid and the capacity is kept
+    void merge(const SpaceSaving &other);
+
+    // The k largest estimates, largest first
+    std::vector<Entry> top(size_t k) const;
+    // Weight of every key, tracked or not
+    double total() const { return total_; }
+
+    void clear();
+    size_t capacity() const { return capacity_; }
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <memory>
+#include "ProbeModule.hpp"
+#include "BpfLoader.hpp"
+#include "BpfSyscallFrequencyReader.hpp"
+
+#define SYSCALL_FREQUENCY_INTERVAL_MS 2000
+
+// Per-syscall counts and rates, plus per-pod counts from the per-cgroup
+// map, sampled on a loop timer
+class SyscallFrequencyModule : public ProbeModule
+{
+private:
+    AgentContext *context_;
+    BpfLoader bpf_loader_;
+    std::unique_ptr<BpfSyscallFrequencyReader> reader_;
+    bool per_cgroup_;
+
+    void sample();
+
+public:
+    SyscallFrequencyModule() : context_(nullptr), per_cgroup_(false) {}
+
+    const char *name() const override { return "syscall_frequency"; }
+    bool start(AgentContext &context) override;
+    void stop() override;
+};
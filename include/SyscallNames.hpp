@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+
+// Highest syscall number (exclusive) tracked by the syscall probes,
+// must match MAX_SYSCALL_NR in ebpf/syscall_*.bpf.c
+#define MAX_SYSCALL_NR 512
+
+// Name of an x86_64 syscall, or "syscall_<id>" when unknown
+std::string get_syscall_name(int syscall_id);
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#define TIME_SERIES_BLOCK_BYTES 512
+#define TIME_SERIES_MAX_POINT_BITS 160 // worst case timestamp plus value encoding
+
+// Points compressed as in Facebook's Gorilla: delta-of-delta millisecond
+// timestamps and XOR-ed doubles, in a fixed-size bit buffer
+class TimeSeriesBlock
+{
+private:
+    std::array<uint8_t, TIME_SERIES_BLOCK_BYTES> data_;
+    size_t bits_;
+    uint32_t count_;
+    int64_t first_ms_;
+    int64_t last_ms_;
+    int64_t last_delta_;
+    uint64_t last_value_;
+    uint8_t last_leading_;
+    uint8_t last_trailing_;
+
+    void write_bits(uint64_t value, int bits);
+
+public:
+    TimeSeriesBlock() { reset(); }
+
+    void reset();
+    // False when the block is full, the caller starts a new one
+    bool append(int64_t ms, double value);
+    void for_each(const std::function<void(int64_t ms, double value)> &callback) const;
+
+    uint32_t count() const { return count_; }
+    int64_t first_ms() const { return first_ms_; }
+    int64_t last_ms() const { return last_ms_; }
+    size_t bytes_used() const { return (bits_ + 7) / 8; }
+};
+
+// Fixed-memory store of numeric series. Every series is a ring of compressed
+// blocks, the oldest block is recycled when the ring is full or its points
+// are older than the retention. Points can be downsampled to a resolution,
+// each stored point is then the mean of its interval.
+class TimeSeriesStore
+{
+public:
+    using Clock = std::chrono::system_clock;
+    using PointCallback = std::function<void(Clock::time_point time, double value)>;
+
+private:
+    struct Series
+    {
+        std::vector<TimeSeriesBlock> blocks; // ring, grown up to blocks_per_series_
+        size_t oldest = 0;
+        // Downsampling bucket not yet stored
+        int64_t bucket_ms = 0;
+        double bucket_sum = 0;
+        uint32_t bucket_count = 0;
+    };
+
+    std::unordered_map<std::string, Series> series_;
+    size_t blocks_per_series_;
+    size_t max_series_;
+    int64_t resolution_ms_;
+    int64_t retention_ms_;
+    uint64_t rejected_series_;
+
+    void store(Series &series, int64_t ms, double value);
+    void expire(Series &series, int64_t now_ms);
+    void visit(const Series &series, int64_t from_ms, int64_t to_ms, const PointCallback &callback, size_t *points) const;
+
+public:
+    explicit TimeSeriesStore(size_t blocks_per_series = 16, size_t max_series = 1024);
+
+    // resolution 0 keeps every point, retention 0 only bounds by block count
+    void configure(size_t blocks_per_series, std::chrono::milliseconds resolution, std::chrono::seconds retention);
+
+    // False when the series limit keeps a new key out
+    bool add(const std::string &key, Clock::time_point time, double value);
+
+    // Decode the points of key within [from, to] in time order, returns their number
+    size_t query(const std::string &key, Clock::time_point from, Clock::time_point to,
+                 const PointCallback &callback) const;
+    std::vector<std::string> keys() const;
+
+    void clear(const std::string &key = "");
+    size_t memory_bytes() const;
+    uint64_t rejected_series() const { return rejected_series_; }
+};
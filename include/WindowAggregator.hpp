@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#define WINDOW_GRACE_NS 250000000 // events still in the ring buffers when a window ends
+
+// Totals of one series over a window
+struct RollupCounters
+{
+    double cpu_ns = 0;
+    double syscalls = 0;
+    double syscall_latency_ns = 0;
+    double io_ops = 0;
+    double io_latency_ns = 0;
+    double memory_alloc_kb = 0;
+    double memory_free_kb = 0;
+
+    void merge(const RollupCounters &other);
+};
+
+struct RollupSeries
+{
+    std::string pod;
+    std::string container;
+    std::string namespace_name;
+    RollupCounters counters;
+};
+
+// A closed window with every series that had events in it
+struct RollupWindow
+{
+    int64_t start_ns;
+    int64_t window_ns;
+    int64_t duration_ns; // time covered, shorter than the window before the first and after the last event
+    const std::unordered_map<std::string, RollupSeries> &series;
+};
+
+// Tumbling windows over event time. Events go into windows of the smallest
+// duration; longer windows are rolled up from those as they close, so each
+// event is counted once whatever the number of durations.
+class WindowAggregator
+{
+public:
+    using WindowCallback = std::function<void(const RollupWindow &window)>;
+
+private:
+    struct Level
+    {
+        int64_t duration_ns;
+        std::map<int64_t, std::unordered_map<std::string, RollupSeries>> open; // by window start
+    };
+
+    std::vector<Level> levels_; // ascending durations, multiples of the first
+    int64_t closed_until_ns_;   // end of the last closed base window
+    int64_t first_ns_;          // first event seen, windows before it are partial
+    int64_t newest_ns_;
+    uint64_t late_events_;
+
+    int64_t covered(int64_t start_ns, int64_t duration_ns, int64_t limit_ns) const;
+    void close_base(int64_t start_ns, std::unordered_map<std::string, RollupSeries> &series, int64_t limit_ns,
+                    const WindowCallback &callback);
+    void close_levels(int64_t until_ns, int64_t limit_ns, const WindowCallback &callback);
+
+public:
+    WindowAggregator();
+
+    // Durations are rounded up to multiples of the smallest one, empty disables
+    void configure(std::vector<std::chrono::seconds> durations);
+    bool enabled() const { return !levels_.empty(); }
+
+    // Counters of the series in the window holding time_ns; events older than
+    // the last closed window count towards the oldest open one
+    RollupCounters &at(int64_t time_ns, const std::string &pod, const std::string &container,
+                       const std::string &namespace_name);
+
+    // Close every window ended before now_ns, minus the grace period
+    void advance(int64_t now_ns, const WindowCallback &callback);
+    // Close all windows, partial ones included (on shutdown)
+    void flush(const WindowCallback &callback);
+
+    uint64_t late_events() const { return late_events_; }
+    std::vector<std::chrono::seconds> durations() const;
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <span>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <condition_variable>
+#include "InfluxClient.hpp"
+
+#define SPOOL_RECORD_MAGIC 0x314c5053 // "SPL1" little endian
+#define SPOOL_RECORD_GZIP 0x1
+#define SPOOL_RECORD_PRECISION_SHIFT 8 // InfluxClient::Precision in bits 8-15
+
+// Fixed little-endian header in front of every record. Records are padded to
+// 8 bytes, so a mapped segment can be walked with aligned header reads.
+struct spool_record_header
+{
+    uint32_t magic;
+    uint32_t flags;
+    uint64_t length; // payload bytes, excluding header and padding
+    uint32_t crc;    // crc32 of the payload
+    uint32_t reserved;
+};
+
+// Bounded on-disk spool for InfluxDB write bodies that could not be delivered.
+// Bodies are appended to fixed-size segment files; a replayer maps the oldest
+// segment once the backend answers ping() again and resends it at a limited
+// rate. When the spool is full the oldest segment is dropped.
+class WriteSpool
+{
+private:
+    struct Segment
+    {
+        uint64_t seq;
+        std::string path;
+        size_t bytes;
+        size_t replayed; // offset of the next record to resend
+    };
+
+    std::string dir_;
+    size_t max_bytes_;
+    size_t segment_bytes_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Segment> segments_; // oldest first, the last one is appended to
+    int active_fd_;
+    uint64_t next_seq_;
+    size_t total_bytes_;
+    uint64_t replaying_seq_; // segment mapped by the replayer, never dropped
+
+    std::atomic<bool> replaying_;
+    std::thread replay_thread_;
+
+    std::atomic<uint64_t> spooled_batches_;
+    std::atomic<uint64_t> replayed_batches_;
+    std::atomic<uint64_t> dropped_bytes_;
+    std::atomic<uint64_t> dropped_records_; // refused by the backend on replay
+
+    bool roll_segment();
+    void seal_active_segment();
+    bool make_room(size_t bytes);
+    void replay_loop(InfluxClient &client, size_t bytes_per_sec);
+    bool replay_segment(InfluxClient &client, Segment segment, size_t bytes_per_sec);
+    bool wait_for(std::chrono::steady_clock::time_point deadline);
+    std::string segment_path(uint64_t seq) const;
+
+public:
+    explicit WriteSpool(const std::string &dir,
+                        size_t max_bytes = 512 * 1024 * 1024,
+                        size_t segment_bytes = 16 * 1024 * 1024);
+    ~WriteSpool();
+
+    WriteSpool(const WriteSpool &) = delete;
+    WriteSpool &operator=(const WriteSpool &) = delete;
+
+    // Create the directory and pick up segments left by a previous run
+    bool open();
+    void close();
+
+    // Append one encoded write body given as chunks, optionally newline-terminated
+    bool append(std::span<const std::string> chunks, bool newline_terminated, bool gzip,
+                InfluxClient::Precision precision = InfluxClient::Precision::NS);
+
+    // Resend spooled bodies through client, at most bytes_per_sec
+    void start_replay(InfluxClient &client, size_t bytes_per_sec = 1024 * 1024);
+    void stop_replay();
+
+    size_t size_bytes();
+    uint64_t spooled_batches() const { return spooled_batches_; }
+    uint64_t replayed_batches() const { return replayed_batches_; }
+    uint64_t dropped_bytes() const { return dropped_bytes_; }
+    uint64_t dropped_records() const { return dropped_records_; }
+};
@@ -0,0 +1,163 @@
+#include "AgentLoop.hpp"
+#include "Logger.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define AGENT_LOOP_MAX_EVENTS 64
+
+AgentLoop::AgentLoop() : epoll_fd_(-1), wake_fd_(-1), running_(false), stopping_(false)
+{
+}
+
+AgentLoop::~AgentLoop()
+{
+    close();
+}
+
+bool AgentLoop::open()
+{
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0)
+    {
+        Logger::error("Failed to create epoll instance: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0)
+    {
+        Logger::error("Failed to create loop wakeup eventfd: " + std::string(strerror(errno)));
+        close();
+        return false;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // the wakeup fd
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) < 0)
+    {
+        Logger::error("Failed to watch loop wakeup eventfd: " + std::string(strerror(errno)));
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AgentLoop::close()
+{
+    for (auto &handler : handlers_)
+    {
+        if (handler->timer)
+            ::close(handler->fd);
+    }
+    handlers_.clear();
+
+    if (wake_fd_ >= 0)
+    {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0)
+    {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+bool AgentLoop::watch(std::unique_ptr<Handler> handler)
+{
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = handler.get();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, handler->fd, &event) < 0)
+    {
+        Logger::error("Failed to watch fd " + std::to_string(handler->fd) + ": " + strerror(errno));
+        return false;
+    }
+    handlers_.push_back(std::move(handler));
+    return true;
+}
+
+bool AgentLoop::add_fd(int fd, Callback on_readable)
+{
+    if (epoll_fd_ < 0 || fd < 0)
+        return false;
+    return watch(std::make_unique<Handler>(Handler{fd, false, std::move(on_readable)}));
+}
+
+bool AgentLoop::add_timer(std::chrono::milliseconds interval, Callback on_expiry)
+{
+    if (epoll_fd_ < 0 || interval.count() <= 0)
+        return false;
+
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0)
+    {
+        Logger::error("Failed to create timerfd: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = interval.count() / 1000;
+    spec.it_interval.tv_nsec = (interval.count() % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0 ||
+        !watch(std::make_unique<Handler>(Handler{fd, true, std::move(on_expiry)})))
+    {
+        ::close(fd);
+        return false;
+    }
+    return true;
+}
+
+void AgentLoop::run()
+{
+    running_ = true;
+    struct epoll_event events[AGENT_LOOP_MAX_EVENTS];
+
+    while (!stopping_)
+    {
+        int count = epoll_wait(epoll_fd_, events, AGENT_LOOP_MAX_EVENTS, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            Logger::error("epoll_wait failed: " + std::string(strerror(errno)));
+            break;
+        }
+
+        for (int i = 0; i < count && !stopping_; i++)
+        {
+            Handler *handler = static_cast<Handler *>(events[i].data.ptr);
+            if (!handler)
+                continue; // woken by stop()
+
+            if (handler->timer)
+            {
+                // Missed expirations are folded into one call
+                uint64_t expirations;
+                if (read(handler->fd, &expirations, sizeof(expirations)) < 0)
+                    continue;
+            }
+            handler->callback();
+        }
+    }
+    running_ = false;
+}
+
+void AgentLoop::stop()
+{
+    stopping_ = true;
+    if (wake_fd_ >= 0)
+    {
+        uint64_t one = 1;
+        if (write(wake_fd_, &one, sizeof(one)) < 0)
+        {
+            Logger::warn("Failed to wake the agent loop");
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include "BatchTuner.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+
+// Weight of the newest sample in the latency average
+static const double latency_ewma_weight = 0.2;
+
+BatchTuner::BatchTuner(size_t initial_batch_size, std::chrono::milliseconds initial_flush_interval)
+    : batch_size_(initial_batch_size),
+      flush_interval_ms_(initial_flush_interval.count()),
+      min_batch_size_(100),
+      max_batch_size_(20000),
+      batch_size_step_(100),
+      min_flush_interval_ms_(1000),
+      max_flush_interval_ms_(30000),
+      flush_interval_step_ms_(500),
+      target_latency_ms_(250.0),
+      latency_ewma_ms_(0.0)
+{
+}
+
+void BatchTuner::set_target_latency(std::chrono::milliseconds latency)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    target_latency_ms_ = static_cast<double>(latency.count());
+}
+
+void BatchTuner::set_batch_size_limits(size_t min_size, size_t max_size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    min_batch_size_ = std::max<size_t>(1, min_size);
+    max_batch_size_ = std::max(min_batch_size_, max_size);
+    batch_size_ = std::clamp(batch_size_.load(), min_batch_size_, max_batch_size_);
+}
+
+double BatchTuner::latency_ewma_ms()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latency_ewma_ms_;
+}
+
+void BatchTuner::increase()
+{
+    batch_size_ = std::min(batch_size_ + batch_size_step_, max_batch_size_);
+    flush_interval_ms_ = std::max(flush_interval_ms_ - flush_interval_step_ms_, min_flush_interval_ms_);
+}
+
+void BatchTuner::decrease()
+{
+    // One decrease per congestion event: later answers still reflect the old size
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_decrease_ < flush_interval())
+        return;
+    last_decrease_ = now;
+
+    batch_size_ = std::max(batch_size_ / 2, min_batch_size_);
+    flush_interval_ms_ = std::min(flush_interval_ms_ * 2, max_flush_interval_ms_);
+}
+
+void BatchTuner::on_write(const InfluxClient::WriteResult &result)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t old_size = batch_size_;
+
+    switch (result.outcome)
+    {
+    case InfluxClient::WriteOutcome::OK:
+    case InfluxClient::WriteOutcome::PARTIAL:
+        latency_ewma_ms_ = latency_ewma_ms_ == 0.0
+                               ? result.latencyMs
+                               : latency_ewma_weight * result.latencyMs + (1.0 - latency_ewma_weight) * latency_ewma_ms_;
+        if (latency_ewma_ms_ <= target_latency_ms_)
+            increase();
+        else
+            decrease();
+        break;
+    case InfluxClient::WriteOutcome::TOO_LARGE:
+    case InfluxClient::WriteOutcome::RETRY:
+        decrease();
+        break;
+    case InfluxClient::WriteOutcome::REJECTED:
+        break; // bad data says nothing about backend capacity
+    }
+
+    if (batch_size_ != old_size)
+    {
+        LOG_DEBUG("Batch tuner: size {}, flush interval {}ms, write latency {}ms (HTTP {})",
+                  batch_size_.load(), flush_interval_ms_.load(), latency_ewma_ms_, result.status);
+    }
+}
@@ -0,0 +1,291 @@
+#include "BinaryLog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BINLOG_DRAIN_INTERVAL_MS 10
+
+// Single-producer single-consumer byte ring owned by one logging thread
+struct BinaryLog::ThreadBuffer
+{
+    std::vector<char> data = std::vector<char>(BINLOG_THREAD_BUFFER);
+    alignas(64) std::atomic<size_t> head{0}; // consumer position
+    alignas(64) std::atomic<size_t> tail{0}; // producer position
+    size_t reserved = 0;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> retired{false};
+};
+
+std::atomic<bool> BinaryLog::open_{false};
+int BinaryLog::fd_ = -1;
+std::mutex BinaryLog::mutex_;
+std::condition_variable BinaryLog::cv_;
+std::thread BinaryLog::thread_;
+bool BinaryLog::stopping_ = false;
+int BinaryLog::flush_waiters_ = 0;
+std::atomic<bool> BinaryLog::wakeup_{false};
+uint64_t BinaryLog::passes_ = 0;
+std::vector<std::shared_ptr<BinaryLog::ThreadBuffer>> BinaryLog::buffers_;
+std::vector<std::string> BinaryLog::sites_;
+size_t BinaryLog::sites_written_ = 0;
+
+// Stops the writer at exit, declared after the members it drains
+static struct BinaryLogShutdown
+{
+    ~BinaryLogShutdown() { BinaryLog::close(); }
+} binary_log_shutdown_;
+
+BinaryLog::ThreadBuffer &BinaryLog::threadBuffer()
+{
+    // Retires the buffer when its thread exits, the writer frees it once drained
+    struct Handle
+    {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~Handle()
+        {
+            if (buffer)
+                buffer->retired = true;
+        }
+    };
+    thread_local Handle handle;
+
+    if (!handle.buffer)
+    {
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers_.push_back(handle.buffer);
+    }
+    return *handle.buffer;
+}
+
+uint32_t BinaryLog::registerSite(BinaryLogSite &site, std::string_view format, const std::string &types)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (id != 0)
+        return id; // registered concurrently by another thread
+
+    std::string_view file(site.file);
+    uint16_t format_length = static_cast<uint16_t>(std::min<size_t>(format.size(), UINT16_MAX));
+    uint16_t file_length = static_cast<uint16_t>(std::min<size_t>(file.size(), UINT16_MAX));
+    uint32_t line = static_cast<uint32_t>(site.line);
+    uint8_t nargs = static_cast<uint8_t>(types.size());
+    id = static_cast<uint32_t>(sites_.size() + 1);
+
+    std::string entry;
+    entry += static_cast<char>(BINLOG_ENTRY_SITE);
+    entry.append(reinterpret_cast<const char *>(&id), 4);
+    entry += static_cast<char>(site.level);
+    entry.append(reinterpret_cast<const char *>(&line), 4);
+    entry += static_cast<char>(nargs);
+    entry.append(reinterpret_cast<const char *>(&format_length), 2);
+    entry.append(reinterpret_cast<const char *>(&file_length), 2);
+    entry += types;
+    entry.append(format.data(), format_length);
+    entry.append(file.data(), file_length);
+    sites_.push_back(std::move(entry));
+
+    site.id.store(id, std::memory_order_release);
+    return id;
+}
+
+char *BinaryLog::reserve(size_t bytes)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    size_t tail = buffer.tail.load(std::memory_order_relaxed);
+    size_t head = buffer.head.load(std::memory_order_acquire);
+    size_t offset = tail % BINLOG_THREAD_BUFFER;
+
+    // Records are contiguous, the gap at the end of the ring is padded
+    size_t padding = BINLOG_THREAD_BUFFER - offset < bytes ? BINLOG_THREAD_BUFFER - offset : 0;
+    if (tail + padding + bytes - head > BINLOG_THREAD_BUFFER)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Wake the writer early instead of waiting for its next interval
+    if (tail + padding + bytes - head > BINLOG_THREAD_BUFFER / 2 && !wakeup_.load(std::memory_order_relaxed))
+    {
+        wakeup_.store(true, std::memory_order_relaxed);
+        cv_.notify_one();
+    }
+
+    if (padding > 0)
+    {
+        memset(buffer.data.data() + offset, BINLOG_ENTRY_PAD, padding);
+        offset = 0;
+    }
+    buffer.reserved = padding + bytes;
+    return buffer.data.data() + offset;
+}
+
+void BinaryLog::commit()
+{
+    ThreadBuffer &buffer = threadBuffer();
+    buffer.tail.store(buffer.tail.load(std::memory_order_relaxed) + buffer.reserved, std::memory_order_release);
+}
+
+uint64_t BinaryLog::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void BinaryLog::writeText(uint8_t level, std::string_view message)
+{
+    static BinaryLogSite text_sites[] = {{0, "", 0}, {1, "", 0}, {2, "", 0}, {3, "", 0}, {4, "", 0}, {5, "", 0}};
+    write(text_sites[std::min<uint8_t>(level, 5)], "{}", message);
+}
+
+bool BinaryLog::open(const std::string &path)
+{
+    close();
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return false;
+
+    binlog_file_header header{BINLOG_MAGIC, BINLOG_VERSION};
+    if (!writeAll(reinterpret_cast<const char *>(&header), sizeof(header)))
+    {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // Sites registered for an earlier file are defined again in this one
+    sites_written_ = 0;
+    stopping_ = false;
+    thread_ = std::thread(&BinaryLog::drainLoop);
+    open_ = true;
+    return true;
+}
+
+void BinaryLog::close()
+{
+    if (!open_.exchange(false))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void BinaryLog::flush()
+{
+    if (!open_)
+        return;
+
+    // Two passes guarantee one drain started after the caller's last record
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = passes_ + 2;
+    flush_waiters_++;
+    cv_.notify_all();
+    cv_.wait(lock, [target]()
+             { return passes_ >= target || stopping_; });
+    flush_waiters_--;
+}
+
+bool BinaryLog::writeAll(const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd_, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void BinaryLog::drain()
+{
+    std::vector<std::string> sites;
+    std::vector<std::pair<std::shared_ptr<ThreadBuffer>, size_t>> buffers;
+    {
+        // Tails are loaded under the lock registerSite() takes, so every record
+        // up to a tail belongs to a site that is part of this snapshot
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &buffer : buffers_)
+        {
+            buffers.emplace_back(buffer, buffer->tail.load(std::memory_order_acquire));
+        }
+        sites.assign(sites_.begin() + sites_written_, sites_.end());
+        sites_written_ = sites_.size();
+        buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto &buffer)
+                                      { return buffer->retired && buffer->head == buffer->tail; }),
+                       buffers_.end());
+    }
+
+    // Definitions first, so the decoder knows every site before its records
+    for (const auto &site : sites)
+    {
+        writeAll(site.data(), site.size());
+    }
+
+    bool wrote = false;
+    for (const auto &[buffer, tail] : buffers)
+    {
+        size_t head = buffer->head.load(std::memory_order_relaxed);
+        if (head != tail)
+        {
+            wrote = true;
+            size_t offset = head % BINLOG_THREAD_BUFFER;
+            size_t first = std::min(tail - head, BINLOG_THREAD_BUFFER - offset);
+            writeAll(buffer->data.data() + offset, first);
+            writeAll(buffer->data.data(), tail - head - first);
+            buffer->head.store(tail, std::memory_order_release);
+        }
+
+        if (uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed))
+        {
+            char entry[9];
+            entry[0] = BINLOG_ENTRY_DROPPED;
+            memcpy(entry + 1, &dropped, 8);
+            writeAll(entry, sizeof(entry));
+            wrote = true;
+        }
+    }
+
+    if (wrote)
+    {
+        char entry = BINLOG_ENTRY_DRAIN;
+        writeAll(&entry, 1);
+    }
+}
+
+void BinaryLog::drainLoop()
+{
+    while (true)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping = stopping_;
+            passes_++;
+            cv_.notify_all();
+            if (!stopping)
+                cv_.wait_for(lock, std::chrono::milliseconds(BINLOG_DRAIN_INTERVAL_MS), []()
+                             { return stopping_ || flush_waiters_ > 0 || wakeup_; });
+            wakeup_ = false;
+        }
+
+        drain();
+
+        if (stopping)
+            break;
+    }
+}
@@ -0,0 +1,366 @@
+#include "BpfLoader.hpp"
+#include <future>
+#include <vector>
+#include <functional>
+#include <cstdarg>
+#include <cstdio>
+#include <algorithm>
+#include <unistd.h>
+#include "CgroupFilter.hpp"
+#include "cpu_monitor.skel.h"
+#include "memory_monitor.skel.h"
+#include "syscall_latency_monitor.skel.h"
+#include "syscall_frequency.skel.h"
+#include "hello_ring_buffer.skel.h"
+#include "runqueue_latency.skel.h"
+
+// Must match CGROUP_FILTER_MAX_ENTRIES in ebpf/cgroup_filter.bpf.h
+static constexpr __u32 cgroup_filter_max_entries = 16384;
+
+static int libbpf_print(enum libbpf_print_level level, const char *format, va_list args)
+{
+    if (level == LIBBPF_DEBUG)
+        return 0;
+
+    char buffer[512];
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+
+    std::string message(buffer);
+    if (!message.empty() && message.back() == '\n')
+        message.pop_back();
+
+    if (level == LIBBPF_WARN)
+        Logger::warn("libbpf: " + message);
+    else
+        LOG_DEBUG("libbpf: {}", message);
+    return len;
+}
+
+template <typename Skel>
+static bool open_load_attach(const std::string &name, Skel *&skel,
+                             Skel *(*open_fn)(), int (*load_fn)(Skel *), int (*attach_fn)(Skel *),
+                             const std::function<bool(Skel *)> &configure)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    skel = open_fn();
+    if (!skel)
+    {
+        Logger::error("Failed to open BPF object: " + name);
+        return false;
+    }
+
+    if (configure && !configure(skel))
+    {
+        Logger::error("Failed to configure BPF object: " + name);
+        return false;
+    }
+
+    int err = load_fn(skel);
+    if (err)
+    {
+        Logger::error("Failed to load BPF object " + name + ": " + std::to_string(err));
+        return false;
+    }
+
+    err = attach_fn(skel);
+    if (err)
+    {
+        Logger::error("Failed to attach BPF object " + name + ": " + std::to_string(err));
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    Logger::info("BPF object " + name + " loaded in " + std::to_string(elapsed.count()) + "ms");
+    return true;
+}
+
+BpfLoader::BpfLoader(__u32 ringbuf_bytes)
+    : cpu_skel(nullptr),
+      memory_skel(nullptr),
+      syscall_latency_skel(nullptr),
+      syscall_frequency_skel(nullptr),
+      hello_ring_buffer_skel(nullptr),
+      runqueue_latency_skel(nullptr),
+      cgroup_filter_map_fd(-1),
+      cgroup_filter_config_map_fd(-1),
+      ringbuf_size(ringbuf_bytes),
+      wakeup_watermark(ringbuf_bytes / 4),
+      startup_time(0)
+{
+    libbpf_set_print(libbpf_print);
+}
+
+BpfLoader::~BpfLoader()
+{
+    destroy();
+}
+
+__u32 BpfLoader::default_ringbuf_size()
+{
+    // 64KB per CPU, at least the previous fixed 256KB and at most 64MB
+    int cpus = libbpf_num_possible_cpus();
+    __u64 wanted = 64ULL * 1024 * (cpus > 0 ? cpus : 1);
+    __u32 size = 256 * 1024;
+    while (size < wanted && size < (64u << 20))
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+bool BpfLoader::create_shared_maps()
+{
+    if (cgroup_filter_map_fd >= 0)
+        return true;
+
+    cgroup_filter_map_fd = bpf_map_create(BPF_MAP_TYPE_HASH, "cgroup_filter",
+                                          sizeof(__u64), sizeof(__u8), cgroup_filter_max_entries, nullptr);
+    if (cgroup_filter_map_fd < 0)
+    {
+        Logger::error("Failed to create cgroup filter map");
+        return false;
+    }
+
+    cgroup_filter_config_map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, "cgroup_filter_c",
+                                                 sizeof(__u32), sizeof(cgroup_filter_config), 1, nullptr);
+    if (cgroup_filter_config_map_fd < 0)
+    {
+        Logger::error("Failed to create cgroup filter config map");
+        ::close(cgroup_filter_map_fd);
+        cgroup_filter_map_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool BpfLoader::share_cgroup_filter(struct bpf_map *filter_map, struct bpf_map *config_map)
+{
+    return bpf_map__reuse_fd(filter_map, cgroup_filter_map_fd) == 0 &&
+           bpf_map__reuse_fd(config_map, cgroup_filter_config_map_fd) == 0;
+}
+
+bool BpfLoader::size_ring(struct bpf_map *ring_map, __u32 size)
+{
+    if (bpf_map__set_max_entries(ring_map, size) != 0)
+    {
+        Logger::error("Failed to size ring buffer " + std::string(bpf_map__name(ring_map)) +
+                      " to " + std::to_string(size) + " bytes");
+        return false;
+    }
+    return true;
+}
+
+__u64 BpfLoader::watermark_for(__u32 ring_size) const
+{
+    // Leave headroom so the ring cannot fill before the reader is woken
+    return std::min<__u64>(wakeup_watermark, ring_size / 2);
+}
+
+bool BpfLoader::load_cpu_monitor()
+{
+    return open_load_attach<struct cpu_monitor>(
+        "cpu_monitor", cpu_skel, cpu_monitor__open, cpu_monitor__load, cpu_monitor__attach,
+        [this](struct cpu_monitor *skel)
+        {
+            skel->rodata->ringbuf_wakeup_watermark = watermark_for(ringbuf_size);
+            return size_ring(skel->maps.cpu_rb, ringbuf_size) &&
+                   share_cgroup_filter(skel->maps.cgroup_filter, skel->maps.cgroup_filter_config);
+        });
+}
+
+bool BpfLoader::load_memory_monitor()
+{
+    return open_load_attach<struct memory_monitor>(
+        "memory_monitor", memory_skel, memory_monitor__open, memory_monitor__load, memory_monitor__attach,
+        [this](struct memory_monitor *skel)
+        {
+            skel->rodata->ringbuf_wakeup_watermark = watermark_for(ringbuf_size);
+            return size_ring(skel->maps.memory_rb, ringbuf_size) &&
+                   share_cgroup_filter(skel->maps.cgroup_filter, skel->maps.cgroup_filter_config);
+        });
+}
+
+bool BpfLoader::load_syscall_latency_monitor()
+{
+    return open_load_attach<struct syscall_latency_monitor>(
+        "syscall_latency_monitor", syscall_latency_skel,
+        syscall_latency_monitor__open, syscall_latency_monitor__load, syscall_latency_monitor__attach,
+        [this](struct syscall_latency_monitor *skel)
+        {
+            skel->rodata->ringbuf_wakeup_watermark = watermark_for(ringbuf_size);
+            return size_ring(skel->maps.events, ringbuf_size) &&
+                   share_cgroup_filter(skel->maps.cgroup_filter, skel->maps.cgroup_filter_config);
+        });
+}
+
+bool BpfLoader::load_syscall_frequency()
+{
+    return open_load_attach<struct syscall_frequency>(
+        "syscall_frequency", syscall_frequency_skel,
+        syscall_frequency__open, syscall_frequency__load, syscall_frequency__attach,
+        [this](struct syscall_frequency *skel)
+        {
+            return share_cgroup_filter(skel->maps.cgroup_filter, skel->maps.cgroup_filter_config);
+        });
+}
+
+bool BpfLoader::load_hello_ring_buffer()
+{
+    // The demo keeps its own fixed 16MB ring
+    return open_load_attach<struct hello_ring_buffer>(
+        "hello_ring_buffer", hello_ring_buffer_skel,
+        hello_ring_buffer__open, hello_ring_buffer__load, hello_ring_buffer__attach,
+        [this](struct hello_ring_buffer *skel)
+        {
+            skel->rodata->ringbuf_wakeup_watermark = watermark_for(bpf_map__max_entries(skel->maps.output));
+            return share_cgroup_filter(skel->maps.cgroup_filter, skel->maps.cgroup_filter_config);
+        });
+}
+
+bool BpfLoader::load_runqueue_latency()
+{
+    return open_load_attach<struct runqueue_latency>(
+        "runqueue_latency", runqueue_latency_skel,
+        runqueue_latency__open, runqueue_latency__load, runqueue_latency__attach,
+        [this](struct runqueue_latency *skel)
+        {
+            return share_cgroup_filter(skel->maps.cgroup_filter, skel->maps.cgroup_filter_config);
+        });
+}
+
+bool BpfLoader::load(unsigned probes)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    if (!create_shared_maps())
+        return false;
+
+    std::vector<std::future<bool>> tasks;
+    auto launch = [&tasks, this](bool (BpfLoader::*load_fn)())
+    {
+        tasks.push_back(std::async(std::launch::async, load_fn, this));
+    };
+
+    if (probes & BPF_PROBE_CPU)
+        launch(&BpfLoader::load_cpu_monitor);
+    if (probes & BPF_PROBE_MEMORY)
+        launch(&BpfLoader::load_memory_monitor);
+    if (probes & BPF_PROBE_SYSCALL_LATENCY)
+        launch(&BpfLoader::load_syscall_latency_monitor);
+    if (probes & BPF_PROBE_SYSCALL_FREQUENCY)
+        launch(&BpfLoader::load_syscall_frequency);
+    if (probes & BPF_PROBE_HELLO_RING_BUFFER)
+        launch(&BpfLoader::load_hello_ring_buffer);
+    if (probes & BPF_PROBE_RUNQUEUE_LATENCY)
+        launch(&BpfLoader::load_runqueue_latency);
+
+    bool ok = true;
+    for (auto &task : tasks)
+    {
+        ok = task.get() && ok;
+    }
+
+    if (!ok)
+    {
+        destroy();
+        return false;
+    }
+
+    startup_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    Logger::info("Loaded " + std::to_string(tasks.size()) + " BPF objects in " +
+                 std::to_string(startup_time.count()) + "ms (ring buffers: " +
+                 std::to_string(ringbuf_size / 1024) + "KB, wakeup watermark: " +
+                 std::to_string(watermark_for(ringbuf_size) / 1024) + "KB)");
+    return true;
+}
+
+void BpfLoader::destroy()
+{
+    if (cpu_skel)
+    {
+        cpu_monitor__destroy(cpu_skel);
+        cpu_skel = nullptr;
+    }
+    if (memory_skel)
+    {
+        memory_monitor__destroy(memory_skel);
+        memory_skel = nullptr;
+    }
+    if (syscall_latency_skel)
+    {
+        syscall_latency_monitor__destroy(syscall_latency_skel);
+        syscall_latency_skel = nullptr;
+    }
+    if (syscall_frequency_skel)
+    {
+        syscall_frequency__destroy(syscall_frequency_skel);
+        syscall_frequency_skel = nullptr;
+    }
+    if (hello_ring_buffer_skel)
+    {
+        hello_ring_buffer__destroy(hello_ring_buffer_skel);
+        hello_ring_buffer_skel = nullptr;
+    }
+    if (runqueue_latency_skel)
+    {
+        runqueue_latency__destroy(runqueue_latency_skel);
+        runqueue_latency_skel = nullptr;
+    }
+    if (cgroup_filter_map_fd >= 0)
+    {
+        ::close(cgroup_filter_map_fd);
+        cgroup_filter_map_fd = -1;
+    }
+    if (cgroup_filter_config_map_fd >= 0)
+    {
+        ::close(cgroup_filter_config_map_fd);
+        cgroup_filter_config_map_fd = -1;
+    }
+}
+
+int BpfLoader::cpu_events_fd() const
+{
+    return cpu_skel ? bpf_map__fd(cpu_skel->maps.cpu_rb) : -1;
+}
+
+int BpfLoader::memory_events_fd() const
+{
+    return memory_skel ? bpf_map__fd(memory_skel->maps.memory_rb) : -1;
+}
+
+int BpfLoader::syscall_latency_events_fd() const
+{
+    return syscall_latency_skel ? bpf_map__fd(syscall_latency_skel->maps.events) : -1;
+}
+
+int BpfLoader::syscall_filter_fd() const
+{
+    return syscall_latency_skel ? bpf_map__fd(syscall_latency_skel->maps.syscall_filter) : -1;
+}
+
+int BpfLoader::syscall_counts_fd() const
+{
+    return syscall_frequency_skel ? bpf_map__fd(syscall_frequency_skel->maps.syscall_counts) : -1;
+}
+
+int BpfLoader::cgroup_syscall_counts_fd() const
+{
+    return syscall_frequency_skel ? bpf_map__fd(syscall_frequency_skel->maps.cgroup_syscall_counts) : -1;
+}
+
+int BpfLoader::syscall_counts_config_fd() const
+{
+    return syscall_frequency_skel ? bpf_map__fd(syscall_frequency_skel->maps.syscall_counts_config) : -1;
+}
+
+int BpfLoader::hello_output_fd() const
+{
+    return hello_ring_buffer_skel ? bpf_map__fd(hello_ring_buffer_skel->maps.output) : -1;
+}
+
+int BpfLoader::runqueue_latency_fd() const
+{
+    return runqueue_latency_skel ? bpf_map__fd(runqueue_latency_skel->maps.runqueue_latency) : -1;
+}
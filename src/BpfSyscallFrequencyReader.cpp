@@ -1,56 +1,216 @@
 #include "BpfSyscallFrequencyReader.hpp"
 #include <iostream>
+#include <bpf/libbpf.h>
+#include <unistd.h>
 #include "Logger.hpp"
+#include "SyscallNames.hpp"
 
-BpfSyscallFrequencyReader::BpfSyscallFrequencyReader()
+// Must match struct syscall_cgroup_key in ebpf/syscall_frequency.bpf.c
+struct syscall_cgroup_key
+{
+    __u64 cgroup_id;
+    __u32 syscall_id;
+    __u32 pad;
+};
+
+BpfSyscallFrequencyReader::BpfSyscallFrequencyReader(const std::string &pinnedPath,
+                                                     const std::string &cgroupPinnedPath,
+                                                     const std::string &configPinnedPath)
+    : mapPath(pinnedPath), cgroupMapFd(-1), cgroupMapPath(cgroupPinnedPath),
+      configMapFd(-1), configMapPath(configPinnedPath),
+      previousSample(std::chrono::steady_clock::now())
 {
-    mapPath = "/sys/fs/bpf/syscall_counts";
     mapFd = bpf_obj_get(mapPath.c_str());
     if (mapFd < 0)
     {
         throw std::runtime_error("Erro ao abrir mapa BPF: " + mapPath);
     }
+
+    initPerCpuBuffer();
+}
+
+BpfSyscallFrequencyReader::BpfSyscallFrequencyReader(int countsFd, int cgroupCountsFd, int configFd)
+    : mapPath("fd"), cgroupMapFd(-1), configMapFd(-1),
+      previousSample(std::chrono::steady_clock::now())
+{
+    // Duplicate so the destructor never invalidates the owner's fds
+    mapFd = dup(countsFd);
+    if (mapFd < 0)
+    {
+        throw std::runtime_error("Invalid syscall counts map fd");
+    }
+    if (cgroupCountsFd >= 0)
+        cgroupMapFd = dup(cgroupCountsFd);
+    if (configFd >= 0)
+        configMapFd = dup(configFd);
+
+    initPerCpuBuffer();
+}
+
+void BpfSyscallFrequencyReader::initPerCpuBuffer()
+{
+    numCpus = libbpf_num_possible_cpus();
+    if (numCpus <= 0)
+    {
+        // The destructor does not run when a constructor throws
+        ::close(mapFd);
+        if (cgroupMapFd >= 0)
+            ::close(cgroupMapFd);
+        if (configMapFd >= 0)
+            ::close(configMapFd);
+        throw std::runtime_error("Failed to get number of possible CPUs");
+    }
+    percpuValues.resize(numCpus);
+}
+
+BpfSyscallFrequencyReader::~BpfSyscallFrequencyReader()
+{
+    if (mapFd >= 0)
+        ::close(mapFd);
+    if (cgroupMapFd >= 0)
+        ::close(cgroupMapFd);
+    if (configMapFd >= 0)
+        ::close(configMapFd);
 }
+
+long BpfSyscallFrequencyReader::sumPerCpu(int fd, const void *key)
+{
+    // Per-CPU maps return one value per possible CPU
+    if (bpf_map_lookup_elem(fd, key, percpuValues.data()) != 0)
+    {
+        return 0;
+    }
+
+    long total = 0;
+    for (__u64 value : percpuValues)
+    {
+        total += value;
+    }
+    return total;
+}
+
 std::unordered_map<int, long> BpfSyscallFrequencyReader::readAll()
 {
     std::unordered_map<int, long> data;
 
     // For array maps, iterate sequentially through all possible keys
-    for (int key = 0; key < 8; key++)
+    for (__u32 key = 0; key < MAX_SYSCALL_NR; key++)
     {
-        long value = 0;
-        if (bpf_map_lookup_elem(mapFd, &key, &value) == 0)
+        long value = sumPerCpu(mapFd, &key);
+        if (value > 0)
         {
             data[key] = value;
-            Logger::debug(std::format("Found key {} with value {}", key, value));
+            LOG_DEBUG("Found key {} with value {}", key, value);
         }
     }
 
     return data;
 }
 
-// Helper function to get syscall name from key
+std::unordered_map<int, SyscallFrequency> BpfSyscallFrequencyReader::sample()
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - previousSample).count();
+    bool first = previousCounts.empty();
+
+    std::unordered_map<int, long> counts = readAll();
+    std::unordered_map<int, SyscallFrequency> samples;
+
+    for (const auto &[key, count] : counts)
+    {
+        double rate = 0.0;
+        if (!first && elapsed > 0.0)
+        {
+            auto prev = previousCounts.find(key);
+            long delta = count - (prev != previousCounts.end() ? prev->second : 0);
+            rate = delta / elapsed;
+        }
+        samples[key] = {count, rate};
+    }
+
+    previousCounts = std::move(counts);
+    previousSample = now;
+    return samples;
+}
+
+bool BpfSyscallFrequencyReader::enablePerCgroup(bool enable)
+{
+    if (configMapFd < 0)
+    {
+        configMapFd = bpf_obj_get(configMapPath.c_str());
+        if (configMapFd < 0)
+        {
+            Logger::error("Failed to open syscall counts config map: " + configMapPath);
+            return false;
+        }
+    }
+
+    if (enable && cgroupMapFd < 0)
+    {
+        cgroupMapFd = bpf_obj_get(cgroupMapPath.c_str());
+        if (cgroupMapFd < 0)
+        {
+            Logger::error("Failed to open per-cgroup syscall counts map: " + cgroupMapPath);
+            return false;
+        }
+    }
+
+    __u32 key = 0;
+    __u32 value = enable ? 1 : 0;
+    return bpf_map_update_elem(configMapFd, &key, &value, BPF_ANY) == 0;
+}
+
+std::unordered_map<__u64, std::unordered_map<int, long>> BpfSyscallFrequencyReader::readPerCgroup()
+{
+    std::unordered_map<__u64, std::unordered_map<int, long>> data;
+    if (cgroupMapFd < 0)
+        return data;
+
+    syscall_cgroup_key key = {};
+    syscall_cgroup_key nextKey = {};
+    void *prevKey = nullptr;
+
+    // Keys whose total did not move since the previous read are idle
+    std::vector<syscall_cgroup_key> idle;
+    while (bpf_map_get_next_key(cgroupMapFd, prevKey, &nextKey) == 0)
+    {
+        long value = sumPerCpu(cgroupMapFd, &nextKey);
+        auto cgroup = previousCgroupCounts.find(nextKey.cgroup_id);
+        if (cgroup != previousCgroupCounts.end())
+        {
+            auto previous = cgroup->second.find(static_cast<int>(nextKey.syscall_id));
+            if (previous != cgroup->second.end() && previous->second == value)
+            {
+                idle.push_back(nextKey);
+                key = nextKey;
+                prevKey = &key;
+                continue;
+            }
+        }
+        if (value > 0)
+        {
+            data[nextKey.cgroup_id][nextKey.syscall_id] = value;
+        }
+        key = nextKey;
+        prevKey = &key;
+    }
+
+    // Delete after the walk: removing the cursor key restarts get_next_key.
+    // Exited cgroups would otherwise fill the map and block new inserts.
+    for (const auto &idleKey : idle)
+    {
+        bpf_map_delete_elem(cgroupMapFd, &idleKey);
+    }
+    if (!idle.empty())
+    {
+        LOG_DEBUG("Evicted {} idle cgroup syscall counters", idle.size());
+    }
+
+    previousCgroupCounts = data;
+    return data;
+}
+
 std::string BpfSyscallFrequencyReader::getSyscallName(int key)
 {
-    switch (key)
-    {
-    case 0:
-        return "read";
-    case 1:
-        return "write";
-    case 2:
-        return "openat";
-    case 3:
-        return "close";
-    case 4:
-        return "mmap";
-    case 5:
-        return "brk";
-    case 6:
-        return "getpid";
-    case 7:
-        return "clock_gettime";
-    default:
-        return "unknown";
-    }
-}
\ No newline at end of file
+    return get_syscall_name(key);
+}
@@ -0,0 +1,248 @@
+#include "CgroupFilter.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CgroupFilter::CgroupFilter(const std::string &cgroup_mount)
+    : cgroup_root(cgroup_mount),
+      filter_map_fd(-1),
+      config_map_fd(-1),
+      running(false)
+{
+    // Hybrid hosts mount the unified hierarchy separately
+    if (std::filesystem::exists(cgroup_root + "/unified"))
+    {
+        cgroup_root += "/unified";
+    }
+}
+
+CgroupFilter::~CgroupFilter()
+{
+    stop_refreshing();
+    close();
+}
+
+bool CgroupFilter::open(int filter_fd, int config_fd)
+{
+    // Duplicate so close() never invalidates the owner's fds
+    filter_map_fd = dup(filter_fd);
+    if (filter_map_fd < 0)
+    {
+        Logger::error("Invalid cgroup filter map fd");
+        return false;
+    }
+
+    config_map_fd = dup(config_fd);
+    if (config_map_fd < 0)
+    {
+        Logger::error("Invalid cgroup filter config map fd");
+        ::close(filter_map_fd);
+        filter_map_fd = -1;
+        return false;
+    }
+
+    // Drop entries left over from a previous run
+    __u64 stale_id;
+    while (bpf_map_get_next_key(filter_map_fd, nullptr, &stale_id) == 0)
+    {
+        if (bpf_map_delete_elem(filter_map_fd, &stale_id) != 0)
+            break;
+    }
+
+    return true;
+}
+
+void CgroupFilter::close()
+{
+    if (filter_map_fd >= 0)
+    {
+        ::close(filter_map_fd);
+        filter_map_fd = -1;
+    }
+    if (config_map_fd >= 0)
+    {
+        ::close(config_map_fd);
+        config_map_fd = -1;
+    }
+}
+
+std::unordered_set<__u64> CgroupFilter::scan_workload_cgroups() const
+{
+    std::unordered_set<__u64> cgroups;
+    std::error_code ec;
+
+    // Top-level kubepods cgroups: "kubepods" (cgroupfs) or "kubepods.slice" (systemd)
+    for (const auto &top : std::filesystem::directory_iterator(cgroup_root, ec))
+    {
+        if (!top.is_directory(ec) || top.path().filename().string().find("kubepods") == std::string::npos)
+            continue;
+
+        // Pods and containers may vanish while we walk, so skip errors
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto it = std::filesystem::recursive_directory_iterator(top.path(), options, ec);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (ec)
+                break;
+            if (!it->is_directory(ec))
+                continue;
+
+            struct stat st;
+            if (::stat(it->path().c_str(), &st) == 0)
+            {
+                cgroups.insert(st.st_ino);
+            }
+        }
+    }
+
+    return cgroups;
+}
+
+__u64 CgroupFilter::self_cgroup_id() const
+{
+    // cgroup v2 entry looks like "0::/kubepods.slice/.../cri-containerd-<id>.scope"
+    std::ifstream file("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.rfind("0::", 0) == 0)
+        {
+            struct stat st;
+            std::string path = cgroup_root + line.substr(3);
+            if (::stat(path.c_str(), &st) == 0)
+            {
+                return st.st_ino;
+            }
+        }
+    }
+    return 0;
+}
+
+void CgroupFilter::refresh()
+{
+    if (filter_map_fd < 0)
+        return;
+
+    std::unordered_set<__u64> current = scan_workload_cgroups();
+    __u64 self_id = self_cgroup_id();
+
+    std::lock_guard<std::mutex> lock(cgroups_mutex);
+
+    // Remove cgroups of pods that have stopped
+    for (auto it = allowed_cgroups.begin(); it != allowed_cgroups.end();)
+    {
+        if (current.find(*it) == current.end())
+        {
+            bpf_map_delete_elem(filter_map_fd, &*it);
+            it = allowed_cgroups.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Add cgroups of new pods
+    __u8 allow = CGROUP_VERDICT_ALLOW;
+    size_t added = 0;
+    for (__u64 cgroup_id : current)
+    {
+        if (cgroup_id == self_id || allowed_cgroups.count(cgroup_id))
+            continue;
+
+        if (bpf_map_update_elem(filter_map_fd, &cgroup_id, &allow, BPF_ANY) != 0)
+        {
+            Logger::warn("Failed to add cgroup " + std::to_string(cgroup_id) + " to filter");
+            continue;
+        }
+        allowed_cgroups.insert(cgroup_id);
+        added++;
+    }
+
+    // Events generated by the agent itself are always discarded
+    if (self_id != 0 && denied_cgroups.insert(self_id).second)
+    {
+        __u8 deny = CGROUP_VERDICT_DENY;
+        bpf_map_update_elem(filter_map_fd, &self_id, &deny, BPF_ANY);
+    }
+
+    if (added > 0)
+    {
+        LOG_DEBUG("Cgroup filter refreshed: {} workload cgroups ({} new)", allowed_cgroups.size(), added);
+    }
+}
+
+bool CgroupFilter::write_config(CgroupFilterMode mode)
+{
+    if (config_map_fd < 0)
+        return false;
+
+    __u32 key = 0;
+    cgroup_filter_config config = {};
+    config.mode = static_cast<__u32>(mode);
+    config.self_tgid = static_cast<__u32>(::getpid());
+
+    if (bpf_map_update_elem(config_map_fd, &key, &config, BPF_ANY) != 0)
+    {
+        Logger::error("Failed to update cgroup filter config");
+        return false;
+    }
+    return true;
+}
+
+bool CgroupFilter::enable(CgroupFilterMode mode)
+{
+    if (!write_config(mode))
+        return false;
+
+    Logger::info("Cgroup filter enabled with " + std::to_string(allowed_count()) + " workload cgroups");
+    return true;
+}
+
+void CgroupFilter::start_refreshing(std::chrono::seconds interval)
+{
+    if (running)
+        return;
+
+    running = true;
+    refresh_thread = std::thread(&CgroupFilter::refresh_loop, this, interval);
+}
+
+void CgroupFilter::stop_refreshing()
+{
+    if (running)
+    {
+        {
+            std::lock_guard<std::mutex> lock(refresh_mutex);
+            running = false;
+        }
+        refresh_cv.notify_all();
+        if (refresh_thread.joinable())
+        {
+            refresh_thread.join();
+        }
+    }
+}
+
+void CgroupFilter::refresh_loop(std::chrono::seconds interval)
+{
+    std::unique_lock<std::mutex> lock(refresh_mutex);
+    while (running)
+    {
+        refresh_cv.wait_for(lock, interval, [this]()
+                            { return !running; });
+        if (!running)
+            break;
+
+        lock.unlock();
+        refresh();
+        lock.lock();
+    }
+}
+
+size_t CgroupFilter::allowed_count()
+{
+    std::lock_guard<std::mutex> lock(cgroups_mutex);
+    return allowed_cgroups.size();
+}
@@ -0,0 +1,85 @@
+#include "ChangeFilter.hpp"
+#include <cmath>
+
+ChangeFilter::ChangeFilter(double epsilon, std::chrono::seconds max_silence)
+    : epsilon_(epsilon), max_silence_s_(max_silence.count()), emitted_(0), suppressed_(0)
+{
+}
+
+void ChangeFilter::configure(double epsilon, std::chrono::seconds max_silence)
+{
+    epsilon_ = epsilon;
+    max_silence_s_ = max_silence.count();
+    last_emitted_.clear();
+}
+
+uint64_t ChangeFilter::key(std::string_view series, std::string_view field)
+{
+    // FNV-1a over series and field, a NUL in between keeps "ab"+"c" apart from "a"+"bc"
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : series)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+    hash *= 1099511628211ULL;
+    for (char c : field)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool ChangeFilter::changed(const Entry &entry, double value, int64_t now_s) const
+{
+    if (now_s - entry.emitted_s >= max_silence_s_)
+        return true;
+    double last = entry.value;
+    return std::fabs(value - last) > epsilon_ * std::fabs(last) || (last == 0 && value != 0);
+}
+
+bool ChangeFilter::admit(std::string_view series, std::span<const Field> fields, int64_t now_s)
+{
+    if (!enabled())
+        return true;
+
+    bool write = false;
+    for (const auto &[name, value] : fields)
+    {
+        auto it = last_emitted_.find(key(series, name));
+        if (it == last_emitted_.end() || changed(it->second, value, now_s))
+        {
+            write = true;
+            break;
+        }
+    }
+
+    if (!write)
+    {
+        suppressed_++;
+        return false;
+    }
+
+    // Fields are written together, so they all restart from the written values
+    for (const auto &[name, value] : fields)
+    {
+        last_emitted_[key(series, name)] = {static_cast<float>(value), static_cast<uint32_t>(now_s)};
+    }
+    emitted_++;
+    return true;
+}
+
+bool ChangeFilter::admit(std::string_view series, double value, int64_t now_s)
+{
+    Field field("value", value);
+    return admit(series, std::span<const Field>(&field, 1), now_s);
+}
+
+void ChangeFilter::prune(int64_t now_s)
+{
+    if (!enabled())
+        return;
+
+    // Live series are written at least every max_silence, older entries belong to ended ones
+    std::erase_if(last_emitted_, [&](const auto &item)
+                  { return now_s - item.second.emitted_s > 2 * max_silence_s_; });
+}
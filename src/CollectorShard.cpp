@@ -0,0 +1,44 @@
+#include "CollectorShard.hpp"
+
+static void merge_metrics(PodMetrics &target, const PodMetrics &source)
+{
+    for (const auto &[pod_name, metrics] : source)
+    {
+        auto &pod = target[pod_name];
+        for (const auto &[metric_name, value] : metrics)
+        {
+            pod[metric_name] += value;
+        }
+    }
+}
+
+IntervalAggregates::IntervalAggregates(size_t top_k_capacity)
+    : top_pods_cpu(top_k_capacity),
+      top_pods_syscalls(top_k_capacity),
+      top_pods_latency(top_k_capacity),
+      top_commands_cpu(top_k_capacity),
+      top_commands_syscalls(top_k_capacity)
+{
+}
+
+void IntervalAggregates::merge(const IntervalAggregates &other)
+{
+    merge_metrics(pod_metrics, other.pod_metrics);
+    merge_metrics(io_pod_metrics, other.io_pod_metrics);
+    top_pods_cpu.merge(other.top_pods_cpu);
+    top_pods_syscalls.merge(other.top_pods_syscalls);
+    top_pods_latency.merge(other.top_pods_latency);
+    top_commands_cpu.merge(other.top_commands_cpu);
+    top_commands_syscalls.merge(other.top_commands_syscalls);
+}
+
+void IntervalAggregates::clear()
+{
+    pod_metrics.clear();
+    io_pod_metrics.clear();
+    top_pods_cpu.clear();
+    top_pods_syscalls.clear();
+    top_pods_latency.clear();
+    top_commands_cpu.clear();
+    top_commands_syscalls.clear();
+}
@@ -0,0 +1,71 @@
+#include "FileSink.hpp"
+#include "Logger.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileSink::FileSink(const std::string &path, size_t max_queued)
+    : MetricSink(path == "-" ? "stdout" : "file:" + path, true, max_queued), path_(path), fd_(-1)
+{
+}
+
+FileSink::~FileSink()
+{
+    stop();
+}
+
+bool FileSink::start()
+{
+    if (fd_ < 0)
+    {
+        fd_ = path_ == "-" ? STDOUT_FILENO : open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+        {
+            Logger::error("Failed to open metrics file " + path_ + ": " + strerror(errno));
+            return false;
+        }
+    }
+    return MetricSink::start();
+}
+
+void FileSink::stop()
+{
+    MetricSink::stop();
+    if (fd_ >= 0 && fd_ != STDOUT_FILENO)
+    {
+        close(fd_);
+    }
+    fd_ = -1;
+}
+
+bool FileSink::deliver(const MetricBatchPtr &batch)
+{
+    // One write per batch keeps lines of concurrent writers from interleaving
+    std::string buffer;
+    size_t bytes = 0;
+    for (const auto &line : batch->lines)
+    {
+        bytes += line.size() + 1;
+    }
+    buffer.reserve(bytes);
+    for (const auto &line : batch->lines)
+    {
+        buffer += line;
+        buffer += '\n';
+    }
+
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t n = write(fd_, buffer.data() + written, buffer.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            Logger::error("Failed to write metrics to " + path_ + ": " + strerror(errno));
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
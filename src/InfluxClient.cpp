@@ -1,15 +1,162 @@
 #include <curl/curl.h>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <thread>
 #include <sstream>
 #include <iostream>
+#include <mutex>
+#include <cstdlib>
 #include "InfluxClient.hpp"
 
+// curl_global_init/cleanup are not thread-safe and must run once per
+// process, not once per client
+static void curlGlobalInitOnce()
+{
+    static std::once_flag once;
+    std::call_once(once, []()
+                   {
+                       curl_global_init(CURL_GLOBAL_DEFAULT);
+                       std::atexit(curl_global_cleanup); });
+}
+
 InfluxClient::InfluxClient(const std::string &protocol,
                            const std::string &host,
                            int port,
                            const std::string &database)
-    : baseUrl_(protocol + "://" + host + ":" + std::to_string(port)), database_(database)
+    : baseUrl_(protocol + "://" + host + ":" + std::to_string(port)), database_(database),
+      v2_(false),
+      precision_(Precision::NS),
+      writeHeaders_(nullptr),
+      gzipWriteHeaders_(nullptr),
+      compressionLevel_(0),
+      rawBytesWritten_(0),
+      encodedBytesWritten_(0),
+      multi_(nullptr),
+      asyncRunning_(false),
+      inFlight_(0),
+      outstandingBytes_(0),
+      maxInFlight_(0),
+      maxOutstandingBytes_(0)
+{
+    curlGlobalInitOnce();
+
+    pingUrl_ = baseUrl_ + "/ping";
+    queryUrl_ = baseUrl_ + "/query";
+    buildRequestState();
+}
+
+static std::string urlEncode(const std::string &value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    std::string encoded;
+    for (unsigned char c : value)
+    {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+        {
+            encoded += static_cast<char>(c);
+            continue;
+        }
+        encoded += '%';
+        encoded += hex[c >> 4];
+        encoded += hex[c & 0xf];
+    }
+    return encoded;
+}
+
+std::string InfluxClient::buildWriteUrl(Precision precision) const
+{
+    // v1 spells microseconds "u", v2 "us"
+    static const char *v1Names[] = {"ns", "u", "ms", "s"};
+    static const char *v2Names[] = {"ns", "us", "ms", "s"};
+    size_t index = static_cast<size_t>(precision);
+
+    if (v2_)
+    {
+        return baseUrl_ + "/api/v2/write?org=" + urlEncode(org_) + "&bucket=" + urlEncode(bucket_) +
+               "&precision=" + v2Names[index];
+    }
+
+    std::string url = baseUrl_ + "/write?db=" + urlEncode(database_);
+    if (precision != Precision::NS)
+        url += std::string("&precision=") + v1Names[index];
+    return url;
+}
+
+void InfluxClient::buildRequestState()
+{
+    writeUrl_ = buildWriteUrl(precision_);
+
+    curl_slist_free_all(writeHeaders_);
+    curl_slist_free_all(gzipWriteHeaders_);
+    writeHeaders_ = nullptr;
+    gzipWriteHeaders_ = nullptr;
+
+    // Empty Expect: stops curl from waiting for 100-continue on large streamed bodies
+    for (struct curl_slist **headers : {&writeHeaders_, &gzipWriteHeaders_})
+    {
+        *headers = curl_slist_append(*headers, "Content-Type: text/plain; charset=utf-8");
+        *headers = curl_slist_append(*headers, "Expect:");
+        if (v2_)
+            *headers = curl_slist_append(*headers, ("Authorization: Token " + token_).c_str());
+    }
+    gzipWriteHeaders_ = curl_slist_append(gzipWriteHeaders_, "Content-Encoding: gzip");
+}
+
+void InfluxClient::useV2(const std::string &org, const std::string &bucket, const std::string &token)
 {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    v2_ = true;
+    org_ = org;
+    bucket_ = bucket;
+    token_ = token;
+    buildRequestState();
+}
+
+void InfluxClient::setPrecision(Precision precision)
+{
+    precision_ = precision;
+    buildRequestState();
+}
+
+bool InfluxClient::parsePrecision(const std::string &name, Precision *precision)
+{
+    if (name == "ns")
+        *precision = Precision::NS;
+    else if (name == "us" || name == "u")
+        *precision = Precision::US;
+    else if (name == "ms")
+        *precision = Precision::MS;
+    else if (name == "s")
+        *precision = Precision::S;
+    else
+        return false;
+    return true;
+}
+
+uint64_t InfluxClient::timestamp(uint64_t ns) const
+{
+    switch (precision_)
+    {
+    case Precision::US:
+        return ns / 1000;
+    case Precision::MS:
+        return ns / 1000000;
+    case Precision::S:
+        return ns / 1000000000;
+    default:
+        return ns;
+    }
+}
+
+InfluxClient::~InfluxClient()
+{
+    disableAsync();
+    for (CURL *curl : idleHandles_)
+    {
+        curl_easy_cleanup(curl);
+    }
+    curl_slist_free_all(writeHeaders_);
+    curl_slist_free_all(gzipWriteHeaders_);
 }
 
 size_t InfluxClient::WriteCallback(void *contents, size_t size, size_t nmemb, std::string *response)
@@ -19,44 +166,286 @@ size_t InfluxClient::WriteCallback(void *contents, size_t size, size_t nmemb, st
     return totalSize;
 }
 
-bool InfluxClient::writeRaw(const std::string &lineProtocol)
+size_t InfluxClient::ChunkUpload::read(char *buffer, size_t capacity)
 {
-    CURL *curl = curl_easy_init();
+    size_t copied = 0;
 
-    if (!curl)
+    while (copied < capacity && index < chunks.size())
     {
-        std::cerr << "Failed to initialize CURL" << std::endl;
-        return false;
+        const std::string &chunk = chunks[index];
+        if (offset < chunk.size())
+        {
+            size_t n = std::min(capacity - copied, chunk.size() - offset);
+            std::memcpy(buffer + copied, chunk.data() + offset, n);
+            offset += n;
+            copied += n;
+            continue;
+        }
+
+        if (newlineTerminated && offset == chunk.size())
+        {
+            buffer[copied++] = '\n';
+            offset++;
+            continue;
+        }
+
+        index++;
+        offset = 0;
     }
+    return copied;
+}
 
-    std::string response;
-    std::string writeUrl = baseUrl_ + "/write?db=" + database_;
+void InfluxClient::ChunkUpload::rewind()
+{
+    index = 0;
+    offset = 0;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, writeUrl.c_str());
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, lineProtocol.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, lineProtocol.length());
+size_t InfluxClient::ChunkUpload::size() const
+{
+    return bodySize(chunks, newlineTerminated);
+}
+
+size_t InfluxClient::bodySize(std::span<const std::string> chunks, bool newlineTerminated)
+{
+    size_t total = newlineTerminated ? chunks.size() : 0;
+    for (const auto &chunk : chunks)
+    {
+        total += chunk.size();
+    }
+    return total;
+}
+
+size_t InfluxClient::ReadCallback(char *buffer, size_t size, size_t nitems, void *userdata)
+{
+    return static_cast<ChunkUpload *>(userdata)->read(buffer, size * nitems);
+}
 
-    // Set headers
-    struct curl_slist *headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: text/plain; charset=utf-8");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+// curl rewinds the body when it has to resend it (redirects, auth, reconnects)
+int InfluxClient::SeekCallback(void *userdata, int64_t offset, int origin)
+{
+    if (offset != 0 || origin != SEEK_SET)
+        return CURL_SEEKFUNC_CANTSEEK;
+
+    static_cast<ChunkUpload *>(userdata)->rewind();
+    return CURL_SEEKFUNC_OK;
+}
+
+CURL *InfluxClient::acquireHandle()
+{
+    CURL *curl = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        if (!idleHandles_.empty())
+        {
+            curl = idleHandles_.back();
+            idleHandles_.pop_back();
+        }
+    }
 
+    if (!curl)
+    {
+        curl = curl_easy_init();
+        if (!curl)
+            return nullptr;
+    }
+
+    // Options survive between requests only until releaseHandle() resets them
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, 5000L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 30000L);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    return curl;
+}
 
-    CURLcode res = curl_easy_perform(curl);
+void InfluxClient::releaseHandle(CURL *curl)
+{
+    // Reset clears per-request options but keeps the live connection
+    curl_easy_reset(curl);
 
-    curl_slist_free_all(headers);
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    if (idleHandles_.size() < maxIdleHandles_)
+    {
+        idleHandles_.push_back(curl);
+        return;
+    }
     curl_easy_cleanup(curl);
+}
+
+void InfluxClient::setWriteOptions(CURL *curl, const std::string &url, std::string_view body, bool gzip, std::string *response)
+{
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, gzip ? gzipWriteHeaders_ : writeHeaders_);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+}
+
+void InfluxClient::setUploadOptions(CURL *curl, ChunkUpload *upload, bool gzip, std::string *response)
+{
+    // No POSTFIELDS: curl pulls the body from the chunks as it fills the socket
+    curl_easy_setopt(curl, CURLOPT_URL, writeUrl_.c_str());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, ReadCallback);
+    curl_easy_setopt(curl, CURLOPT_READDATA, upload);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, SeekCallback);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, upload);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(upload->size()));
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, gzip ? gzipWriteHeaders_ : writeHeaders_);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+}
+
+InfluxClient::WriteOutcome InfluxClient::classify(bool transportOk, long status)
+{
+    if (!transportOk || status == 0)
+        return WriteOutcome::RETRY;
+    if (status >= 200 && status < 300)
+        return WriteOutcome::OK;
+    if (status == 413)
+        return WriteOutcome::TOO_LARGE;
+    if (status == 429 || status >= 500)
+        return WriteOutcome::RETRY;
+    if (status == 400)
+        return WriteOutcome::PARTIAL;
+    return WriteOutcome::REJECTED;
+}
+
+InfluxClient::WriteOutcome InfluxClient::finishRequest(CURL *curl, bool transportOk, const std::string &response,
+                                                       size_t bytes, std::chrono::milliseconds *retryAfter, bool observed)
+{
+    long status = 0;
+    curl_off_t totalUs = 0;
+    curl_off_t retryAfterSec = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &totalUs);
+    curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfterSec);
+
+    WriteOutcome outcome = classify(transportOk, status);
+    if (outcome != WriteOutcome::OK && transportOk)
+    {
+        // InfluxDB explains rejected and partial writes in a JSON error body
+        std::cerr << "InfluxDB write returned HTTP " << status << ": " << response.substr(0, 256) << std::endl;
+    }
 
+    if (retryAfter)
+        *retryAfter = std::chrono::seconds(retryAfterSec);
+
+    if (writeObserver_ && observed)
+        writeObserver_({outcome, status, totalUs / 1000.0, bytes});
+    return outcome;
+}
+
+std::chrono::milliseconds InfluxClient::retryDelay(int attempt, std::chrono::milliseconds retryAfter)
+{
+    // Exponential backoff from 500ms with jitter, never shorter than Retry-After
+    static thread_local std::minstd_rand rng(std::random_device{}());
+    long base = 500L << std::min(attempt, 6);
+    long jitter = std::uniform_int_distribution<long>(0, base / 4)(rng);
+    return std::max(std::chrono::milliseconds(base + jitter), retryAfter);
+}
+
+bool InfluxClient::writeRaw(const std::string &lineProtocol)
+{
+    return post(writeUrl_, lineProtocol, false) == WriteOutcome::OK;
+}
+
+// Blocking writes make a single attempt and never sleep on the caller's thread;
+// retries with backoff belong to the async worker and the spool replayer
+InfluxClient::WriteOutcome InfluxClient::post(const std::string &url, std::string_view body, bool gzip, bool observed)
+{
+    CURL *curl = acquireHandle();
+
+    if (!curl)
+    {
+        std::cerr << "Failed to initialize CURL" << std::endl;
+        return WriteOutcome::RETRY;
+    }
+
+    std::string response;
+    setWriteOptions(curl, url, body, gzip, &response);
+
+    CURLcode res = curl_easy_perform(curl);
     if (res != CURLE_OK)
     {
         std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
-        return false;
     }
 
-    return true;
+    WriteOutcome outcome = finishRequest(curl, res == CURLE_OK, response, body.size(), nullptr, observed);
+    releaseHandle(curl);
+    return outcome;
+}
+
+bool InfluxClient::postChunks(std::span<const std::string> chunks, bool newlineTerminated, bool gzip)
+{
+    WriteOutcome outcome = WriteOutcome::RETRY;
+    CURL *curl = acquireHandle();
+
+    if (!curl)
+    {
+        std::cerr << "Failed to initialize CURL" << std::endl;
+    }
+    else
+    {
+        std::string response;
+        ChunkUpload upload;
+        upload.chunks = chunks;
+        upload.newlineTerminated = newlineTerminated;
+        setUploadOptions(curl, &upload, gzip, &response);
+
+        CURLcode res = curl_easy_perform(curl);
+        if (res != CURLE_OK)
+        {
+            std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
+        }
+
+        outcome = finishRequest(curl, res == CURLE_OK, response, upload.size(), nullptr, true);
+        releaseHandle(curl);
+    }
+
+    if (outcome == WriteOutcome::OK)
+        return true;
+
+    // Lines can be split at any boundary; a gzip stream cannot
+    if (outcome == WriteOutcome::TOO_LARGE && newlineTerminated && chunks.size() > 1)
+    {
+        size_t half = chunks.size() / 2;
+        bool first = postChunks(chunks.first(half), newlineTerminated, gzip);
+        bool second = postChunks(chunks.subspan(half), newlineTerminated, gzip);
+        return first && second;
+    }
+
+    // Only a later attempt can help a retryable failure; resending a body the
+    // backend rejected, partially stored or cannot take in one piece cannot
+    if (failedWriteHandler_ && outcome == WriteOutcome::RETRY)
+        failedWriteHandler_(chunks, newlineTerminated, gzip);
+    return false;
+}
+
+InfluxClient::WriteOutcome InfluxClient::writeEncoded(std::string_view body, bool gzip, Precision precision)
+{
+    // Spooled bodies keep the precision they were encoded with; replays are
+    // not reported to the write observer, which tunes the live export
+    WriteOutcome outcome = post(precision == precision_ ? writeUrl_ : buildWriteUrl(precision), body, gzip, false);
+    if (outcome != WriteOutcome::TOO_LARGE || gzip)
+        return outcome;
+
+    // Uncompressed line protocol splits at the line boundary nearest the middle
+    size_t middle = body.find('\n', body.size() / 2);
+    if (middle == std::string_view::npos || middle + 1 >= body.size())
+        middle = body.rfind('\n', body.size() / 2);
+    if (middle == std::string_view::npos || middle == 0)
+        return outcome;
+
+    WriteOutcome first = writeEncoded(body.substr(0, middle + 1), gzip, precision);
+    if (first == WriteOutcome::RETRY)
+        return first;
+    WriteOutcome second = writeEncoded(body.substr(middle + 1), gzip, precision);
+    if (second == WriteOutcome::RETRY || first == WriteOutcome::OK)
+        return second;
+    return first;
 }
 
 bool InfluxClient::write(const std::string &measurement,
@@ -100,53 +489,402 @@ bool InfluxClient::write(const std::string &measurement,
     return writeRaw(lineProtocol.str());
 }
 
+bool InfluxClient::divertLines(std::span<const std::string> lines)
+{
+    if (!failedWriteHandler_)
+        return false;
+
+    failedWriteHandler_(lines, true, false);
+    return true;
+}
+
 bool InfluxClient::writeBatch(const std::vector<std::string> &lines)
 {
-    std::string batchData;
+    if (compressionLevel_ <= 0)
+    {
+        // Stream the caller's lines directly, nothing is copied into a body
+        size_t bytes = 0;
+        for (const auto &line : lines)
+        {
+            bytes += line.size() + 1;
+        }
+        rawBytesWritten_ += bytes;
+        encodedBytesWritten_ += bytes;
+        return postChunks(lines, true, false);
+    }
+
+    LineBatch batch = newBatch();
     for (const auto &line : lines)
     {
-        batchData += line + "\n";
+        batch.add(line);
+    }
+    return writeBatch(batch);
+}
+
+bool InfluxClient::writeBatch(LineBatch &batch)
+{
+    batch.finish();
+    rawBytesWritten_ += batch.raw_bytes();
+    encodedBytesWritten_ += batch.encoded_bytes();
+    return postChunks(batch.chunks(), batch.newline_terminated(), batch.compressed());
+}
+
+double InfluxClient::compressionRatio() const
+{
+    uint64_t encoded = encodedBytesWritten_;
+    return encoded > 0 ? static_cast<double>(rawBytesWritten_) / encoded : 1.0;
+}
+
+bool InfluxClient::enableAsync(size_t maxInFlight, size_t maxOutstandingBytes)
+{
+    if (asyncRunning_)
+        return true;
+
+    multi_ = curl_multi_init();
+    if (!multi_)
+    {
+        std::cerr << "Failed to initialize CURL multi handle" << std::endl;
+        return false;
+    }
+
+    maxInFlight_ = maxInFlight > 0 ? maxInFlight : 1;
+    maxOutstandingBytes_ = maxOutstandingBytes;
+    curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(maxInFlight_));
+
+    asyncRunning_ = true;
+    asyncThread_ = std::thread(&InfluxClient::asyncLoop, this);
+    return true;
+}
+
+void InfluxClient::disableAsync()
+{
+    if (!asyncRunning_)
+        return;
+
+    // The worker drains everything already queued before exiting
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        asyncRunning_ = false;
+    }
+    curl_multi_wakeup(multi_);
+    if (asyncThread_.joinable())
+    {
+        asyncThread_.join();
+    }
+
+    curl_multi_cleanup(multi_);
+    multi_ = nullptr;
+}
+
+bool InfluxClient::writeRawAsync(std::string lineProtocol, CompletionCallback callback)
+{
+    std::vector<std::string> chunks;
+    chunks.push_back(std::move(lineProtocol));
+    return postAsync(std::make_shared<const std::vector<std::string>>(std::move(chunks)),
+                     false, false, std::move(callback));
+}
+
+bool InfluxClient::postAsync(std::shared_ptr<const std::vector<std::string>> owner, bool newlineTerminated, bool gzip,
+                             CompletionCallback callback)
+{
+    std::span<const std::string> chunks = *owner;
+    size_t bytes = bodySize(chunks, newlineTerminated);
+    {
+        // Bound memory: wait for acknowledgements, but always admit one write
+        std::unique_lock<std::mutex> lock(asyncMutex_);
+        auto admissible = [this, bytes]()
+        { return !asyncRunning_ || outstandingBytes_ == 0 ||
+                 outstandingBytes_ + bytes <= maxOutstandingBytes_; };
+
+        // Divert instead of stalling the submitter when the backend falls behind
+        if (failedWriteHandler_ && !admissible())
+        {
+            lock.unlock();
+            failedWriteHandler_(chunks, newlineTerminated, gzip);
+            if (callback)
+                callback(false);
+            return false;
+        }
+        asyncCv_.wait(lock, admissible);
+
+        if (asyncRunning_)
+        {
+            auto *write = new AsyncWrite();
+            write->chunks = chunks;
+            write->owner = std::move(owner);
+            write->newlineTerminated = newlineTerminated;
+            write->bytes = bytes;
+            write->gzip = gzip;
+            write->callback = std::move(callback);
+            outstandingBytes_ += bytes;
+            pendingWrites_.push_back(write);
+            curl_multi_wakeup(multi_);
+            return true;
+        }
+    }
+
+    // Not in async mode: fall back to a blocking write
+    bool success = postChunks(chunks, newlineTerminated, gzip);
+    if (callback)
+        callback(success);
+    return success;
+}
+
+bool InfluxClient::writeBatchAsync(const std::vector<std::string> &lines, CompletionCallback callback)
+{
+    LineBatch batch = newBatch();
+    for (const auto &line : lines)
+    {
+        batch.add(line);
+    }
+    return writeBatchAsync(std::move(batch), std::move(callback));
+}
+
+bool InfluxClient::writeBatchAsync(LineBatch &&batch, CompletionCallback callback)
+{
+    batch.finish();
+    rawBytesWritten_ += batch.raw_bytes();
+    encodedBytesWritten_ += batch.encoded_bytes();
+    bool newlineTerminated = batch.newline_terminated();
+    bool gzip = batch.compressed();
+    return postAsync(std::make_shared<const std::vector<std::string>>(batch.release_chunks()),
+                     newlineTerminated, gzip, std::move(callback));
+}
+
+bool InfluxClient::writeBatchAsync(std::shared_ptr<const std::vector<std::string>> lines, CompletionCallback callback)
+{
+    if (compressionLevel_ > 0)
+    {
+        return writeBatchAsync(*lines, std::move(callback));
+    }
+
+    // Uncompressed lines are streamed as they are, without a copy
+    size_t bytes = bodySize(*lines, true);
+    rawBytesWritten_ += bytes;
+    encodedBytesWritten_ += bytes;
+    return postAsync(std::move(lines), true, false, std::move(callback));
+}
+
+void InfluxClient::flushAsync()
+{
+    std::unique_lock<std::mutex> lock(asyncMutex_);
+    asyncCv_.wait(lock, [this]()
+                  { return pendingWrites_.empty() && inFlight_ == 0; });
+}
+
+void InfluxClient::startPendingWrites()
+{
+    std::vector<AsyncWrite *> failed;
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        auto now = std::chrono::steady_clock::now();
+
+        // Writes waiting for a retry stay queued until their backoff expires
+        for (auto it = pendingWrites_.begin(); inFlight_ < maxInFlight_ && it != pendingWrites_.end();)
+        {
+            AsyncWrite *write = *it;
+            if (write->notBefore > now)
+            {
+                ++it;
+                continue;
+            }
+            it = pendingWrites_.erase(it);
+
+            write->curl = acquireHandle();
+            if (!write->curl)
+            {
+                outstandingBytes_ -= write->bytes;
+                failed.push_back(write);
+                continue;
+            }
+
+            // The chunks are owned by the write, so the upload can point into them
+            write->upload = ChunkUpload();
+            write->upload.chunks = write->chunks;
+            write->upload.newlineTerminated = write->newlineTerminated;
+            write->response.clear();
+            setUploadOptions(write->curl, &write->upload, write->gzip, &write->response);
+            curl_easy_setopt(write->curl, CURLOPT_PRIVATE, write);
+
+            curl_multi_add_handle(multi_, write->curl);
+            inFlight_++;
+        }
+    }
+
+    // Run callbacks without holding the lock
+    for (AsyncWrite *write : failed)
+    {
+        std::cerr << "Failed to initialize CURL" << std::endl;
+        if (failedWriteHandler_)
+            failedWriteHandler_(write->chunks, write->newlineTerminated, write->gzip);
+        if (write->callback)
+            write->callback(false);
+        delete write;
+    }
+    if (!failed.empty())
+        asyncCv_.notify_all();
+}
+
+void InfluxClient::completeWrite(AsyncWrite *write, bool transportOk)
+{
+    curl_multi_remove_handle(multi_, write->curl);
+
+    std::chrono::milliseconds retryAfter(0);
+    WriteOutcome outcome = finishRequest(write->curl, transportOk, write->response, write->bytes, &retryAfter, true);
+    releaseHandle(write->curl);
+    write->curl = nullptr;
+
+    if (outcome == WriteOutcome::TOO_LARGE && write->newlineTerminated && write->chunks.size() > 1)
+    {
+        // Resend both halves, the caller hears back once both have finished
+        struct SplitCompletion
+        {
+            int parts = 2;
+            bool success = true;
+            CompletionCallback callback;
+        };
+        auto split = std::make_shared<SplitCompletion>();
+        split->callback = std::move(write->callback);
+        auto partCallback = [split](bool success)
+        {
+            split->success = split->success && success;
+            if (--split->parts == 0 && split->callback)
+                split->callback(split->success);
+        };
+
+        size_t half = write->chunks.size() / 2;
+        auto *second = new AsyncWrite();
+        second->owner = write->owner;
+        second->chunks = write->chunks.subspan(half);
+        second->newlineTerminated = true;
+        second->bytes = bodySize(second->chunks, true);
+        second->gzip = write->gzip;
+        second->callback = partCallback;
+
+        write->chunks = write->chunks.first(half);
+        write->bytes -= second->bytes;
+        write->callback = partCallback;
+        write->attempts = 0;
+
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        inFlight_--;
+        pendingWrites_.push_front(second);
+        pendingWrites_.push_front(write);
+        return;
+    }
+
+    // Retry with backoff; when shutting down, hand over to the failed write handler right away
+    if (outcome == WriteOutcome::RETRY && write->attempts < maxRetries_ && (asyncRunning_ || !failedWriteHandler_))
+    {
+        write->notBefore = std::chrono::steady_clock::now() + retryDelay(write->attempts, retryAfter);
+        write->attempts++;
+
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        inFlight_--;
+        pendingWrites_.push_back(write);
+        return;
+    }
+
+    if (failedWriteHandler_ && outcome == WriteOutcome::RETRY)
+        failedWriteHandler_(write->chunks, write->newlineTerminated, write->gzip);
+
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        inFlight_--;
+    }
+    finishWrite(write, outcome == WriteOutcome::OK);
+}
+
+void InfluxClient::finishWrite(AsyncWrite *write, bool success)
+{
+    if (write->callback)
+        write->callback(success);
+
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        outstandingBytes_ -= write->bytes;
+    }
+    asyncCv_.notify_all();
+    delete write;
+}
+
+void InfluxClient::asyncLoop()
+{
+    while (true)
+    {
+        startPendingWrites();
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+
+        int queued = 0;
+        while (CURLMsg *msg = curl_multi_info_read(multi_, &queued))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            AsyncWrite *write = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char **>(&write));
+            CURLcode res = msg->data.result;
+            if (res != CURLE_OK)
+            {
+                std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
+            }
+            completeWrite(write, res == CURLE_OK);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(asyncMutex_);
+            if (!asyncRunning_ && pendingWrites_.empty() && inFlight_ == 0)
+                break;
+        }
+
+        // Sleeps until socket activity, a timeout or curl_multi_wakeup()
+        curl_multi_poll(multi_, nullptr, 0, 100, nullptr);
     }
-    return writeRaw(batchData);
 }
 
 bool InfluxClient::ping()
 {
-    CURL *curl = curl_easy_init();
+    CURL *curl = acquireHandle();
     if (!curl)
         return false;
 
     std::string response;
-    std::string pingUrl = baseUrl_ + "/ping";
 
-    curl_easy_setopt(curl, CURLOPT_URL, pingUrl.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_URL, pingUrl_.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
     CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    releaseHandle(curl);
 
-    return (res == CURLE_OK);
+    return res == CURLE_OK && status >= 200 && status < 300;
 }
 
 bool InfluxClient::createDatabase(const std::string &dbName)
 {
-    CURL *curl = curl_easy_init();
+    // v2 buckets are provisioned together with the org and token
+    if (v2_)
+        return true;
+
+    CURL *curl = acquireHandle();
     if (!curl)
         return false;
 
     std::string response;
-    std::string queryUrl = baseUrl_ + "/query";
     std::string postData = "q=CREATE DATABASE " + dbName;
 
-    curl_easy_setopt(curl, CURLOPT_URL, queryUrl.c_str());
+    curl_easy_setopt(curl, CURLOPT_URL, queryUrl_.c_str());
     curl_easy_setopt(curl, CURLOPT_POST, 1L);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
     CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    releaseHandle(curl);
 
-    return (res == CURLE_OK);
-}
\ No newline at end of file
+    return res == CURLE_OK && status >= 200 && status < 300;
+}
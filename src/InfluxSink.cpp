@@ -0,0 +1,45 @@
+#include "InfluxSink.hpp"
+#include "Logger.hpp"
+
+InfluxSink::InfluxSink(InfluxClient &client, size_t max_queued)
+    : MetricSink("influx", true, max_queued), client_(client)
+{
+}
+
+InfluxSink::~InfluxSink()
+{
+    stop();
+}
+
+bool InfluxSink::deliver(const MetricBatchPtr &batch)
+{
+    size_t count = batch->lines.size();
+
+    if (client_.isAsync())
+    {
+        // Share the lines with the client instead of copying them
+        std::shared_ptr<const std::vector<std::string>> lines(batch, &batch->lines);
+        return client_.writeBatchAsync(std::move(lines), [count](bool success)
+                                       {
+            if (success)
+            {
+                LOG_DEBUG("Successfully wrote batch of {} metrics", count);
+            }
+            else
+            {
+                Logger::error("Failed to write batch of " + std::to_string(count) + " metrics");
+            } });
+    }
+
+    if (!client_.writeBatch(batch->lines))
+    {
+        Logger::error("Failed to write batch of " + std::to_string(count) + " metrics");
+        return false;
+    }
+    return true;
+}
+
+bool InfluxSink::divert(const MetricBatchPtr &batch)
+{
+    return client_.divertLines(batch->lines);
+}
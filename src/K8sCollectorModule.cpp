@@ -0,0 +1,28 @@
+#include "K8sCollectorModule.hpp"
+#include "Logger.hpp"
+
+bool K8sCollectorModule::start(AgentContext &context)
+{
+    collector_ = std::make_unique<K8sPerformanceCollector>(context.influx, context.sinks, context.metadata);
+    try
+    {
+        collector_->configure_from_env();
+    }
+    catch (const std::exception &e)
+    {
+        Logger::error("Invalid K8S_* setting: " + std::string(e.what()));
+        collector_.reset();
+        return false;
+    }
+    collector_->set_probes(probes_);
+    collector_->start(&context.loop);
+    return collector_->is_running();
+}
+
+void K8sCollectorModule::stop()
+{
+    if (collector_)
+    {
+        collector_->stop();
+    }
+}
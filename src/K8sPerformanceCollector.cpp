@@ -1,22 +1,80 @@
 #include "K8sPerformanceCollector.hpp"
-#include <fstream>
+#include "InfluxSink.hpp"
 #include <sstream>
-#include <filesystem>
 #include <chrono>
-#include <regex>
 #include <unordered_set>
-
-// Initialize static member
-const std::chrono::seconds K8sPerformanceCollector::batch_flush_interval_(10);
+#include <cstring>
+#include <algorithm>
+#include <ctime>
+#include <cstdlib>
+#include <unistd.h>
+#include <map>
+
+static const char *default_spool_dir = "/var/lib/k8s-performance-monitor/spool";
+
+// Remove every pod not in kept and return the sum of their metrics. The sum
+// is written with an other=true tag, never as a pod that could be a real one.
+// The series prefix (measurement and pod tag) of every removed pod goes to folded.
+static std::unordered_map<std::string, double> fold_into_other(PodMetrics &metrics,
+                                                               const std::unordered_set<std::string> &kept,
+                                                               const std::string &measurement,
+                                                               std::unordered_set<std::string> &folded)
+{
+    std::unordered_map<std::string, double> other;
+    for (auto it = metrics.begin(); it != metrics.end();)
+    {
+        if (kept.count(it->first))
+        {
+            ++it;
+            continue;
+        }
+        for (const auto &[metric_name, value] : it->second)
+        {
+            other[metric_name] += value;
+        }
+        folded.insert(measurement + ",pod=" + escape_tag(it->first));
+        it = metrics.erase(it);
+    }
+    return other;
+}
 
 K8sPerformanceCollector::K8sPerformanceCollector(const std::string &protocol,
                                                  const std::string &host,
                                                  int port,
                                                  const std::string &database)
-    : influx_(protocol, host, port, database),
-      ring_reader_("/sys/fs/bpf/cpu_events", "/sys/fs/bpf/memory_events", "/sys/fs/bpf/syscall_latency_events"),
+    : K8sPerformanceCollector(std::make_unique<InfluxClient>(protocol, host, port, database), nullptr, nullptr, nullptr)
+{
+}
+
+K8sPerformanceCollector::K8sPerformanceCollector(InfluxClient &influx, MetricFanout &sinks, PodMetadataCache &metadata)
+    : K8sPerformanceCollector(nullptr, &influx, &sinks, &metadata)
+{
+}
+
+K8sPerformanceCollector::K8sPerformanceCollector(std::unique_ptr<InfluxClient> own_influx, InfluxClient *influx,
+                                                 MetricFanout *sinks, PodMetadataCache *metadata)
+    : own_influx_(std::move(own_influx)),
+      influx_(influx ? *influx : *own_influx_),
+      own_metadata_(metadata ? nullptr : std::make_unique<PodMetadataCache>()),
+      metadata_(metadata ? *metadata : *own_metadata_),
+      shared_(influx != nullptr),
+      probes_(K8S_RING_PROBES | BPF_PROBE_RUNQUEUE_LATENCY),
+      cgroup_filter_("/sys/fs/cgroup"),
+      cgroup_filter_mode_(CgroupFilterMode::ALLOWLIST),
       running_(false),
-      last_batch_flush_(std::chrono::steady_clock::now())
+      num_shards_(1),
+      workers_running_(false),
+      queued_events_(0),
+      last_outgoing_flush_(std::chrono::steady_clock::now()),
+      spool_(shared_ ? nullptr : std::make_unique<WriteSpool>(default_spool_dir)),
+      spool_replay_rate_(1024 * 1024),
+      sinks_(sinks ? *sinks : own_sinks_),
+      top_k_(TOPK_DEFAULT),
+      rollup_windows_({std::chrono::seconds(1), std::chrono::seconds(10), std::chrono::seconds(60)}),
+      rollup_only_(false),
+      num_cpus_(static_cast<int>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)))),
+      traced_syscalls_(default_traced_syscalls()),
+      kernel_syscall_filter_(false)
 {
 }
 
@@ -25,34 +83,248 @@ K8sPerformanceCollector::~K8sPerformanceCollector()
     stop();
 }
 
-void K8sPerformanceCollector::start()
+void K8sPerformanceCollector::set_spool(const std::string &dir, size_t max_bytes, size_t replay_bytes_per_sec)
+{
+    if (dir.empty())
+    {
+        spool_.reset();
+        return;
+    }
+    spool_ = std::make_unique<WriteSpool>(dir, max_bytes);
+    spool_replay_rate_ = replay_bytes_per_sec;
+}
+
+void K8sPerformanceCollector::set_top_k(size_t k)
+{
+    top_k_ = k;
+}
+
+void K8sPerformanceCollector::configure_from_env()
 {
-    if (!ring_reader_.open())
+    // Optional comma-separated list of syscall numbers to trace, e.g. "0,1,257"
+    if (const char *traced = std::getenv("K8S_TRACED_SYSCALLS"))
+    {
+        std::unordered_set<int> syscall_ids;
+        std::stringstream list(traced);
+        std::string item;
+        while (std::getline(list, item, ','))
+        {
+            if (!item.empty())
+                syscall_ids.insert(std::stoi(item));
+        }
+        set_traced_syscalls(syscall_ids);
+        Logger::info("Tracing " + std::to_string(syscall_ids.size()) + " syscalls from K8S_TRACED_SYSCALLS");
+    }
+
+    // Optional ring buffer wakeup watermark in bytes (0 wakes on every event)
+    if (const char *watermark = std::getenv("K8S_RINGBUF_WAKEUP_WATERMARK"))
+    {
+        set_ringbuf_wakeup_watermark(std::stoull(watermark));
+    }
+
+    // Cgroup filter mode: "allowlist" (default, workloads only), "denylist" or "off"
+    if (const char *mode = std::getenv("K8S_CGROUP_FILTER"))
+    {
+        std::string mode_str(mode);
+        if (mode_str == "off")
+            set_cgroup_filter_mode(CgroupFilterMode::OFF);
+        else if (mode_str == "denylist")
+            set_cgroup_filter_mode(CgroupFilterMode::DENYLIST);
+        else
+            set_cgroup_filter_mode(CgroupFilterMode::ALLOWLIST);
+    }
+
+    // Pods and commands exported individually per interval, the rest summed into other=true series (0 exports all)
+    if (const char *top_k = std::getenv("K8S_TOP_K"))
+    {
+        set_top_k(std::stoul(top_k));
+    }
+
+    // Rollup window durations in seconds, e.g. "1,10,60" (the default), "" disables rollups
+    if (const char *windows = std::getenv("K8S_ROLLUP_WINDOWS"))
+    {
+        std::vector<std::chrono::seconds> durations;
+        std::stringstream list(windows);
+        std::string item;
+        while (std::getline(list, item, ','))
+        {
+            if (!item.empty())
+                durations.push_back(std::chrono::seconds(std::stol(item)));
+        }
+        set_rollup_windows(durations);
+    }
+
+    // One line per pod/container and window instead of one per event
+    if (const char *rollup_only = std::getenv("K8S_ROLLUP_ONLY"))
+    {
+        set_rollup_only(std::string(rollup_only) == "1");
+    }
+
+    // Aggregated series are rewritten on a relative change above K8S_EMIT_EPSILON (default 0.01)
+    // or after K8S_EMIT_MAX_SILENCE_S seconds (default 300, 0 writes them every interval)
+    if (std::getenv("K8S_EMIT_EPSILON") || std::getenv("K8S_EMIT_MAX_SILENCE_S"))
+    {
+        double epsilon = CHANGE_FILTER_DEFAULT_EPSILON;
+        long max_silence = CHANGE_FILTER_DEFAULT_MAX_SILENCE_S;
+        if (const char *value = std::getenv("K8S_EMIT_EPSILON"))
+            epsilon = std::stod(value);
+        if (const char *value = std::getenv("K8S_EMIT_MAX_SILENCE_S"))
+            max_silence = std::stol(value);
+        set_change_suppression(epsilon, std::chrono::seconds(max_silence));
+    }
+
+    // Event processing shards, 0 runs one per CPU (default 1, on the reader thread)
+    if (const char *shards = std::getenv("K8S_SHARDS"))
+    {
+        long n = std::stol(shards);
+        set_shards(n > 0 ? static_cast<size_t>(n) : static_cast<size_t>(num_cpus_));
+    }
+
+    // Write latency in ms the adaptive batching aims for
+    if (const char *latency = std::getenv("K8S_INFLUX_TARGET_LATENCY_MS"))
+    {
+        set_target_write_latency(std::chrono::milliseconds(std::stol(latency)));
+    }
+}
+
+void K8sPerformanceCollector::start(AgentLoop *loop)
+{
+    // Load and attach the embedded probes, no external pinning step needed
+    if (!bpf_loader_.load(probes_))
+    {
+        Logger::error("Failed to load BPF probes");
+        return;
+    }
+
+    bool rings = probes_ & K8S_RING_PROBES;
+    if (rings && !ring_reader_.open(bpf_loader_.cpu_events_fd(),
+                                    bpf_loader_.memory_events_fd(),
+                                    bpf_loader_.syscall_latency_events_fd()))
     {
         Logger::error("Failed to open ring buffers");
         return;
     }
 
+    // Run-queue delays stay in the kernel as per-cgroup histograms until the flush reads them
+    if (probes_ & BPF_PROBE_RUNQUEUE_LATENCY)
+    {
+        runqueue_reader_ = std::make_unique<RunqueueLatencyReader>(bpf_loader_.runqueue_latency_fd());
+    }
+
+    // Select syscalls in the kernel so unselected ones never reach the ring buffer
+    kernel_syscall_filter_ = load_syscall_filter();
+    if (!kernel_syscall_filter_ && (probes_ & BPF_PROBE_SYSCALL_LATENCY))
+    {
+        Logger::warn("Syscall filter map unavailable, filtering syscalls in user space");
+    }
+
+    // Discard non-workload and self-generated events in the kernel
+    if (cgroup_filter_mode_ != CgroupFilterMode::OFF)
+    {
+        if (cgroup_filter_.open(bpf_loader_.cgroup_filter_fd(), bpf_loader_.cgroup_filter_config_fd()))
+        {
+            cgroup_filter_.refresh();
+            cgroup_filter_.enable(cgroup_filter_mode_);
+            cgroup_filter_.start_refreshing();
+        }
+        else
+        {
+            Logger::warn("Cgroup filter maps unavailable, tracing all processes");
+        }
+    }
+
+    // Adapt batch size and flush interval to how fast InfluxDB answers. A
+    // shared exporter is already writing for the other modules, its requests
+    // are not ours and its observer cannot be set while it runs; the batch
+    // size and interval stay as configured there.
+    if (!shared_)
+    {
+        influx_.setWriteObserver([this](const InfluxClient::WriteResult &result)
+                                 { batch_tuner_.on_write(result); });
+    }
+
+    start_shards();
+    running_ = true;
+
+    // The agent owns the exporter and the loop, its timers replace our threads
+    if (shared_ && loop)
+    {
+        ring_reader_.set_tick_callback([this]()
+                                       { on_reader_tick(); });
+        ring_reader_.set_callbacks(
+            [this](const cpu_event &event)
+            { dispatch(event.tgid, event); },
+            [this](const memory_event &event)
+            { dispatch(event.tgid, event); },
+            [this](const syscall_latency_event &event)
+            { dispatch(event.tgid, event); });
+        if (rings)
+        {
+            loop->add_fd(ring_reader_.epoll_fd(), [this]()
+                         { ring_reader_.consume(); });
+            loop->add_timer(std::chrono::milliseconds(100), [this]()
+                            { ring_reader_.consume(); }); // Drain below the wakeup watermark
+        }
+        loop->add_timer(std::chrono::seconds(30), [this]()
+                        { flush_aggregated_metrics(); });
+        Logger::info("K8s Performance Collector started on the agent loop");
+        return;
+    }
+
     // Create database if it doesn't exist
     if (!influx_.createDatabase("k8s_performance"))
     {
         Logger::warn("Failed to create database, it might already exist");
     }
 
-    running_ = true;
+    // Keep undeliverable batches on disk instead of dropping them
+    if (spool_ && spool_->open())
+    {
+        influx_.setFailedWriteHandler([this](std::span<const std::string> chunks, bool newline_terminated, bool gzip)
+                                      { spool_->append(chunks, newline_terminated, gzip, influx_.precision()); });
+        spool_->start_replay(influx_, spool_replay_rate_);
+    }
+    else if (spool_)
+    {
+        Logger::warn("Write spool unavailable, batches are dropped while InfluxDB is down");
+        spool_.reset();
+    }
+
+    // Keep several batches in flight so export is not bound by round trips
+    if (!influx_.enableAsync())
+    {
+        Logger::warn("Async InfluxDB writes unavailable, writing synchronously");
+    }
+
+    // Every sink gets its own worker, a slow one cannot stall event processing
+    if (sinks_.empty())
+    {
+        sinks_.add(std::make_unique<InfluxSink>(influx_));
+    }
+    if (!sinks_.start())
+    {
+        Logger::warn("Some metric sinks failed to start, their metrics are dropped");
+    }
 
     // Start processing events
-    process_thread_ = std::thread(&K8sPerformanceCollector::process_events, this);
+    if (rings)
+    {
+        process_thread_ = std::thread(&K8sPerformanceCollector::process_events, this);
+    }
 
     // Start periodic k8s info updates
-    std::thread update_thread([this]()
-                              {
+    update_thread_ = std::thread([this]()
+                                 {
+        std::unique_lock<std::mutex> lock(update_mutex_);
         while (running_) {
-            update_k8s_info_cache();
+            lock.unlock();
+            if (own_metadata_)
+                own_metadata_->refresh();
             flush_aggregated_metrics();
-            std::this_thread::sleep_for(std::chrono::seconds(30));
+            lock.lock();
+            update_cv_.wait_for(lock, std::chrono::seconds(30), [this]()
+                                { return !running_; });
         } });
-    update_thread.detach();
 
     Logger::info("K8s Performance Collector started");
 }
@@ -61,197 +333,374 @@ void K8sPerformanceCollector::stop()
 {
     if (running_)
     {
-        running_ = false;
+        {
+            std::lock_guard<std::mutex> lock(update_mutex_);
+            running_ = false;
+        }
+        update_cv_.notify_all();
+        if (update_thread_.joinable())
+        {
+            update_thread_.join();
+        }
         if (process_thread_.joinable())
         {
             process_thread_.join();
         }
         ring_reader_.stop_reading();
-        flush_batch();              // Flush any remaining data
-        flush_aggregated_metrics(); // Flush final aggregated metrics
+        ring_reader_.get_stats().report("K8s");
+        cgroup_filter_.stop_refreshing();
+        cgroup_filter_.disable();
+        stop_shards();                      // Process what was handed over
+        advance_rollups(0, true);           // Partial windows
+        for (auto &shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            flush_batch(*shard);            // Flush any remaining data
+        }
+        publish_outgoing(true);
+        flush_aggregated_metrics();         // Flush final aggregated metrics
+        bpf_loader_.destroy();              // After the last read of its maps
+        if (!shared_)
+        {
+            sinks_.stop();          // Deliver what the sinks still have queued
+            sinks_.report();
+            influx_.disableAsync(); // Wait for in-flight writes
+        }
+        if (spool_)
+        {
+            spool_->close(); // Whatever is left is replayed on the next start
+            Logger::info("Write spool: " + std::to_string(spool_->spooled_batches()) + " batches spooled, " +
+                         std::to_string(spool_->replayed_batches()) + " replayed, " +
+                         std::to_string(spool_->dropped_records()) + " refused, " +
+                         std::to_string(spool_->dropped_bytes()) + " bytes dropped, " +
+                         std::to_string(spool_->size_bytes()) + " bytes pending");
+        }
+        if (aggregate_filter_.enabled())
+        {
+            Logger::info("Change suppression: " +
+                         std::to_string(aggregate_filter_.suppressed() + rollup_filter_.suppressed()) + " series writes skipped, " +
+                         std::to_string(aggregate_filter_.emitted() + rollup_filter_.emitted()) + " written");
+        }
+        Logger::info("Final batch size " + std::to_string(batch_tuner_.batch_size()) +
+                     ", flush interval " + std::to_string(batch_tuner_.flush_interval().count()) + "ms");
         Logger::info("K8s Performance Collector stopped");
     }
 }
 
 void K8sPerformanceCollector::process_events()
 {
+    ring_reader_.set_tick_callback([this]()
+                                   { on_reader_tick(); });
     ring_reader_.start_reading(
         [this](const cpu_event &event)
         {
-            handle_cpu_event(event);
+            dispatch(event.tgid, event);
         },
         [this](const memory_event &event)
         {
-            handle_memory_event(event);
+            dispatch(event.tgid, event);
         },
         [this](const syscall_latency_event &event)
         {
-            handle_syscall_latency_event(event);
+            dispatch(event.tgid, event);
         });
 }
 
-void K8sPerformanceCollector::handle_cpu_event(const cpu_event &event)
+void K8sPerformanceCollector::start_shards()
 {
-    Logger::debug("CPU Event received - PID: " + std::to_string(event.pid) +
-                  ", TGID: " + std::to_string(event.tgid) +
-                  ", Runtime: " + std::to_string(event.runtime_ns) + "ns");
-    std::string pod_info = get_pod_info(event.tgid);
-    Logger::debug("Pod info for PID " + std::to_string(event.tgid) + ": " + pod_info);
+    size_t capacity = std::max<size_t>(top_k_, 1) * TOPK_CAPACITY_FACTOR;
+    shards_.clear();
+    for (size_t i = 0; i < num_shards_; i++)
+    {
+        shards_.push_back(std::make_unique<CollectorShard>(capacity));
+        shards_.back()->rollups.configure(rollup_windows_);
+    }
 
-    if (pod_info != "unknown" || true)
+    // A single shard is processed inline, a worker would only add a handoff
+    if (shards_.size() > 1)
     {
-        std::string metric_line = format_cpu_metric(event, pod_info);
-        if (!metric_line.empty())
+        workers_running_ = true;
+        for (auto &shard : shards_)
         {
-            batch_buffer_.push_back(metric_line);
-            Logger::debug("Added CPU metric to batch. Batch size: " + std::to_string(batch_buffer_.size()));
-
-            // Update aggregated metrics
-            update_pod_metrics(pod_info, "cpu_time_ns", event.runtime_ns);
-            update_pod_metrics(pod_info, "cpu_usage", event.runtime_ns / 1000000.0); // Convert to ms
+            shard->worker = std::thread(&K8sPerformanceCollector::shard_worker, this, std::ref(*shard));
+        }
+        Logger::info("Processing events on " + std::to_string(shards_.size()) + " shards");
+    }
+}
 
-            // Check if we should flush the batch
-            auto now = std::chrono::steady_clock::now();
-            if (batch_buffer_.size() >= max_batch_size_ ||
-                (now - last_batch_flush_) > batch_flush_interval_)
-            {
-                flush_batch();
-            }
+void K8sPerformanceCollector::stop_shards()
+{
+    hand_over();
+    workers_running_ = false;
+    for (auto &shard : shards_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(shard->queue_mutex);
         }
-        else
+        shard->queue_cv.notify_all();
+        if (shard->worker.joinable())
+        {
+            shard->worker.join();
+        }
+        if (shard->dropped > 0)
         {
-            Logger::debug("Skipping CPU event for unknown pod (PID: " + std::to_string(event.tgid) + ")");
+            Logger::warn("Shard dropped " + std::to_string(shard->dropped) + " events it could not keep up with");
         }
     }
 }
 
-void K8sPerformanceCollector::handle_memory_event(const memory_event &event)
+void K8sPerformanceCollector::dispatch(__u32 tgid, const CollectorEvent &event)
 {
-    Logger::debug("Memory Event received - PID: " + std::to_string(event.pid) +
-                  ", TGID: " + std::to_string(event.tgid) +
-                  ", RSS: " + std::to_string(event.rss_kb) + "KB");
-    std::string pod_info = get_pod_info(event.tgid);
+    CollectorShard &shard = *shards_[tgid % shards_.size()];
+    if (shards_.size() == 1)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        process(shard, event);
+        return;
+    }
+
+    // Handed over once per reader tick rather than once per event
+    shard.pending.push_back(event);
+}
+
+// One budget for every shard, so adding shards does not multiply the memory
+// a stalled collector can hold
+static const size_t max_queued_events = COLLECTOR_MAX_QUEUED_BYTES / sizeof(CollectorEvent);
 
-    if (pod_info != "unknown" || true)
+void K8sPerformanceCollector::hand_over()
+{
+    for (auto &shard : shards_)
     {
-        std::string metric_line = format_memory_metric(event, pod_info);
-        if (!metric_line.empty())
-        {
-            batch_buffer_.push_back(metric_line);
-            Logger::debug("Added Memory metric to batch. Batch size: " + std::to_string(batch_buffer_.size()));
+        if (shard->pending.empty())
+            continue;
 
-            // Update aggregated metrics based on event type
-            switch (event.event_type)
+        {
+            std::lock_guard<std::mutex> lock(shard->queue_mutex);
+            if (queued_events_ + shard->pending.size() > max_queued_events)
             {
-            case EVENT_MEMORY_ALLOC:
-                Logger::debug("Memory EVENT_MEMORY_ALLOC");
-                update_pod_metrics(pod_info, "memory_alloc_kb", event.rss_kb);
-                break;
-            case EVENT_MEMORY_FREE:
-                Logger::debug("Memory EVENT_MEMORY_FREE");
-                update_pod_metrics(pod_info, "memory_free_kb", event.rss_kb);
-                break;
-            case EVENT_MEMORY_REPORT:
-                Logger::debug("Memory EVENT_MEMORY_REPORT");
-                update_pod_metrics(pod_info, "memory_rss_kb", event.rss_kb);
-                update_pod_metrics(pod_info, "memory_cache_kb", event.cache_kb);
-                break;
+                shard->dropped += shard->pending.size(); // the workers cannot keep up, shed instead of growing
             }
-
-            // Check if we should flush the batch
-            auto now = std::chrono::steady_clock::now();
-            if (batch_buffer_.size() >= max_batch_size_ ||
-                (now - last_batch_flush_) > batch_flush_interval_)
+            else
             {
-                flush_batch();
+                queued_events_ += shard->pending.size();
+                if (shard->queue.empty())
+                    shard->queue.swap(shard->pending);
+                else
+                    shard->queue.insert(shard->queue.end(), shard->pending.begin(), shard->pending.end());
             }
         }
-        else
+        shard->pending.clear();
+        shard->queue_cv.notify_one();
+    }
+}
+
+void K8sPerformanceCollector::shard_worker(CollectorShard &shard)
+{
+    std::vector<CollectorEvent> events;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(shard.queue_mutex);
+            shard.queue_cv.wait(lock, [&]()
+                                { return !shard.queue.empty() || !workers_running_; });
+            if (shard.queue.empty())
+                break; // stopped and drained
+            events.swap(shard.queue);
+            queued_events_ -= events.size();
+        }
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto &event : events)
         {
-            Logger::debug("Skipping Memory event for unknown pod (PID: " + std::to_string(event.tgid) + ")");
+            process(shard, event);
         }
+        events.clear();
     }
 }
 
-void K8sPerformanceCollector::handle_syscall_latency_event(const syscall_latency_event &event)
+void K8sPerformanceCollector::process(CollectorShard &shard, const CollectorEvent &event)
 {
-    Logger::debug("Syscall Latency Event received - PID: " + std::to_string(event.pid) +
-                  ", TGID: " + std::to_string(event.tgid) +
-                  ", Syscall: " + std::to_string(event.syscall_id) +
-                  ", Latency: " + std::to_string(event.runtime_ns) + "ns");
+    if (const auto *cpu = std::get_if<cpu_event>(&event))
+        handle_cpu_event(shard, *cpu);
+    else if (const auto *memory = std::get_if<memory_event>(&event))
+        handle_memory_event(shard, *memory);
+    else
+        handle_syscall_latency_event(shard, std::get<syscall_latency_event>(event));
 
-    std::string pod_info = get_pod_info(event.tgid);
+    // Shards pass on slices of the batch size, merged into full batches
+    auto now = std::chrono::steady_clock::now();
+    if (shard.batch_buffer.size() >= std::max<size_t>(batch_tuner_.batch_size() / shards_.size(), 1) ||
+        (now - shard.last_batch_flush) > batch_tuner_.flush_interval())
+    {
+        flush_batch(shard);
+    }
+}
 
-    if (pod_info != "unknown" || true)
+const PodInfo &K8sPerformanceCollector::get_pod_info(CollectorShard &shard, __u32 tgid)
+{
+    // Only this shard sees the tgid, so the slice needs no lock of the shared cache
+    uint64_t generation = metadata_.generation();
+    if (shard.metadata_generation != generation)
     {
-        // Only process important syscalls to reduce noise
-        if (is_important_syscall(event.syscall_id))
-        {
-            std::string metric_line = format_syscall_latency_metric(event, pod_info);
-            if (!metric_line.empty())
-            {
-                batch_buffer_.push_back(metric_line);
-                Logger::debug("Added Syscall Latency metric to batch. Batch size: " + std::to_string(batch_buffer_.size()));
-
-                // Update aggregated metrics
-                std::string syscall_name = get_syscall_name(event.syscall_id);
-
-                // General syscall metrics
-                update_pod_metrics(pod_info, "syscall_latency_ns", event.runtime_ns);
-                update_pod_metrics(pod_info, "syscall_count", 1);
-                update_pod_metrics(pod_info, "syscall_" + syscall_name + "_latency_ns", event.runtime_ns);
-                update_pod_metrics(pod_info, "syscall_" + syscall_name + "_count", 1);
-
-                // IO-specific metrics
-                if (is_io_syscall(event.syscall_id))
-                {
-                    update_io_pod_metrics(pod_info, "io_latency_ns", event.runtime_ns);
-                    update_io_pod_metrics(pod_info, "io_ops_count", 1);
-                    update_io_pod_metrics(pod_info, "io_" + syscall_name + "_latency_ns", event.runtime_ns);
-                    update_io_pod_metrics(pod_info, "io_" + syscall_name + "_count", 1);
-                }
-
-                // Check if we should flush the batch
-                auto now = std::chrono::steady_clock::now();
-                if (batch_buffer_.size() >= max_batch_size_ ||
-                    (now - last_batch_flush_) > batch_flush_interval_)
-                {
-                    flush_batch();
-                }
-            }
-        }
-        else
+        shard.pods.clear();
+        shard.metadata_generation = generation;
+    }
+
+    auto it = shard.pods.find(tgid);
+    if (it == shard.pods.end())
+    {
+        it = shard.pods.emplace(tgid, metadata_.for_pid(tgid)).first;
+    }
+    return *it->second;
+}
+
+void K8sPerformanceCollector::handle_cpu_event(CollectorShard &shard, const cpu_event &event)
+{
+    LOG_DEBUG("CPU Event received - PID: {}, TGID: {}, Runtime: {}ns", event.pid, event.tgid, event.runtime_ns);
+    const PodInfo &pod_info = get_pod_info(shard, event.tgid);
+    LOG_DEBUG("Pod info for PID {}: {}", event.tgid, pod_info.pod);
+
+    if (!rollup_only_)
+    {
+        shard.batch_buffer.push_back(format_cpu_metric(event, pod_info));
+        LOG_DEBUG("Added CPU metric to batch. Batch size: {}", shard.batch_buffer.size());
+    }
+
+    if (shard.rollups.enabled())
+    {
+        RollupCounters &rollup = shard.rollups.at(event.timestamp, pod_info.pod, pod_info.container,
+                                                  pod_info.namespace_name);
+        rollup.cpu_ns += event.runtime_ns;
+    }
+
+    // Update aggregated metrics
+    IntervalAggregates &aggregates = shard.aggregates;
+    aggregates.pod_metrics[pod_info.pod]["cpu_time_ns"] += event.runtime_ns;
+    aggregates.pod_metrics[pod_info.pod]["cpu_usage"] += event.runtime_ns / 1000000.0; // Convert to ms
+    aggregates.top_pods_cpu.add(pod_info.pod, event.runtime_ns);
+    aggregates.top_commands_cpu.add(std::string(event.comm, strnlen(event.comm, sizeof(event.comm))), event.runtime_ns);
+}
+
+void K8sPerformanceCollector::handle_memory_event(CollectorShard &shard, const memory_event &event)
+{
+    LOG_DEBUG("Memory Event received - PID: {}, TGID: {}, RSS: {}KB", event.pid, event.tgid, event.rss_kb);
+    const PodInfo &pod_info = get_pod_info(shard, event.tgid);
+
+    if (!rollup_only_)
+    {
+        shard.batch_buffer.push_back(format_memory_metric(event, pod_info));
+        LOG_DEBUG("Added Memory metric to batch. Batch size: {}", shard.batch_buffer.size());
+    }
+
+    if (shard.rollups.enabled())
+    {
+        RollupCounters &rollup = shard.rollups.at(event.timestamp, pod_info.pod, pod_info.container,
+                                                  pod_info.namespace_name);
+        if (event.event_type == EVENT_MEMORY_ALLOC)
+            rollup.memory_alloc_kb += event.rss_kb;
+        else if (event.event_type == EVENT_MEMORY_FREE)
+            rollup.memory_free_kb += event.rss_kb;
+    }
+
+    // Update aggregated metrics based on event type
+    auto &metrics = shard.aggregates.pod_metrics[pod_info.pod];
+    switch (event.event_type)
+    {
+    case EVENT_MEMORY_ALLOC:
+        LOG_DEBUG("Memory EVENT_MEMORY_ALLOC");
+        metrics["memory_alloc_kb"] += event.rss_kb;
+        break;
+    case EVENT_MEMORY_FREE:
+        LOG_DEBUG("Memory EVENT_MEMORY_FREE");
+        metrics["memory_free_kb"] += event.rss_kb;
+        break;
+    case EVENT_MEMORY_REPORT:
+        LOG_DEBUG("Memory EVENT_MEMORY_REPORT");
+        metrics["memory_rss_kb"] += event.rss_kb;
+        metrics["memory_cache_kb"] += event.cache_kb;
+        break;
+    }
+}
+
+void K8sPerformanceCollector::handle_syscall_latency_event(CollectorShard &shard, const syscall_latency_event &event)
+{
+    LOG_DEBUG("Syscall Latency Event received - PID: {}, TGID: {}, Syscall: {}, Latency: {}ns",
+              event.pid, event.tgid, event.syscall_id, event.runtime_ns);
+
+    // The kernel only emits selected syscalls; re-check when it cannot filter
+    if (!kernel_syscall_filter_ && !is_traced_syscall(event.syscall_id))
+    {
+        LOG_DEBUG("Skipping untraced syscall: {}", event.syscall_id);
+        return;
+    }
+
+    const PodInfo &pod_info = get_pod_info(shard, event.tgid);
+    bool is_io = is_io_syscall(event.syscall_id);
+
+    if (!rollup_only_)
+    {
+        shard.batch_buffer.push_back(format_syscall_latency_metric(event, pod_info));
+        LOG_DEBUG("Added Syscall Latency metric to batch. Batch size: {}", shard.batch_buffer.size());
+    }
+
+    if (shard.rollups.enabled())
+    {
+        RollupCounters &rollup = shard.rollups.at(event.timestamp, pod_info.pod, pod_info.container,
+                                                  pod_info.namespace_name);
+        rollup.syscalls++;
+        rollup.syscall_latency_ns += event.runtime_ns;
+        if (is_io)
         {
-            Logger::debug("Skipping non-important syscall: " + std::to_string(event.syscall_id));
+            rollup.io_ops++;
+            rollup.io_latency_ns += event.runtime_ns;
         }
     }
-    else
+
+    // Update aggregated metrics
+    std::string syscall_name = get_syscall_name(event.syscall_id);
+    IntervalAggregates &aggregates = shard.aggregates;
+    aggregates.top_pods_syscalls.add(pod_info.pod);
+    aggregates.top_pods_latency.add(pod_info.pod, event.runtime_ns);
+    aggregates.top_commands_syscalls.add(std::string(event.comm, strnlen(event.comm, sizeof(event.comm))));
+
+    // General syscall metrics
+    auto &metrics = aggregates.pod_metrics[pod_info.pod];
+    metrics["syscall_latency_ns"] += event.runtime_ns;
+    metrics["syscall_count"] += 1;
+    metrics["syscall_" + syscall_name + "_latency_ns"] += event.runtime_ns;
+    metrics["syscall_" + syscall_name + "_count"] += 1;
+
+    // IO-specific metrics
+    if (is_io)
     {
-        Logger::debug("Skipping Syscall Latency event for unknown pod (PID: " + std::to_string(event.tgid) + ")");
+        auto &io_metrics = aggregates.io_pod_metrics[pod_info.pod];
+        io_metrics["io_latency_ns"] += event.runtime_ns;
+        io_metrics["io_ops_count"] += 1;
+        io_metrics["io_" + syscall_name + "_latency_ns"] += event.runtime_ns;
+        io_metrics["io_" + syscall_name + "_count"] += 1;
     }
 }
 
-std::string K8sPerformanceCollector::format_cpu_metric(const cpu_event &event, const std::string &pod_info)
+std::string K8sPerformanceCollector::format_cpu_metric(const cpu_event &event, const PodInfo &pod_info)
 {
     std::stringstream line;
 
     line << "cpu_usage";
-    line << ",pod=" << pod_info;
-    line << ",container=" << get_container_info(event.tgid);
-    line << ",namespace=" << get_namespace_info(event.tgid);
-    line << ",command=" << event.comm;
+    line << ",pod=" << escape_tag(pod_info.pod);
+    line << ",container=" << escape_tag(pod_info.container);
+    line << ",namespace=" << escape_tag(pod_info.namespace_name);
+    line << ",command=" << escape_tag(std::string(event.comm, strnlen(event.comm, sizeof(event.comm))));
     line << ",cpu_id=" << event.cpu_id;
     line << ",pid=" << event.pid;
     line << " ";
-    line << "runtime_ns=" << event.runtime_ns << "i";
-    line << ",usage_percent=" << (event.runtime_ns / 10000000.0); // Simplified calculation
+    line << "runtime_ns=" << event.runtime_ns << "i"; // utilization is in the windowed rollups
 
-    line << " " << event.timestamp;
+    line << " " << influx_.timestamp(event.timestamp);
 
     return line.str();
 }
 
-std::string K8sPerformanceCollector::format_memory_metric(const memory_event &event, const std::string &pod_info)
+std::string K8sPerformanceCollector::format_memory_metric(const memory_event &event, const PodInfo &pod_info)
 {
     std::stringstream line;
 
@@ -272,20 +721,20 @@ std::string K8sPerformanceCollector::format_memory_metric(const memory_event &ev
     }
 
     line << "memory_usage";
-    line << ",pod=" << pod_info;
-    line << ",container=" << get_container_info(event.tgid);
-    line << ",namespace=" << get_namespace_info(event.tgid);
-    line << ",command=" << event.comm;
+    line << ",pod=" << escape_tag(pod_info.pod);
+    line << ",container=" << escape_tag(pod_info.container);
+    line << ",namespace=" << escape_tag(pod_info.namespace_name);
+    line << ",command=" << escape_tag(std::string(event.comm, strnlen(event.comm, sizeof(event.comm))));
     line << ",event_type=" << event_type_str;
     line << " ";
     line << "rss_kb=" << event.rss_kb << "i";
     line << ",cache_kb=" << event.cache_kb << "i";
 
-    line << " " << event.timestamp;
+    line << " " << influx_.timestamp(event.timestamp);
     return line.str();
 }
 
-std::string K8sPerformanceCollector::format_syscall_latency_metric(const syscall_latency_event &event, const std::string &pod_info)
+std::string K8sPerformanceCollector::format_syscall_latency_metric(const syscall_latency_event &event, const PodInfo &pod_info)
 {
     std::stringstream line;
 
@@ -293,10 +742,10 @@ std::string K8sPerformanceCollector::format_syscall_latency_metric(const syscall
     bool is_io = is_io_syscall(event.syscall_id);
 
     line << "syscall_latency";
-    line << ",pod=" << pod_info;
-    line << ",container=" << get_container_info(event.tgid);
-    line << ",namespace=" << get_namespace_info(event.tgid);
-    line << ",command=" << event.comm;
+    line << ",pod=" << escape_tag(pod_info.pod);
+    line << ",container=" << escape_tag(pod_info.container);
+    line << ",namespace=" << escape_tag(pod_info.namespace_name);
+    line << ",command=" << escape_tag(std::string(event.comm, strnlen(event.comm, sizeof(event.comm))));
     line << ",syscall=" << syscall_name;
     line << ",syscall_id=" << event.syscall_id;
     line << ",is_io=" << (is_io ? "true" : "false");
@@ -305,276 +754,509 @@ std::string K8sPerformanceCollector::format_syscall_latency_metric(const syscall
     line << ",latency_us=" << (event.runtime_ns / 1000.0);
     line << ",latency_ms=" << (event.runtime_ns / 1000000.0);
 
-    line << " " << event.timestamp;
+    line << " " << influx_.timestamp(event.timestamp);
 
     return line.str();
 }
 
-void K8sPerformanceCollector::flush_batch()
+void K8sPerformanceCollector::flush_batch(CollectorShard &shard)
 {
-    if (batch_buffer_.empty())
+    if (shard.batch_buffer.empty())
     {
         return;
     }
 
-    try
+    bool full;
     {
-        if (influx_.writeBatch(batch_buffer_))
-        {
-            Logger::debug("Successfully wrote batch of " + std::to_string(batch_buffer_.size()) + " metrics");
-        }
+        std::lock_guard<std::mutex> lock(outgoing_mutex_);
+        if (outgoing_batch_.empty())
+            outgoing_batch_.swap(shard.batch_buffer);
         else
-        {
-            Logger::error("Failed to write batch of " + std::to_string(batch_buffer_.size()) + " metrics");
-        }
+            outgoing_batch_.insert(outgoing_batch_.end(), std::make_move_iterator(shard.batch_buffer.begin()),
+                                   std::make_move_iterator(shard.batch_buffer.end()));
+        full = outgoing_batch_.size() >= batch_tuner_.batch_size();
     }
-    catch (const std::exception &e)
+
+    shard.batch_buffer.clear();
+    shard.batch_buffer.reserve(std::max<size_t>(batch_tuner_.batch_size() / shards_.size(), 1));
+    shard.last_batch_flush = std::chrono::steady_clock::now();
+
+    if (full)
     {
-        Logger::error("Exception while writing batch: " + std::string(e.what()));
+        publish_outgoing(true);
     }
-
-    batch_buffer_.clear();
-    last_batch_flush_ = std::chrono::steady_clock::now();
 }
 
-void K8sPerformanceCollector::update_pod_metrics(const std::string &pod_name, const std::string &metric_name, double value)
+void K8sPerformanceCollector::publish_outgoing(bool force)
 {
-    pod_metrics_[pod_name][metric_name] += value;
+    std::vector<std::string> batch;
+    {
+        std::lock_guard<std::mutex> lock(outgoing_mutex_);
+        auto now = std::chrono::steady_clock::now();
+        if (outgoing_batch_.empty() || (!force && now - last_outgoing_flush_ <= batch_tuner_.flush_interval()))
+        {
+            return;
+        }
+        batch.swap(outgoing_batch_);
+        last_outgoing_flush_ = now;
+    }
+
+    LOG_DEBUG("Publishing batch of {} metrics", batch.size());
+    sinks_.publish(std::move(batch), false);
 }
 
-void K8sPerformanceCollector::update_io_pod_metrics(const std::string &pod_name, const std::string &metric_name, double value)
+void K8sPerformanceCollector::on_reader_tick()
 {
-    io_pod_metrics_[pod_name][metric_name] += value;
+    hand_over();
+
+    // Events carry CLOCK_TAI timestamps (bpf_ktime_get_tai_ns)
+    struct timespec ts;
+    clock_gettime(CLOCK_TAI, &ts);
+    advance_rollups(static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec, false);
+
+    // Quiet periods (or rollup-only mode) still flush on the interval
+    auto now = std::chrono::steady_clock::now();
+    for (auto &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (!shard->batch_buffer.empty() && now - shard->last_batch_flush > batch_tuner_.flush_interval())
+        {
+            flush_batch(*shard);
+        }
+    }
+    publish_outgoing(false);
 }
 
-void K8sPerformanceCollector::flush_aggregated_metrics()
+void K8sPerformanceCollector::advance_rollups(int64_t now_ns, bool final)
 {
-    std::vector<std::string> aggregated_batch;
+    // Every shard closes the same windows for the same now_ns; a series seen by
+    // several shards (processes of one container) is summed before it is written
+    struct ClosedWindow
+    {
+        int64_t duration_ns = 0;
+        std::unordered_map<std::string, RollupSeries> series;
+    };
+    std::map<std::pair<int64_t, int64_t>, ClosedWindow> closed; // by window and start
+    uint64_t late_events = 0;
 
-    // Flush general pod metrics
-    for (const auto &[pod_name, metrics] : pod_metrics_)
+    auto collect = [&closed](const RollupWindow &window)
     {
-        for (const auto &[metric_name, value] : metrics)
+        ClosedWindow &merged = closed[{window.window_ns, window.start_ns}];
+        merged.duration_ns = std::max(merged.duration_ns, window.duration_ns);
+        for (const auto &[key, entry] : window.series)
         {
-            std::stringstream line;
-            line << "pod_aggregated";
-            line << ",pod=" << pod_name;
-            line << ",metric=" << metric_name;
-            line << " ";
-            line << "value=" << value;
+            auto [it, inserted] = merged.series.try_emplace(key, entry);
+            if (!inserted)
+                it->second.counters.merge(entry.counters);
+        }
+    };
+    for (auto &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (final)
+            shard->rollups.flush(collect);
+        else
+            shard->rollups.advance(now_ns, collect);
+        late_events += shard->rollups.late_events();
+    }
 
-            // Add current timestamp in nanoseconds
-            auto now = std::chrono::system_clock::now();
-            auto timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                    now.time_since_epoch())
-                                    .count();
-            line << " " << timestamp_ns;
+    std::vector<std::string> batch;
+    for (const auto &[key, window] : closed)
+    {
+        append_rollup({key.second, key.first, window.duration_ns, window.series}, batch);
+    }
 
-            aggregated_batch.push_back(line.str());
+    // Windows without any event are never closed; once the window after the
+    // last written one is over, its series were idle
+    for (auto &[window_ns, previous] : previous_rollups_)
+    {
+        int64_t next_start_ns = previous.start_ns + window_ns;
+        if (!final && !previous.series.empty() && next_start_ns + window_ns <= now_ns - WINDOW_GRACE_NS)
+        {
+            append_silent_rollups(previous, {}, next_start_ns, batch);
+            previous.series.clear();
         }
     }
 
-    // Flush IO-specific pod metrics
-    for (const auto &[pod_name, metrics] : io_pod_metrics_)
+    // Aggregates like the interval flush, so the Prometheus endpoint serves them too
+    sinks_.publish(std::move(batch), true);
+
+    if (final && late_events > 0)
     {
-        for (const auto &[metric_name, value] : metrics)
-        {
-            std::stringstream line;
-            line << "io_aggregated";
-            line << ",pod=" << pod_name;
-            line << ",metric=" << metric_name;
-            line << " ";
-            line << "value=" << value;
+        Logger::info("Rollups: " + std::to_string(late_events) + " events arrived after their window closed");
+    }
+}
 
-            // Add current timestamp in nanoseconds
-            auto now = std::chrono::system_clock::now();
-            auto timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                    now.time_since_epoch())
-                                    .count();
-            line << " " << timestamp_ns;
+// Rates of one series over the window, CPU as cores used and as a share of all CPUs
+static std::vector<ChangeFilter::Field> rollup_fields(const RollupCounters &counters, double seconds, int num_cpus)
+{
+    double cores = counters.cpu_ns / (seconds * 1e9);
+    std::vector<ChangeFilter::Field> fields = {
+        {"cpu_cores", cores},
+        {"cpu_utilization", cores / num_cpus},
+        {"syscalls_per_sec", counters.syscalls / seconds},
+        {"io_ops_per_sec", counters.io_ops / seconds},
+        {"memory_alloc_kb_per_sec", counters.memory_alloc_kb / seconds},
+        {"memory_free_kb_per_sec", counters.memory_free_kb / seconds},
+    };
+    if (counters.syscalls > 0)
+    {
+        fields.emplace_back("syscall_latency_avg_ns", counters.syscall_latency_ns / counters.syscalls);
+    }
+    if (counters.io_ops > 0)
+    {
+        fields.emplace_back("io_latency_avg_ns", counters.io_latency_ns / counters.io_ops);
+    }
+    return fields;
+}
 
-            aggregated_batch.push_back(line.str());
-        }
+void K8sPerformanceCollector::append_rollup_line(const std::string &series, const RollupCounters &counters,
+                                                 double seconds, int64_t window_start_s, uint64_t timestamp,
+                                                 RollupSeriesNames &written, std::vector<std::string> &batch)
+{
+    std::vector<ChangeFilter::Field> fields = rollup_fields(counters, seconds, num_cpus_);
+    std::vector<const char *> &names = written[series];
+    for (const auto &field : fields)
+    {
+        names.push_back(field.first);
     }
 
-    if (!aggregated_batch.empty())
+    if (!rollup_filter_.admit(series, fields, window_start_s))
     {
-        if (influx_.writeBatch(aggregated_batch))
-        {
-            Logger::debug("Successfully wrote " + std::to_string(aggregated_batch.size()) + " aggregated metrics");
-        }
-        else
-        {
-            Logger::error("Failed to write aggregated metrics batch");
-        }
+        return;
     }
 
-    // Clear aggregated metrics after flushing
-    pod_metrics_.clear();
-    io_pod_metrics_.clear();
+    std::stringstream line;
+    line << series << " ";
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        line << (i ? "," : "") << fields[i].first << "=" << format_field(fields[i].second);
+    }
+    line << " " << timestamp;
+    batch.push_back(line.str());
 }
 
-std::string K8sPerformanceCollector::get_pod_info(__u32 pid)
+void K8sPerformanceCollector::append_rollup(const RollupWindow &window, std::vector<std::string> &batch)
 {
-    Logger::debug("=== get_pod_info called for PID: " + std::to_string(pid) + " ===");
+    std::string window_tag = std::to_string(window.window_ns / 1000000000) + "s";
+    uint64_t timestamp = influx_.timestamp(static_cast<uint64_t>(window.start_ns));
+    int64_t window_start_s = window.start_ns / 1000000000;
+    double seconds = window.duration_ns / 1e9;
+
+    // Pods sum their containers
+    RollupSeriesNames written;
+    std::unordered_map<std::string, RollupSeries> pods;
+    for (const auto &[key, series] : window.series)
+    {
+        append_rollup_line("container_rollup,window=" + window_tag + ",pod=" + escape_tag(series.pod) +
+                               ",container=" + escape_tag(series.container) +
+                               ",namespace=" + escape_tag(series.namespace_name),
+                           series.counters, seconds, window_start_s, timestamp, written, batch);
 
-    std::string cgroup_path = "/proc/" + std::to_string(pid) + "/cgroup";
-    Logger::debug("Reading cgroup from: " + cgroup_path);
+        auto [pod, inserted] = pods.try_emplace(series.pod + '/' + series.namespace_name, series);
+        if (!inserted)
+        {
+            pod->second.counters.merge(series.counters);
+        }
+    }
 
-    // Check if file exists
-    if (!std::filesystem::exists(cgroup_path))
+    for (const auto &[key, series] : pods)
     {
-        Logger::debug("Cgroup file does not exist for PID: " + std::to_string(pid));
-        return "unknown";
+        append_rollup_line("pod_rollup,window=" + window_tag + ",pod=" + escape_tag(series.pod) +
+                               ",namespace=" + escape_tag(series.namespace_name),
+                           series.counters, seconds, window_start_s, timestamp, written, batch);
     }
 
-    try
+    // Pods and containers of the previous window without events in this one
+    WrittenRollups &previous = previous_rollups_[window.window_ns];
+    append_silent_rollups(previous, written, window.start_ns, batch);
+    previous.start_ns = window.start_ns;
+    previous.series = std::move(written);
+    rollup_filter_.prune(window_start_s);
+}
+
+void K8sPerformanceCollector::append_silent_rollups(const WrittenRollups &previous, const RollupSeriesNames &current,
+                                                    int64_t start_ns, std::vector<std::string> &batch)
+{
+    // Written once as 0 so the last rates do not linger until the series expires
+    uint64_t timestamp = influx_.timestamp(static_cast<uint64_t>(start_ns));
+    int64_t window_start_s = start_ns / 1000000000;
+    for (const auto &[series, names] : previous.series)
     {
-        std::ifstream file(cgroup_path);
-        if (!file.is_open())
+        if (current.count(series))
         {
-            Logger::debug("Failed to open cgroup file for PID: " + std::to_string(pid));
-            return "unknown";
+            continue;
         }
 
-        std::string line;
-        int line_num = 0;
+        std::vector<ChangeFilter::Field> zeros;
+        for (const char *name : names)
+        {
+            zeros.emplace_back(name, 0.0);
+        }
+        rollup_filter_.admit(series, zeros, window_start_s);
 
-        while (std::getline(file, line))
+        std::stringstream line;
+        line << series << " ";
+        for (size_t i = 0; i < zeros.size(); i++)
         {
-            line_num++;
-            Logger::debug("Cgroup line " + std::to_string(line_num) + ": " + line);
+            line << (i ? "," : "") << zeros[i].first << "=0";
+        }
+        line << " " << timestamp;
+        batch.push_back(line.str());
+    }
+}
 
-            // Check for Kubernetes patterns
-            if (line.find("kubepods") != std::string::npos ||
-                line.find("docker") != std::string::npos ||
-                line.find("containerd") != std::string::npos)
-            {
+void K8sPerformanceCollector::flush_aggregated_metrics()
+{
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+    std::vector<std::string> aggregated_batch;
+
+    // Add current timestamp in nanoseconds
+    auto now = std::chrono::system_clock::now();
+    auto timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            now.time_since_epoch())
+                            .count();
+    std::string timestamp = std::to_string(influx_.timestamp(timestamp_ns));
+
+    // Take the interval's aggregates of every shard, events keep accumulating into fresh ones
+    IntervalAggregates totals(std::max<size_t>(top_k_, 1) * TOPK_CAPACITY_FACTOR);
+    for (auto &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        totals.merge(shard->aggregates);
+        shard->aggregates.clear();
+    }
+    PodMetrics &pod_metrics = totals.pod_metrics;
+    PodMetrics &io_pod_metrics = totals.io_pod_metrics;
 
-                std::string pod_info = extract_pod_from_cgroup(line);
-                Logger::debug("Found container runtime, extracted: " + pod_info);
+    std::unordered_set<std::string> heavy_pods;
+    if (top_k_ > 0)
+    {
+        append_top_k(aggregated_batch, totals.top_pods_cpu, "pod", "cpu_time_ns", timestamp);
+        append_top_k(aggregated_batch, totals.top_pods_syscalls, "pod", "syscall_count", timestamp);
+        append_top_k(aggregated_batch, totals.top_pods_latency, "pod", "syscall_latency_ns", timestamp);
+        append_top_k(aggregated_batch, totals.top_commands_cpu, "command", "cpu_time_ns", timestamp);
+        append_top_k(aggregated_batch, totals.top_commands_syscalls, "command", "syscall_count", timestamp);
 
-                if (pod_info != "unknown")
-                {
-                    pid_to_pod_[pid] = pod_info;
-                    return pod_info;
-                }
+        for (const SpaceSaving *tracker : {&totals.top_pods_cpu, &totals.top_pods_syscalls, &totals.top_pods_latency})
+        {
+            for (const auto &entry : tracker->top(top_k_))
+            {
+                heavy_pods.insert(entry.key);
             }
         }
-
-        Logger::debug("No container patterns found in cgroup for PID: " + std::to_string(pid));
     }
-    catch (const std::exception &e)
+
+    // Per-pod series only for heavy hitters, keeping exported cardinality bounded
+    PodMetrics other_metrics;
+    std::unordered_set<std::string> folded_pods;
+    if (top_k_ > 0)
     {
-        Logger::error("Exception reading cgroup for PID " + std::to_string(pid) + ": " + e.what());
+        other_metrics["pod_aggregated,other=true"] =
+            fold_into_other(pod_metrics, heavy_pods, "pod_aggregated", folded_pods);
+        other_metrics["io_aggregated,other=true"] =
+            fold_into_other(io_pod_metrics, heavy_pods, "io_aggregated", folded_pods);
     }
 
-    return "unknown";
-}
+    // Series that barely moved since they were last written are skipped until their heartbeat
+    int64_t now_s = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
 
-std::string K8sPerformanceCollector::extract_pod_from_cgroup(const std::string &cgroup_line)
-{
-    Logger::debug("Analyzing cgroup line: " + cgroup_line);
+    // Flush general pod metrics
+    for (const auto &[pod_name, metrics] : pod_metrics)
+    {
+        for (const auto &[metric_name, value] : metrics)
+        {
+            append_aggregate(aggregated_batch, "pod_aggregated,pod=" + escape_tag(pod_name) + ",metric=" + metric_name,
+                             {{"value", value}}, timestamp, now_s);
+        }
+    }
 
-    // Multiple patterns to match different Kubernetes cgroup formats
-    std::vector<std::regex> patterns = {
-        std::regex("pod([a-f0-9_-]+)\\.slice"),                                          // systemd with slices (supports _ and -)
-        std::regex("pod([a-f0-9_-]+)/"),                                                 // cgroupfs format (supports _ and -)
-        std::regex("kubepods[^/]*/pod([a-f0-9_-]+)"),                                    // kubepods prefix (supports _ and -)
-        std::regex("kubepods[^/]*-pod([a-f0-9_-]+)\\.slice"),                            // kubepods with slice (supports _ and -)
-        std::regex("pod([a-f0-9]{8}-[a-f0-9]{4}-[a-f0-9]{4}-[a-f0-9]{4}-[a-f0-9]{12})"), // full UUID with dashes
-        std::regex("pod([a-f0-9]{8}_[a-f0-9]{4}_[a-f0-9]{4}_[a-f0-9]{4}_[a-f0-9]{12})")  // full UUID with underscores
-    };
+    // Flush IO-specific pod metrics
+    for (const auto &[pod_name, metrics] : io_pod_metrics)
+    {
+        for (const auto &[metric_name, value] : metrics)
+        {
+            append_aggregate(aggregated_batch, "io_aggregated,pod=" + escape_tag(pod_name) + ",metric=" + metric_name,
+                             {{"value", value}}, timestamp, now_s);
+        }
+    }
 
-    for (const auto &pattern : patterns)
+    // Pods outside the top-k, summed
+    for (const auto &[prefix, metrics] : other_metrics)
     {
-        std::smatch match;
-        if (std::regex_search(cgroup_line, match, pattern) && match.size() > 1)
+        for (const auto &[metric_name, value] : metrics)
         {
-            std::string pod_uuid = match[1].str();
-            Logger::debug("Found pod with pattern, UUID: " + pod_uuid);
-            return "pod-" + pod_uuid.substr(0, 8);
+            append_aggregate(aggregated_batch, prefix + ",metric=" + metric_name, {{"value", value}}, timestamp, now_s);
         }
     }
+    append_runqueue_latency(aggregated_batch, timestamp, now_s);
+    append_silent_aggregates(aggregated_batch, folded_pods, timestamp, now_s);
+    aggregate_filter_.prune(now_s);
 
-    // Check if it's a Docker container but not in Kubernetes
-    if (cgroup_line.find("docker") != std::string::npos)
+    // Agent health, exported next to the pod aggregates
+    aggregated_batch.push_back("k8s_agent,metric=batch_size value=" + std::to_string(batch_tuner_.batch_size()));
+    if (spool_)
     {
-        Logger::debug("Found Docker container but not in Kubernetes");
-        return "docker-non-k8s";
+        aggregated_batch.push_back("k8s_agent,metric=spool_bytes value=" + std::to_string(spool_->size_bytes()));
     }
 
-    Logger::debug("No Kubernetes pod pattern found in cgroup");
-    return "unknown";
+    LOG_DEBUG("Publishing {} aggregated metrics", aggregated_batch.size());
+    sinks_.publish(std::move(aggregated_batch), true);
+
+    if (influx_.compressionLevel() > 0)
+    {
+        Logger::info("InfluxDB gzip compression ratio: " + std::to_string(influx_.compressionRatio()));
+    }
 }
 
-std::string K8sPerformanceCollector::get_container_info(__u32 pid)
+void K8sPerformanceCollector::append_runqueue_latency(std::vector<std::string> &batch, const std::string &timestamp,
+                                                      int64_t now_s)
 {
-    auto it = pid_to_container_.find(pid);
-    if (it != pid_to_container_.end())
+    if (!runqueue_reader_ || !runqueue_reader_->is_open())
     {
-        return it->second;
+        return;
     }
 
-    // Extract from cgroup (simplified)
-    return "container-" + std::to_string(pid);
+    // Containers of a pod are separate cgroups, their histograms add up
+    std::unordered_map<std::string, std::pair<PodInfoPtr, runqueue_histogram>> pods;
+    for (const auto &[cgroup_id, histogram] : runqueue_reader_->sample())
+    {
+        PodInfoPtr info = metadata_.for_cgroup(cgroup_id);
+        auto [it, inserted] = pods.try_emplace(info->pod + '/' + info->namespace_name, info, histogram);
+        if (!inserted)
+        {
+            it->second.second.merge(histogram);
+        }
+    }
+
+    for (const auto &[key, entry] : pods)
+    {
+        const auto &[info, histogram] = entry;
+        std::string series = "runqueue_latency,pod=" + escape_tag(info->pod) +
+                             ",namespace=" + escape_tag(info->namespace_name);
+        append_aggregate(batch, series,
+                         {
+                             {"p50_us", histogram.percentile_us(0.50)},
+                             {"p90_us", histogram.percentile_us(0.90)},
+                             {"p99_us", histogram.percentile_us(0.99)},
+                             {"avg_us", histogram.average_us()},
+                             {"count", static_cast<double>(histogram.count)},
+                         },
+                         timestamp, now_s, "count");
+    }
 }
 
-std::string K8sPerformanceCollector::get_namespace_info(__u32 pid)
+void K8sPerformanceCollector::append_aggregate(std::vector<std::string> &batch, const std::string &series,
+                                               const std::vector<ChangeFilter::Field> &fields,
+                                               const std::string &timestamp, int64_t now_s, const char *counter)
 {
-    auto it = pid_to_namespace_.find(pid);
-    if (it != pid_to_namespace_.end())
+    // Remembered even when suppressed, the series is still alive
+    AggregateSeries &current = current_aggregates_[series];
+    current.names.clear();
+    current.counter = counter;
+    for (const auto &field : fields)
     {
-        return it->second;
+        current.names.push_back(field.first);
     }
 
-    // Default namespace
-    return "default";
+    if (!aggregate_filter_.admit(series, fields, now_s))
+    {
+        return;
+    }
+
+    std::stringstream line;
+    line << series << " ";
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        line << (i ? "," : "") << fields[i].first << "=";
+        if (counter && std::strcmp(fields[i].first, counter) == 0)
+            line << static_cast<int64_t>(fields[i].second) << "i";
+        else
+            line << format_field(fields[i].second);
+    }
+    line << " " << timestamp;
+    batch.push_back(line.str());
 }
 
-void K8sPerformanceCollector::update_k8s_info_cache()
+void K8sPerformanceCollector::append_silent_aggregates(std::vector<std::string> &batch,
+                                                       const std::unordered_set<std::string> &folded_pods,
+                                                       const std::string &timestamp, int64_t now_s)
 {
-    // Clear old cache
-    pid_to_pod_.clear();
-    pid_to_container_.clear();
-    pid_to_namespace_.clear();
-
-    // Rebuild cache by scanning /proc
-    for (const auto &entry : std::filesystem::directory_iterator("/proc"))
+    // A pod without events in this interval would otherwise keep its last
+    // value until it expires; write a single 0 and forget the series
+    for (const auto &[series, previous] : previous_aggregates_)
     {
-        if (entry.is_directory())
+        if (current_aggregates_.count(series))
         {
-            try
-            {
-                std::string pid_str = entry.path().filename();
-                __u32 pid = std::stoi(pid_str);
+            continue;
+        }
 
-                // This will populate the cache
-                get_pod_info(pid);
-            }
-            catch (...)
-            {
-                // Skip non-numeric directory names
-            }
+        // Pods below the top-k were active, their usage went to the other series
+        size_t metric_tag = series.rfind(",metric=");
+        if (metric_tag != std::string::npos && folded_pods.count(series.substr(0, metric_tag)))
+        {
+            current_aggregates_.emplace(series, previous);
+            continue;
+        }
+
+        std::vector<ChangeFilter::Field> zeros;
+        for (const char *name : previous.names)
+        {
+            zeros.emplace_back(name, 0.0);
         }
+        aggregate_filter_.admit(series, zeros, now_s);
+
+        // Counters stay integer fields, InfluxDB refuses a change of field type
+        std::stringstream line;
+        line << series << " ";
+        for (size_t i = 0; i < zeros.size(); i++)
+        {
+            bool integer = previous.counter && std::strcmp(zeros[i].first, previous.counter) == 0;
+            line << (i ? "," : "") << zeros[i].first << (integer ? "=0i" : "=0");
+        }
+        line << " " << timestamp;
+        batch.push_back(line.str());
     }
 
-    Logger::debug("Updated K8s info cache, tracking " + std::to_string(pid_to_pod_.size()) + " pods");
+    previous_aggregates_ = std::move(current_aggregates_);
+    current_aggregates_.clear();
 }
 
-// Syscall utilities
-std::string K8sPerformanceCollector::get_syscall_name(int syscall_id)
+void K8sPerformanceCollector::append_top_k(std::vector<std::string> &batch, const SpaceSaving &tracker,
+                                           const char *dimension, const char *metric, const std::string &timestamp)
 {
-    static std::unordered_map<int, std::string> syscall_names = {
-        {0, "read"}, {1, "write"}, {2, "open"}, {3, "close"}, {4, "stat"}, {5, "fstat"}, {6, "lstat"}, {7, "poll"}, {8, "lseek"}, {9, "mmap"}, {10, "mprotect"}, {11, "munmap"}, {12, "brk"}, {13, "rt_sigaction"}, {14, "rt_sigprocmask"}, {16, "ioctl"}, {17, "pread64"}, {18, "pwrite64"}, {19, "readv"}, {20, "writev"}, {21, "access"}, {22, "pipe"}, {23, "select"}, {39, "getpid"}, {56, "clone"}, {57, "fork"}, {58, "vfork"}, {59, "execve"}, {60, "exit"}, {61, "wait4"}, {62, "kill"}, {72, "fcntl"}, {78, "getdents"}, {79, "getcwd"}, {80, "chdir"}, {82, "rename"}, {83, "mkdir"}, {84, "rmdir"}, {85, "creat"}, {86, "link"}, {87, "unlink"}, {88, "symlink"}, {89, "readlink"}, {90, "chmod"}, {92, "chown"}, {102, "getuid"}, {104, "getgid"}, {107, "geteuid"}, {108, "getegid"}, {158, "arch_prctl"}, {160, "setrlimit"}, {161, "chroot"}, {186, "gettid"}, {202, "futex"}, {218, "set_tid_address"}, {228, "clock_gettime"}, {231, "exit_group"}, {232, "epoll_wait"}, {233, "epoll_ctl"}, {234, "tgkill"}, {257, "openat"}, {262, "newfstatat"}, {263, "unlinkat"}, {264, "renameat"}, {268, "fchmodat"}, {269, "faccessat"}, {270, "pselect6"}, {288, "accept4"}, {291, "epoll_create1"}, {292, "dup3"}, {293, "pipe2"}, {302, "prlimit64"}};
+    if (tracker.total() <= 0)
+    {
+        return;
+    }
 
-    auto it = syscall_names.find(syscall_id);
-    if (it != syscall_names.end())
+    std::string prefix = std::string("topk,dimension=") + dimension + ",metric=" + metric;
+    double reported = 0;
+    size_t rank = 1;
+    for (const auto &entry : tracker.top(top_k_))
     {
-        return it->second;
+        // count overestimates by at most error
+        std::stringstream line;
+        line << prefix << ",key=" << escape_tag(entry.key);
+        line << " value=" << format_field(entry.count) << ",error=" << format_field(entry.error)
+             << ",rank=" << rank++ << "i";
+        line << " " << timestamp;
+        batch.push_back(line.str());
+        reported += entry.count;
     }
 
-    return "syscall_" + std::to_string(syscall_id);
+    // Everything else in one series, so cardinality is bounded by k. A tag
+    // instead of a key value, which a real pod or command could also have.
+    std::stringstream other;
+    other << prefix << ",other=true value=" << format_field(std::max(0.0, tracker.total() - reported)) << " "
+          << timestamp;
+    batch.push_back(other.str());
+}
+
+// Syscall utilities
+std::string K8sPerformanceCollector::get_syscall_name(int syscall_id)
+{
+    return ::get_syscall_name(syscall_id);
 }
 
 bool K8sPerformanceCollector::is_io_syscall(int syscall_id)
@@ -622,15 +1304,57 @@ bool K8sPerformanceCollector::is_io_syscall(int syscall_id)
     return io_syscalls.find(syscall_id) != io_syscalls.end();
 }
 
-bool K8sPerformanceCollector::is_important_syscall(int syscall_id)
+std::unordered_set<int> K8sPerformanceCollector::default_traced_syscalls()
 {
-    // Filter to only track important syscalls to reduce noise
-    static std::unordered_set<int> important_syscalls = {
+    // Track only important syscalls by default to reduce noise
+    return {
         0, 1, 2, 3, 4, 5, 6, 8, 9, 10, 11, 16, 17, 18, 19, 20,
         21, 39, 56, 57, 58, 59, 60, 61, 62, 72, 78, 79, 80, 82,
         83, 84, 85, 86, 87, 88, 89, 90, 92, 102, 104, 107, 108,
         158, 160, 161, 186, 202, 218, 228, 231, 232, 233, 234,
         257, 262, 263, 264, 268, 269, 270, 288, 291, 292, 293, 302};
+}
+
+bool K8sPerformanceCollector::is_traced_syscall(int syscall_id)
+{
+    return traced_syscalls_.find(syscall_id) != traced_syscalls_.end();
+}
 
-    return important_syscalls.find(syscall_id) != important_syscalls.end();
-}
\ No newline at end of file
+bool K8sPerformanceCollector::load_syscall_filter()
+{
+    int map_fd = bpf_loader_.syscall_filter_fd();
+    if (map_fd < 0)
+    {
+        Logger::error("Syscall filter map not loaded");
+        return false;
+    }
+
+    std::vector<__u64> bitmap(MAX_SYSCALL_NR / 64, 0);
+    for (int syscall_id : traced_syscalls_)
+    {
+        if (syscall_id < 0 || syscall_id >= MAX_SYSCALL_NR)
+        {
+            Logger::warn("Ignoring out of range syscall in filter: " + std::to_string(syscall_id));
+            continue;
+        }
+        bitmap[syscall_id / 64] |= 1ULL << (syscall_id % 64);
+    }
+
+    // Write every word so selections from a previous run are cleared
+    bool ok = true;
+    for (__u32 word = 0; word < bitmap.size(); word++)
+    {
+        if (bpf_map_update_elem(map_fd, &word, &bitmap[word], BPF_ANY) != 0)
+        {
+            Logger::error("Failed to update syscall filter word " + std::to_string(word));
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok)
+    {
+        Logger::info("Syscall filter loaded with " + std::to_string(traced_syscalls_.size()) + " syscalls");
+    }
+    return ok;
+}
@@ -0,0 +1,196 @@
+#include "LineBatch.hpp"
+#include <stdexcept>
+#include <charconv>
+#include <zlib.h>
+
+// gzip wrapper instead of raw zlib, as required by Content-Encoding: gzip
+static constexpr int gzip_window_bits = 15 + 16;
+
+// Compressed output is split at this size instead of growing one buffer
+static constexpr size_t max_chunk_bytes = 256 * 1024;
+
+LineBatch::LineBatch(int compression_level)
+    : compression_level_(compression_level), lines_(0), raw_bytes_(0), encoded_bytes_(0), finished_(false)
+{
+    if (compression_level_ > 9)
+        compression_level_ = 9;
+
+    if (compression_level_ > 0)
+        init_stream();
+}
+
+LineBatch::~LineBatch()
+{
+    if (stream_)
+    {
+        deflateEnd(stream_.get());
+    }
+}
+
+LineBatch::LineBatch(LineBatch &&other) noexcept
+    : compression_level_(other.compression_level_),
+      stream_(std::move(other.stream_)),
+      chunks_(std::move(other.chunks_)),
+      lines_(other.lines_),
+      raw_bytes_(other.raw_bytes_),
+      encoded_bytes_(other.encoded_bytes_),
+      finished_(other.finished_)
+{
+    other.lines_ = 0;
+    other.raw_bytes_ = 0;
+    other.encoded_bytes_ = 0;
+}
+
+LineBatch &LineBatch::operator=(LineBatch &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (stream_)
+            deflateEnd(stream_.get());
+
+        compression_level_ = other.compression_level_;
+        stream_ = std::move(other.stream_);
+        chunks_ = std::move(other.chunks_);
+        lines_ = other.lines_;
+        raw_bytes_ = other.raw_bytes_;
+        encoded_bytes_ = other.encoded_bytes_;
+        finished_ = other.finished_;
+        other.lines_ = 0;
+        other.raw_bytes_ = 0;
+        other.encoded_bytes_ = 0;
+    }
+    return *this;
+}
+
+void LineBatch::init_stream()
+{
+    stream_ = std::make_unique<z_stream_s>();
+    if (deflateInit2(stream_.get(), compression_level_, Z_DEFLATED, gzip_window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        stream_.reset();
+        throw std::runtime_error("Failed to initialize gzip deflater");
+    }
+}
+
+void LineBatch::deflate_chunk(const char *data, size_t size, int flush)
+{
+    char out[16384];
+
+    stream_->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream_->avail_in = static_cast<uInt>(size);
+
+    // Keep going until zlib has consumed the input (and, when finishing, flushed everything)
+    do
+    {
+        stream_->next_out = reinterpret_cast<Bytef *>(out);
+        stream_->avail_out = sizeof(out);
+
+        int ret = deflate(stream_.get(), flush);
+        if (ret == Z_STREAM_ERROR)
+        {
+            throw std::runtime_error("gzip deflate failed");
+        }
+
+        size_t produced = sizeof(out) - stream_->avail_out;
+        if (produced > 0)
+        {
+            if (chunks_.empty() || chunks_.back().size() + produced > max_chunk_bytes)
+            {
+                chunks_.emplace_back();
+                chunks_.back().reserve(max_chunk_bytes);
+            }
+            chunks_.back().append(out, produced);
+            encoded_bytes_ += produced;
+        }
+    } while (stream_->avail_out == 0 || stream_->avail_in > 0);
+}
+
+void LineBatch::add(std::string line)
+{
+    if (finished_)
+    {
+        throw std::logic_error("Cannot add lines to a finished batch");
+    }
+
+    size_t line_bytes = line.size() + 1;
+
+    if (stream_)
+    {
+        deflate_chunk(line.data(), line.size(), Z_NO_FLUSH);
+        deflate_chunk("\n", 1, Z_NO_FLUSH);
+    }
+    else
+    {
+        chunks_.push_back(std::move(line));
+        encoded_bytes_ += line_bytes;
+    }
+
+    lines_++;
+    raw_bytes_ += line_bytes;
+}
+
+void LineBatch::finish()
+{
+    if (finished_)
+        return;
+
+    if (stream_)
+    {
+        deflate_chunk(nullptr, 0, Z_FINISH);
+    }
+    finished_ = true;
+}
+
+void LineBatch::clear()
+{
+    chunks_.clear();
+    lines_ = 0;
+    raw_bytes_ = 0;
+    encoded_bytes_ = 0;
+    finished_ = false;
+
+    if (stream_)
+    {
+        deflateReset(stream_.get());
+    }
+    else if (compression_level_ > 0)
+    {
+        // The stream was moved away with the previous contents
+        init_stream();
+    }
+}
+
+double LineBatch::compression_ratio() const
+{
+    if (encoded_bytes_ == 0)
+        return 1.0;
+    return static_cast<double>(raw_bytes_) / encoded_bytes_;
+}
+
+std::vector<std::string> LineBatch::release_chunks()
+{
+    finish();
+    std::vector<std::string> chunks = std::move(chunks_);
+    chunks_.clear();
+    return chunks;
+}
+
+std::string escape_tag(const std::string &value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == ',' || c == ' ' || c == '=')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string format_field(double value)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
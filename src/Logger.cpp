@@ -1,15 +1,79 @@
 #include "Logger.hpp"
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+#include <ctime>
+
+#define LOGGER_QUEUE_CAPACITY 256       // records per thread, a power of two (about 20 KB)
+#define LOGGER_OVERFLOW_CAPACITY 16384  // records of every thread whose own queue is full
+#define LOGGER_DRAIN_INTERVAL_MS 5
+
+// One log call captured by a producer, formatted later by the async thread
+struct Logger::AsyncRecord
+{
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::string message;
+    std::string time_series_key;
+};
+
+// Single-producer single-consumer ring owned by one logging thread
+struct Logger::AsyncQueue
+{
+    std::vector<AsyncRecord> records = std::vector<AsyncRecord>(LOGGER_QUEUE_CAPACITY);
+    alignas(64) std::atomic<size_t> head{0}; // next record the consumer reads
+    alignas(64) std::atomic<size_t> tail{0}; // next slot the producer fills
+    std::atomic<bool> retired{false};        // owning thread has exited
+
+    bool push(AsyncRecord &&record)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == LOGGER_QUEUE_CAPACITY)
+            return false;
+        records[t & (LOGGER_QUEUE_CAPACITY - 1)] = std::move(record);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t pop_all(std::vector<AsyncRecord> &out)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        for (size_t i = h; i != t; i++)
+        {
+            out.push_back(std::move(records[i & (LOGGER_QUEUE_CAPACITY - 1)]));
+        }
+        head.store(t, std::memory_order_release);
+        return t - h;
+    }
+};
 
 // Initialize static members
 std::mutex Logger::log_mutex_;
-LogLevel Logger::current_level_ = LogLevel::INFO;
+std::atomic<LogLevel> Logger::current_level_{LogLevel::INFO};
 std::unique_ptr<std::ofstream> Logger::file_stream_ = nullptr;
 bool Logger::console_output_ = true;
 bool Logger::file_output_ = false;
 std::string Logger::log_filename_ = "";
-std::unordered_map<std::string, std::vector<std::pair<std::chrono::system_clock::time_point, std::string>>> Logger::time_series_data_;
+TimeSeriesStore Logger::time_series_data_;
+std::atomic<bool> Logger::async_enabled_{false};
+std::mutex Logger::async_mutex_;
+std::condition_variable Logger::async_cv_;
+std::vector<std::shared_ptr<Logger::AsyncQueue>> Logger::async_queues_;
+std::thread Logger::async_thread_;
+bool Logger::async_stopping_ = false;
+uint64_t Logger::async_passes_ = 0;
+int Logger::async_flush_waiters_ = 0;
+std::vector<Logger::AsyncRecord> Logger::async_overflow_;
+std::atomic<uint64_t> Logger::async_overflows_{0};
+
+// Stops the async thread at exit, declared after the members it drains
+static struct AsyncShutdown
+{
+    ~AsyncShutdown() { Logger::enableAsync(false); }
+} async_shutdown_;
 
 std::string Logger::getCurrentTimestamp()
 {
@@ -46,8 +110,31 @@ std::string Logger::levelToString(LogLevel level)
     }
 }
 
-void Logger::writeLog(LogLevel level, const std::string &message, const std::string &time_series_key)
+void Logger::writeLog(LogLevel level, std::string message, const std::string &time_series_key)
 {
+    if (BinaryLog::isOpen() && time_series_key.empty())
+    {
+        BinaryLog::writeText(static_cast<uint8_t>(level), message);
+        if (level == LogLevel::FATAL)
+            BinaryLog::flush();
+        return;
+    }
+
+    if (async_enabled_)
+    {
+        AsyncRecord record{level, std::chrono::system_clock::now(), std::move(message), time_series_key};
+        if (threadQueue().push(std::move(record)) || pushOverflow(std::move(record)))
+        {
+            if (level == LogLevel::FATAL)
+                flush();
+            return;
+        }
+
+        // Both full: write this record synchronously rather than lose it
+        async_overflows_++;
+        message = std::move(record.message);
+    }
+
     std::lock_guard<std::mutex> lock(log_mutex_);
 
     std::string timestamp = getCurrentTimestamp();
@@ -76,8 +163,198 @@ void Logger::writeLog(LogLevel level, const std::string &message, const std::str
     // Store in time series if key provided
     if (!time_series_key.empty())
     {
-        auto now = std::chrono::system_clock::now();
-        time_series_data_[time_series_key].emplace_back(now, message);
+        addTimeSeriesMessage(time_series_key, std::chrono::system_clock::now(), message);
+    }
+}
+
+Logger::AsyncQueue &Logger::threadQueue()
+{
+    // Retires the queue when its thread exits, the async thread frees it once drained
+    struct Handle
+    {
+        std::shared_ptr<AsyncQueue> queue;
+        ~Handle()
+        {
+            if (queue)
+                queue->retired = true;
+        }
+    };
+    thread_local Handle handle;
+
+    if (!handle.queue)
+    {
+        handle.queue = std::make_shared<AsyncQueue>();
+        std::lock_guard<std::mutex> lock(async_mutex_);
+        async_queues_.push_back(handle.queue);
+    }
+    return *handle.queue;
+}
+
+bool Logger::pushOverflow(AsyncRecord &&record)
+{
+    // Per-thread queues stay small since every thread that logs gets one;
+    // bursts beyond them share this queue
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    if (async_overflow_.size() >= LOGGER_OVERFLOW_CAPACITY)
+        return false;
+    async_overflow_.push_back(std::move(record));
+    return true;
+}
+
+size_t Logger::drainQueues(std::vector<AsyncRecord> &records)
+{
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    size_t count = async_overflow_.size();
+    std::move(async_overflow_.begin(), async_overflow_.end(), std::back_inserter(records));
+    async_overflow_.clear();
+    for (auto it = async_queues_.begin(); it != async_queues_.end();)
+    {
+        // Check retirement first so records pushed just before exit are not lost
+        bool retired = (*it)->retired;
+        count += (*it)->pop_all(records);
+        it = retired ? async_queues_.erase(it) : it + 1;
+    }
+    return count;
+}
+
+void Logger::writeEntries(std::vector<AsyncRecord> &records)
+{
+    // Queues are drained one after another, restore the order across threads
+    std::stable_sort(records.begin(), records.end(), [](const AsyncRecord &a, const AsyncRecord &b)
+                     { return a.time < b.time; });
+
+    // localtime_r runs at most once per second, the prefix is reused within a millisecond
+    static time_t cached_second = -1;
+    static int64_t cached_ms = -1;
+    static char second_prefix[32];
+    static char stamp[40];
+
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    bool to_file = file_output_ && file_stream_ && file_stream_->is_open();
+
+    std::string out;
+    std::string err;
+    std::string all;
+    out.reserve(records.size() * 128);
+
+    for (const auto &record : records)
+    {
+        int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count();
+        if (ms != cached_ms)
+        {
+            time_t second = static_cast<time_t>(ms / 1000);
+            if (second != cached_second)
+            {
+                struct tm tm_buf;
+                localtime_r(&second, &tm_buf);
+                strftime(second_prefix, sizeof(second_prefix), "%Y-%m-%d %H:%M:%S", &tm_buf);
+                cached_second = second;
+            }
+            snprintf(stamp, sizeof(stamp), "[%s.%03d] [", second_prefix, static_cast<int>(ms % 1000));
+            cached_ms = ms;
+        }
+
+        std::string &target = record.level >= LogLevel::ERROR ? err : out;
+        size_t start = target.size();
+        target += stamp;
+        target += levelToString(record.level);
+        target += "] ";
+        target += record.message;
+        target += '\n';
+
+        // The file keeps every level in time order
+        if (to_file)
+            all.append(target, start, std::string::npos);
+    }
+
+    // One write and one flush per batch instead of per line
+    if (console_output_)
+    {
+        if (!out.empty())
+            std::cout.write(out.data(), out.size()).flush();
+        if (!err.empty())
+            std::cerr.write(err.data(), err.size()).flush();
+    }
+
+    if (to_file)
+    {
+        file_stream_->write(all.data(), all.size());
+        file_stream_->flush();
+    }
+
+    for (auto &record : records)
+    {
+        if (!record.time_series_key.empty())
+            addTimeSeriesMessage(record.time_series_key, record.time, record.message);
+    }
+}
+
+void Logger::asyncLoop()
+{
+    std::vector<AsyncRecord> records;
+    while (true)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(async_mutex_);
+            stopping = async_stopping_;
+            async_passes_++;
+            async_cv_.notify_all();
+            if (!stopping)
+                async_cv_.wait_for(lock, std::chrono::milliseconds(LOGGER_DRAIN_INTERVAL_MS), []()
+                                   { return async_stopping_ || async_flush_waiters_ > 0; });
+        }
+
+        records.clear();
+        if (drainQueues(records) > 0)
+            writeEntries(records);
+
+        if (stopping)
+            break;
+    }
+}
+
+bool Logger::enableBinaryOutput(const std::string &filename)
+{
+    if (filename.empty())
+    {
+        BinaryLog::close();
+        return true;
+    }
+    if (!BinaryLog::open(filename))
+    {
+        writeLog(LogLevel::ERROR, "Failed to open binary log file: " + filename);
+        return false;
+    }
+    return true;
+}
+
+void Logger::enableAsync(bool enable)
+{
+    if (enable)
+    {
+        std::lock_guard<std::mutex> lock(async_mutex_);
+        if (async_thread_.joinable())
+            return;
+        async_stopping_ = false;
+        async_thread_ = std::thread(&Logger::asyncLoop);
+        async_enabled_ = true;
+        return;
+    }
+
+    if (!async_enabled_.exchange(false))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(async_mutex_);
+        async_stopping_ = true;
+    }
+    async_cv_.notify_all();
+    async_thread_.join();
+
+    if (async_overflows_ > 0)
+    {
+        writeLog(LogLevel::WARN, std::to_string(async_overflows_.exchange(0)) +
+                                     " log records were written synchronously because their queues were full");
     }
 }
 
@@ -101,7 +378,7 @@ void Logger::enableFileOutput(bool enable, const std::string &filename)
 
     if (enable && !filename.empty())
     {
-        setLogFile(filename);
+        openLogFile(filename);
     }
     else if (!enable && file_stream_)
     {
@@ -113,7 +390,11 @@ void Logger::enableFileOutput(bool enable, const std::string &filename)
 void Logger::setLogFile(const std::string &filename)
 {
     std::lock_guard<std::mutex> lock(log_mutex_);
+    openLogFile(filename);
+}
 
+void Logger::openLogFile(const std::string &filename)
+{
     if (file_stream_ && file_stream_->is_open())
     {
         file_stream_->close();
@@ -136,83 +417,93 @@ void Logger::setLogFile(const std::string &filename)
 }
 
 // Logging methods
-void Logger::trace(const std::string &message, const std::string &time_series_key)
+void Logger::trace(std::string message, const std::string &time_series_key)
 {
-    if (LogLevel::TRACE < current_level_)
+    if (!enabled(LogLevel::TRACE))
         return;
-    writeLog(LogLevel::TRACE, message, time_series_key);
+    writeLog(LogLevel::TRACE, std::move(message), time_series_key);
 }
 
-void Logger::debug(const std::string &message, const std::string &time_series_key)
+void Logger::debug(std::string message, const std::string &time_series_key)
 {
-    if (LogLevel::DEBUG < current_level_)
+    if (!enabled(LogLevel::DEBUG))
         return;
-    writeLog(LogLevel::DEBUG, message, time_series_key);
+    writeLog(LogLevel::DEBUG, std::move(message), time_series_key);
 }
 
-void Logger::info(const std::string &message, const std::string &time_series_key)
+void Logger::info(std::string message, const std::string &time_series_key)
 {
-    if (LogLevel::INFO < current_level_)
+    if (!enabled(LogLevel::INFO))
         return;
-    writeLog(LogLevel::INFO, message, time_series_key);
+    writeLog(LogLevel::INFO, std::move(message), time_series_key);
 }
 
-void Logger::warn(const std::string &message, const std::string &time_series_key)
+void Logger::warn(std::string message, const std::string &time_series_key)
 {
-    if (LogLevel::WARN < current_level_)
+    if (!enabled(LogLevel::WARN))
         return;
-    writeLog(LogLevel::WARN, message, time_series_key);
+    writeLog(LogLevel::WARN, std::move(message), time_series_key);
 }
 
-void Logger::error(const std::string &message, const std::string &time_series_key)
+void Logger::error(std::string message, const std::string &time_series_key)
 {
-    if (LogLevel::ERROR < current_level_)
+    if (!enabled(LogLevel::ERROR))
         return;
-    writeLog(LogLevel::ERROR, message, time_series_key);
+    writeLog(LogLevel::ERROR, std::move(message), time_series_key);
 }
 
-void Logger::fatal(const std::string &message, const std::string &time_series_key)
+void Logger::fatal(std::string message, const std::string &time_series_key)
 {
-    writeLog(LogLevel::FATAL, message, time_series_key);
+    writeLog(LogLevel::FATAL, std::move(message), time_series_key);
 }
 
 // Time series methods
-void Logger::addTimeSeriesData(const std::string &key, const std::string &value)
+void Logger::configureTimeSeries(size_t blocks_per_series, std::chrono::milliseconds resolution,
+                                 std::chrono::seconds retention)
 {
     std::lock_guard<std::mutex> lock(log_mutex_);
-    auto now = std::chrono::system_clock::now();
-    time_series_data_[key].emplace_back(now, value);
+    time_series_data_.configure(blocks_per_series, resolution, retention);
 }
 
-std::vector<std::pair<std::chrono::system_clock::time_point, std::string>>
-Logger::getTimeSeriesData(const std::string &key)
+void Logger::addTimeSeriesData(const std::string &key, double value)
 {
     std::lock_guard<std::mutex> lock(log_mutex_);
-    auto it = time_series_data_.find(key);
-    if (it != time_series_data_.end())
+    time_series_data_.add(key, std::chrono::system_clock::now(), value);
+}
+
+void Logger::addTimeSeriesMessage(const std::string &key, std::chrono::system_clock::time_point time,
+                                  const std::string &message)
+{
+    // Only messages that are a number can be stored
+    char *end = nullptr;
+    double value = strtod(message.c_str(), &end);
+    if (!message.empty() && *end == '\0')
     {
-        return it->second;
+        time_series_data_.add(key, time, value);
     }
-    return {};
 }
 
-void Logger::clearTimeSeriesData(const std::string &key)
+std::vector<std::pair<std::chrono::system_clock::time_point, double>>
+Logger::getTimeSeriesData(const std::string &key, std::chrono::system_clock::time_point from,
+                          std::chrono::system_clock::time_point to)
 {
     std::lock_guard<std::mutex> lock(log_mutex_);
-    if (key.empty())
-    {
-        time_series_data_.clear();
-    }
-    else
-    {
-        time_series_data_.erase(key);
-    }
+    std::vector<std::pair<std::chrono::system_clock::time_point, double>> points;
+    time_series_data_.query(key, from, to, [&points](std::chrono::system_clock::time_point time, double value)
+                            { points.emplace_back(time, value); });
+    return points;
 }
 
-void Logger::exportTimeSeriesToCSV(const std::string &filename, const std::string &key)
+void Logger::clearTimeSeriesData(const std::string &key)
 {
     std::lock_guard<std::mutex> lock(log_mutex_);
+    time_series_data_.clear(key);
+}
 
+void Logger::exportTimeSeriesToCSV(const std::string &filename, const std::string &key,
+                                   std::chrono::system_clock::time_point from,
+                                   std::chrono::system_clock::time_point to)
+{
     std::ofstream csv_file(filename);
     if (!csv_file.is_open())
     {
@@ -222,31 +513,19 @@ void Logger::exportTimeSeriesToCSV(const std::string &filename, const std::strin
 
     csv_file << "timestamp,key,value\n";
 
-    if (key.empty())
     {
-        // Export all time series data
-        for (const auto &[series_key, data_points] : time_series_data_)
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        std::vector<std::string> keys = key.empty() ? time_series_data_.keys() : std::vector<std::string>{key};
+        for (const auto &series_key : keys)
         {
-            for (const auto &[timestamp, value] : data_points)
-            {
-                auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-                csv_file << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S") << ","
-                         << series_key << "," << value << "\n";
-            }
-        }
-    }
-    else
-    {
-        // Export specific time series
-        auto it = time_series_data_.find(key);
-        if (it != time_series_data_.end())
-        {
-            for (const auto &[timestamp, value] : it->second)
-            {
-                auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-                csv_file << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S") << ","
-                         << key << "," << value << "\n";
-            }
+            // Points are decoded block by block straight into the file
+            time_series_data_.query(series_key, from, to, [&](std::chrono::system_clock::time_point time, double value)
+                                    {
+                auto time_t = std::chrono::system_clock::to_time_t(time);
+                struct tm tm_buf;
+                localtime_r(&time_t, &tm_buf);
+                csv_file << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S") << ","
+                         << series_key << "," << value << "\n"; });
         }
     }
 
@@ -257,6 +536,20 @@ void Logger::exportTimeSeriesToCSV(const std::string &filename, const std::strin
 // Utility methods
 void Logger::flush()
 {
+    BinaryLog::flush();
+
+    if (async_enabled_)
+    {
+        // Two passes guarantee one drain started after the caller's last record
+        std::unique_lock<std::mutex> lock(async_mutex_);
+        uint64_t target = async_passes_ + 2;
+        async_flush_waiters_++;
+        async_cv_.notify_all();
+        async_cv_.wait(lock, [target]()
+                       { return async_passes_ >= target || async_stopping_; });
+        async_flush_waiters_--;
+    }
+
     std::lock_guard<std::mutex> lock(log_mutex_);
     if (file_stream_ && file_stream_->is_open())
     {
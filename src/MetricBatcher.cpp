@@ -0,0 +1,129 @@
+#include "MetricBatcher.hpp"
+#include "Logger.hpp"
+
+MetricBatcher::MetricBatcher(MetricFanout &sinks, bool aggregated, size_t max_lines, size_t max_bytes,
+                             std::chrono::milliseconds max_delay)
+    : sinks_(sinks), aggregated_(aggregated), max_lines_(max_lines > 0 ? max_lines : 1),
+      max_bytes_(max_bytes), max_delay_(max_delay), pending_bytes_(0), running_(false),
+      size_flushes_(0), time_flushes_(0), lines_(0)
+{
+    pending_.reserve(max_lines_);
+}
+
+MetricBatcher::~MetricBatcher()
+{
+    stop();
+}
+
+bool MetricBatcher::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+        return true;
+
+    running_ = true;
+    worker_ = std::thread(&MetricBatcher::worker_loop, this);
+    return true;
+}
+
+void MetricBatcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+    flush();
+}
+
+std::vector<std::string> MetricBatcher::take()
+{
+    std::vector<std::string> batch;
+    batch.swap(pending_);
+    pending_.reserve(max_lines_);
+    pending_bytes_ = 0;
+    return batch;
+}
+
+void MetricBatcher::add(std::string line)
+{
+    std::vector<std::string> full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty())
+        {
+            first_line_time_ = std::chrono::steady_clock::now();
+            cv_.notify_all(); // the flush thread starts timing this batch
+        }
+        pending_bytes_ += line.size() + 1;
+        pending_.push_back(std::move(line));
+        lines_++;
+
+        if (pending_.size() >= max_lines_ || (max_bytes_ > 0 && pending_bytes_ >= max_bytes_))
+        {
+            full = take();
+            size_flushes_++;
+        }
+    }
+
+    // Publishing only queues the batch on the sinks, outside the lock anyway
+    if (!full.empty())
+        sinks_.publish(std::move(full), aggregated_);
+}
+
+void MetricBatcher::add(std::vector<std::string> lines)
+{
+    for (auto &line : lines)
+    {
+        add(std::move(line));
+    }
+}
+
+void MetricBatcher::flush()
+{
+    std::vector<std::string> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch = take();
+    }
+    if (!batch.empty())
+        sinks_.publish(std::move(batch), aggregated_);
+}
+
+void MetricBatcher::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_)
+    {
+        if (pending_.empty())
+        {
+            cv_.wait(lock, [this]()
+                     { return !running_ || !pending_.empty(); });
+            continue;
+        }
+
+        // Sleep until the oldest pending line has waited max_delay
+        auto deadline = first_line_time_ + max_delay_;
+        if (std::chrono::steady_clock::now() < deadline)
+        {
+            cv_.wait_until(lock, deadline);
+            continue;
+        }
+
+        std::vector<std::string> batch = take();
+        time_flushes_++;
+        lock.unlock();
+        sinks_.publish(std::move(batch), aggregated_);
+        lock.lock();
+    }
+}
+
+void MetricBatcher::report(const std::string &name) const
+{
+    Logger::info(name + ": " + std::to_string(lines_) + " lines batched, " + std::to_string(size_flushes_) +
+                 " full batches, " + std::to_string(time_flushes_) + " on the time limit");
+}
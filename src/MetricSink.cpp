@@ -0,0 +1,215 @@
+#include "MetricSink.hpp"
+#include "InfluxSink.hpp"
+#include "FileSink.hpp"
+#include "PrometheusSink.hpp"
+#include "Logger.hpp"
+#include <sstream>
+#include <cstdlib>
+
+MetricSink::MetricSink(const std::string &name, bool wants_events, size_t max_queued)
+    : name_(name), wants_events_(wants_events), max_queued_(max_queued > 0 ? max_queued : 1),
+      running_(false), busy_(false), delivered_(0), failed_(0), dropped_(0), diverted_(0)
+{
+}
+
+MetricSink::~MetricSink()
+{
+    // Derived sinks have already stopped the worker, this only catches misuse
+    MetricSink::stop();
+}
+
+bool MetricSink::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+        return true;
+
+    running_ = true;
+    worker_ = std::thread(&MetricSink::worker_loop, this);
+    return true;
+}
+
+void MetricSink::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+}
+
+void MetricSink::submit(const MetricBatchPtr &batch)
+{
+    MetricBatchPtr overflow;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= max_queued_)
+        {
+            overflow = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        queue_.push_back(batch);
+    }
+    cv_.notify_all();
+
+    // Outside the lock, diverting may write to disk
+    if (overflow)
+    {
+        if (divert(overflow))
+        {
+            diverted_++;
+        }
+        else if (dropped_++ % 100 == 0)
+        {
+            Logger::warn("Sink " + name_ + " is falling behind, dropping its oldest batches");
+        }
+    }
+}
+
+void MetricSink::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]()
+             { return (queue_.empty() && !busy_) || !worker_.joinable(); });
+}
+
+void MetricSink::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cv_.wait(lock, [this]()
+                 { return !running_ || !queue_.empty(); });
+
+        // Keep delivering until the queue is drained, even when stopping
+        if (queue_.empty())
+            break;
+
+        MetricBatchPtr batch = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        bool ok = false;
+        try
+        {
+            ok = deliver(batch);
+        }
+        catch (const std::exception &e)
+        {
+            Logger::error("Sink " + name_ + " failed: " + e.what());
+        }
+        if (ok)
+            delivered_++;
+        else
+            failed_++;
+
+        lock.lock();
+        busy_ = false;
+        cv_.notify_all();
+    }
+}
+
+bool MetricFanout::start()
+{
+    bool ok = true;
+    for (auto &sink : sinks_)
+    {
+        if (!sink->start())
+        {
+            Logger::error("Failed to start sink " + sink->name());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void MetricFanout::stop()
+{
+    for (auto &sink : sinks_)
+    {
+        sink->stop();
+    }
+}
+
+void MetricFanout::flush()
+{
+    for (auto &sink : sinks_)
+    {
+        sink->flush();
+    }
+}
+
+void MetricFanout::publish(std::vector<std::string> lines, bool aggregated)
+{
+    if (lines.empty())
+        return;
+
+    auto batch = std::make_shared<MetricBatch>();
+    batch->lines = std::move(lines);
+    batch->aggregated = aggregated;
+
+    MetricBatchPtr shared = std::move(batch);
+    for (auto &sink : sinks_)
+    {
+        if (aggregated || sink->wants_events())
+            sink->submit(shared);
+    }
+}
+
+void MetricFanout::report() const
+{
+    for (const auto &sink : sinks_)
+    {
+        Logger::info("Sink " + sink->name() + ": " + std::to_string(sink->delivered()) + " batches delivered, " +
+                     std::to_string(sink->failed()) + " failed, " + std::to_string(sink->diverted()) + " diverted, " +
+                     std::to_string(sink->dropped()) + " dropped");
+    }
+}
+
+bool add_sinks_from_spec(MetricFanout &fanout, const std::string &spec, InfluxClient &influx, bool prometheus_gzip)
+{
+    std::stringstream list(spec);
+    std::string item;
+    bool ok = true;
+
+    while (std::getline(list, item, ','))
+    {
+        if (item.empty())
+            continue;
+
+        if (item == "influx")
+        {
+            fanout.add(std::make_unique<InfluxSink>(influx));
+        }
+        else if (item == "stdout")
+        {
+            fanout.add(std::make_unique<FileSink>("-"));
+        }
+        else if (item.rfind("file:", 0) == 0)
+        {
+            fanout.add(std::make_unique<FileSink>(item.substr(5)));
+        }
+        else if (item == "prometheus" || item.rfind("prometheus:", 0) == 0)
+        {
+            int port = item.size() > 11 ? atoi(item.c_str() + 11) : 9400;
+            if (port <= 0)
+            {
+                Logger::error("Invalid Prometheus sink port: " + item);
+                ok = false;
+                continue;
+            }
+            fanout.add(std::make_unique<PrometheusSink>(port, prometheus_gzip));
+        }
+        else
+        {
+            Logger::error("Unknown metric sink: " + item);
+            ok = false;
+        }
+    }
+    return ok;
+}
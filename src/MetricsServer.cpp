@@ -0,0 +1,233 @@
+#include "MetricsServer.hpp"
+#include "Logger.hpp"
+#include <cstring>
+#include <strings.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <zlib.h>
+
+// Requests larger than this are not scrapes and are dropped
+static const size_t max_request_bytes = 8192;
+
+static std::string gzip_encode(const std::string &text)
+{
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return "";
+
+    std::string out;
+    out.resize(deflateBound(&stream, text.size()));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+    stream.avail_in = static_cast<uInt>(text.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    int ret = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END ? out : "";
+}
+
+static bool send_all(int fd, struct iovec *iov, int count)
+{
+    while (count > 0)
+    {
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        size_t left = static_cast<size_t>(sent);
+        while (count > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+MetricsServer::MetricsServer(int port, bool gzip)
+    : port_(port), gzip_(gzip), listen_fd_(-1), wake_fd_(-1), running_(false),
+      snapshot_(std::make_shared<const Snapshot>()), scrapes_(0)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start()
+{
+    if (running_)
+        return true;
+
+    listen_fd_ = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+    {
+        Logger::error("Failed to create metrics socket: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    int on = 1;
+    int off = 0;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(listen_fd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    struct sockaddr_in6 addr = {};
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(static_cast<uint16_t>(port_));
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd_, 16) < 0)
+    {
+        Logger::error("Failed to listen on metrics port " + std::to_string(port_) + ": " + strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    running_ = true;
+    serve_thread_ = std::thread(&MetricsServer::serve_loop, this);
+
+    Logger::info("Serving Prometheus metrics on port " + std::to_string(port_));
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if (!running_)
+        return;
+
+    running_ = false;
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0)
+    {
+        LOG_DEBUG("Failed to wake metrics server: {}", strerror(errno));
+    }
+    if (serve_thread_.joinable())
+    {
+        serve_thread_.join();
+    }
+
+    close(listen_fd_);
+    close(wake_fd_);
+    listen_fd_ = -1;
+    wake_fd_ = -1;
+}
+
+void MetricsServer::publish(std::string text)
+{
+    auto snapshot = std::make_shared<Snapshot>();
+    if (gzip_)
+        snapshot->gzip = gzip_encode(text);
+    snapshot->text = std::move(text);
+    snapshot_.store(std::move(snapshot));
+}
+
+void MetricsServer::serve_loop()
+{
+    struct pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+
+    while (running_)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            Logger::error("Metrics server poll failed: " + std::string(strerror(errno)));
+            break;
+        }
+
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        // Scrapes are cheap, a slow client only gets a short timeout
+        struct timeval timeout = {2, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        handle_connection(fd);
+        close(fd);
+    }
+}
+
+void MetricsServer::handle_connection(int fd)
+{
+    char request[max_request_bytes + 1];
+    size_t length = 0;
+
+    while (length < max_request_bytes)
+    {
+        ssize_t n = recv(fd, request + length, max_request_bytes - length, 0);
+        if (n <= 0)
+            return;
+        length += static_cast<size_t>(n);
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n"))
+            break;
+    }
+    request[length] = '\0';
+
+    bool head = strncmp(request, "HEAD ", 5) == 0;
+    bool get = strncmp(request, "GET ", 4) == 0;
+    const char *path = request + (head ? 5 : 4);
+    bool metrics_path = strncmp(path, "/metrics ", 9) == 0 || strncmp(path, "/ ", 2) == 0;
+
+    if (!(get || head) || !metrics_path)
+    {
+        static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        struct iovec iov = {const_cast<char *>(not_found), sizeof(not_found) - 1};
+        send_all(fd, &iov, 1);
+        return;
+    }
+
+    // Keep the snapshot alive while sending, a publish may replace it meanwhile
+    std::shared_ptr<const Snapshot> snapshot = snapshot_.load();
+
+    bool gzip = false;
+    for (const char *line = strstr(request, "\r\n"); line && !gzip; line = strstr(line + 2, "\r\n"))
+    {
+        if (strncasecmp(line + 2, "Accept-Encoding:", 16) == 0)
+        {
+            const char *end = strstr(line + 2, "\r\n");
+            std::string value(line + 18, end ? end : line + strlen(line));
+            gzip = value.find("gzip") != std::string::npos && !snapshot->gzip.empty();
+        }
+    }
+
+    const std::string &body = gzip ? snapshot->gzip : snapshot->text;
+    std::string header = "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                         "Content-Length: " +
+                         std::to_string(body.size()) + "\r\n" +
+                         (gzip ? "Content-Encoding: gzip\r\n" : "") +
+                         "Connection: close\r\n\r\n";
+
+    struct iovec iov[2] = {{header.data(), header.size()},
+                           {const_cast<char *>(body.data()), head ? 0 : body.size()}};
+    if (send_all(fd, iov, 2))
+        scrapes_++;
+}
@@ -0,0 +1,172 @@
+#include "PodMetadataCache.hpp"
+#include "Logger.hpp"
+#include <fstream>
+#include <filesystem>
+#include <regex>
+#include <mutex>
+#include <vector>
+#include <sys/stat.h>
+
+PodMetadataCache::PodMetadataCache(const std::string &proc_root, const std::string &cgroup_root)
+    : proc_root_(proc_root), cgroup_root_(cgroup_root),
+      unknown_(std::make_shared<PodInfo>(PodInfo{"unknown", "unknown", "default"})),
+      generation_(0)
+{
+}
+
+std::string PodMetadataCache::pod_from_cgroup(const std::string &cgroup_path)
+{
+    // Multiple patterns to match different Kubernetes cgroup formats
+    static const std::vector<std::regex> patterns = {
+        std::regex("pod([a-f0-9_-]+)\\.slice"),                                          // systemd with slices (supports _ and -)
+        std::regex("pod([a-f0-9_-]+)/"),                                                 // cgroupfs format (supports _ and -)
+        std::regex("kubepods[^/]*/pod([a-f0-9_-]+)"),                                    // kubepods prefix (supports _ and -)
+        std::regex("kubepods[^/]*-pod([a-f0-9_-]+)\\.slice"),                            // kubepods with slice (supports _ and -)
+        std::regex("pod([a-f0-9]{8}-[a-f0-9]{4}-[a-f0-9]{4}-[a-f0-9]{4}-[a-f0-9]{12})"), // full UUID with dashes
+        std::regex("pod([a-f0-9]{8}_[a-f0-9]{4}_[a-f0-9]{4}_[a-f0-9]{4}_[a-f0-9]{12})")  // full UUID with underscores
+    };
+
+    for (const auto &pattern : patterns)
+    {
+        std::smatch match;
+        if (std::regex_search(cgroup_path, match, pattern) && match.size() > 1)
+        {
+            std::string pod_uuid = match[1].str();
+            LOG_DEBUG("Found pod with pattern, UUID: {}", pod_uuid);
+            return "pod-" + pod_uuid.substr(0, 8);
+        }
+    }
+
+    // Check if it's a Docker container but not in Kubernetes
+    if (cgroup_path.find("docker") != std::string::npos)
+    {
+        LOG_DEBUG("Found Docker container but not in Kubernetes");
+        return "docker-non-k8s";
+    }
+
+    return "unknown";
+}
+
+std::string PodMetadataCache::container_from_cgroup(const std::string &cgroup_path)
+{
+    // Runtimes name the leaf after the 64 hex digit container id, e.g. cri-containerd-<id>.scope
+    static const std::regex pattern("([a-f0-9]{64})");
+    std::smatch match;
+    if (std::regex_search(cgroup_path, match, pattern))
+    {
+        return "container-" + match[1].str().substr(0, 12);
+    }
+    return "";
+}
+
+PodInfoPtr PodMetadataCache::read_pid(uint32_t pid) const
+{
+    std::ifstream file(proc_root_ + "/" + std::to_string(pid) + "/cgroup");
+    if (!file.is_open())
+    {
+        LOG_DEBUG("Cgroup file does not exist for PID: {}", pid);
+        return nullptr;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // Check for Kubernetes patterns
+        if (line.find("kubepods") == std::string::npos &&
+            line.find("docker") == std::string::npos &&
+            line.find("containerd") == std::string::npos)
+            continue;
+
+        std::string pod = pod_from_cgroup(line);
+        if (pod == "unknown")
+            continue;
+
+        std::string container = container_from_cgroup(line);
+        if (container.empty())
+            container = "container-" + std::to_string(pid);
+        return std::make_shared<PodInfo>(PodInfo{pod, container, "default"});
+    }
+
+    LOG_DEBUG("No container patterns found in cgroup for PID: {}", pid);
+    return unknown_;
+}
+
+PodInfoPtr PodMetadataCache::for_pid(uint32_t pid)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = by_pid_.find(pid);
+        if (it != by_pid_.end())
+            return it->second;
+    }
+
+    // Processes that already exited are not cached, their pid may come back
+    PodInfoPtr info = read_pid(pid);
+    if (!info)
+        return unknown_;
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    by_pid_.emplace(pid, info);
+    return info;
+}
+
+PodInfoPtr PodMetadataCache::for_cgroup(uint64_t cgroup_id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = by_cgroup_.find(cgroup_id);
+    return it != by_cgroup_.end() ? it->second : unknown_;
+}
+
+void PodMetadataCache::refresh()
+{
+    // cgroup v2: the id of a cgroup is the inode number of its directory
+    std::unordered_map<uint64_t, PodInfoPtr> cgroups;
+    std::error_code ec;
+    for (const auto &top : std::filesystem::directory_iterator(cgroup_root_, ec))
+    {
+        if (!top.is_directory(ec) || top.path().filename().string().find("kubepods") == std::string::npos)
+            continue;
+
+        // Pods and containers may vanish while we walk, so skip errors
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto it = std::filesystem::recursive_directory_iterator(top.path(), options, ec);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (ec)
+                break;
+            if (!it->is_directory(ec))
+                continue;
+
+            std::string path = it->path().string();
+            std::string pod = pod_from_cgroup(path + "/");
+            if (pod == "unknown")
+                continue;
+
+            // The pod's own cgroup has no container
+            std::string container = container_from_cgroup(path);
+            struct stat st;
+            if (::stat(path.c_str(), &st) == 0)
+            {
+                cgroups[st.st_ino] = std::make_shared<PodInfo>(PodInfo{pod, container.empty() ? "unknown" : container, "default"});
+            }
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    by_pid_.clear();
+    by_cgroup_.swap(cgroups);
+    generation_++;
+    LOG_DEBUG("Metadata cache refreshed, tracking {} pod cgroups", by_cgroup_.size());
+}
+
+size_t PodMetadataCache::pid_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return by_pid_.size();
+}
+
+size_t PodMetadataCache::cgroup_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return by_cgroup_.size();
+}
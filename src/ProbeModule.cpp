@@ -0,0 +1,42 @@
+#include "ProbeModule.hpp"
+#include "K8sCollectorModule.hpp"
+#include "SyscallFrequencyModule.hpp"
+#include "Logger.hpp"
+#include <sstream>
+
+bool make_probe_modules(const std::string &spec, std::vector<std::unique_ptr<ProbeModule>> &modules)
+{
+    std::stringstream list(spec);
+    std::string item;
+    bool ok = true;
+    unsigned k8s_probes = 0;
+    bool syscall_frequency = false;
+
+    while (std::getline(list, item, ','))
+    {
+        if (item.empty())
+            continue;
+
+        if (item == "cpu")
+            k8s_probes |= BPF_PROBE_CPU;
+        else if (item == "memory")
+            k8s_probes |= BPF_PROBE_MEMORY;
+        else if (item == "syscall_latency")
+            k8s_probes |= BPF_PROBE_SYSCALL_LATENCY;
+        else if (item == "runqueue_latency")
+            k8s_probes |= BPF_PROBE_RUNQUEUE_LATENCY;
+        else if (item == "syscall_frequency")
+            syscall_frequency = true;
+        else
+        {
+            Logger::error("Unknown probe module: " + item);
+            ok = false;
+        }
+    }
+
+    if (k8s_probes)
+        modules.push_back(std::make_unique<K8sCollectorModule>(k8s_probes));
+    if (syscall_frequency)
+        modules.push_back(std::make_unique<SyscallFrequencyModule>());
+    return ok;
+}
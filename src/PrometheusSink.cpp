@@ -0,0 +1,180 @@
+#include "PrometheusSink.hpp"
+#include <map>
+#include <cstdlib>
+
+PrometheusSink::PrometheusSink(int port, bool gzip, std::chrono::seconds series_ttl)
+    : MetricSink("prometheus:" + std::to_string(port), false, 4), server_(port, gzip), series_ttl_(series_ttl)
+{
+}
+
+PrometheusSink::~PrometheusSink()
+{
+    stop();
+}
+
+bool PrometheusSink::start()
+{
+    return server_.start() && MetricSink::start();
+}
+
+void PrometheusSink::stop()
+{
+    MetricSink::stop();
+    server_.stop();
+}
+
+bool PrometheusSink::deliver(const MetricBatchPtr &batch)
+{
+    // Batches come from several publishers at their own intervals, none of
+    // them replaces the others' series
+    auto now = std::chrono::steady_clock::now();
+    merge(families_, batch->lines, now);
+
+    for (auto family = families_.begin(); family != families_.end();)
+    {
+        std::erase_if(family->second, [&](const auto &item)
+                      { return now - item.second.updated > series_ttl_; });
+        family = family->second.empty() ? families_.erase(family) : std::next(family);
+    }
+
+    server_.publish(render(families_));
+    return true;
+}
+
+// Prometheus names allow [a-zA-Z0-9_:], anything else becomes '_'
+static std::string sanitize_name(const std::string &name)
+{
+    std::string result = name;
+    for (char &c : result)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != ':')
+            c = '_';
+    }
+    return result;
+}
+
+static std::string escape_label_value(const std::string &value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+            result += '\\';
+        if (c == '\n')
+        {
+            result += "\\n";
+            continue;
+        }
+        result += c;
+    }
+    return result;
+}
+
+// Split at unescaped separators outside double quotes
+static std::vector<std::string> split_line_protocol(const std::string &text, char separator)
+{
+    std::vector<std::string> parts;
+    std::string current;
+    bool quoted = false;
+
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (c == '\\' && i + 1 < text.size())
+        {
+            current += text[++i];
+            continue;
+        }
+        if (c == '"')
+            quoted = !quoted;
+        if (c == separator && !quoted)
+        {
+            parts.push_back(std::move(current));
+            current.clear();
+            continue;
+        }
+        current += c;
+    }
+    parts.push_back(std::move(current));
+    return parts;
+}
+
+void PrometheusSink::merge(Families &families, const std::vector<std::string> &lines,
+                           std::chrono::steady_clock::time_point now)
+{
+    // Samples of one family have to be contiguous, so group by name first.
+    // A batch can hold several samples of a series, the last one wins.
+
+    for (const auto &line : lines)
+    {
+        std::vector<std::string> sections = split_line_protocol(line, ' ');
+        if (sections.size() < 2)
+            continue;
+
+        std::vector<std::string> series = split_line_protocol(sections[0], ',');
+        std::string metric_tag;
+        std::string labels;
+        for (size_t i = 1; i < series.size(); i++)
+        {
+            size_t eq = series[i].find('=');
+            if (eq == std::string::npos)
+                continue;
+            std::string key = series[i].substr(0, eq);
+            std::string value = series[i].substr(eq + 1);
+            if (key == "metric")
+            {
+                metric_tag = value;
+                continue;
+            }
+            labels += (labels.empty() ? "" : ",") + sanitize_name(key) + "=\"" + escape_label_value(value) + "\"";
+        }
+
+        for (const auto &field : split_line_protocol(sections[1], ','))
+        {
+            size_t eq = field.find('=');
+            if (eq == std::string::npos)
+                continue;
+            std::string key = field.substr(0, eq);
+            std::string value = field.substr(eq + 1);
+            if (!value.empty() && (value.back() == 'i' || value.back() == 'u'))
+                value.pop_back();
+
+            // Strings and booleans have no Prometheus representation
+            char *end = nullptr;
+            strtod(value.c_str(), &end);
+            if (value.empty() || *end != '\0')
+                continue;
+
+            // Other fields of a metric= line keep the metric in their name
+            std::string suffix = metric_tag.empty() ? key : key == "value" ? metric_tag : metric_tag + "_" + key;
+            std::string name = sanitize_name(series[0] + "_" + suffix);
+            std::string sample = name;
+            if (!labels.empty())
+                sample += "{" + labels + "}";
+            families[name][sample] = {value, now};
+        }
+    }
+}
+
+std::string PrometheusSink::render(const Families &families)
+{
+    std::string text;
+    for (const auto &[name, samples] : families)
+    {
+        text += "# TYPE " + name + " gauge\n";
+        for (const auto &[sample, entry] : samples)
+        {
+            text += sample + " " + entry.value;
+            text += '\n';
+        }
+    }
+    return text;
+}
+
+std::string PrometheusSink::render(const std::vector<std::string> &lines)
+{
+    Families families;
+    merge(families, lines, std::chrono::steady_clock::now());
+    return render(families);
+}
@@ -4,7 +4,7 @@
 #include <unistd.h>
 
 RingBufReaderDataT::RingBufReaderDataT(const std::string &pinned_path)
-    : map_path(pinned_path), map_fd(-1), rb(nullptr), running(false)
+    : map_path(pinned_path), map_fd(-1), rb(nullptr), running(false), drain_interval_ms(100)
 {
 }
 
@@ -23,6 +23,25 @@ bool RingBufReaderDataT::open()
         return false;
     }
 
+    return open_ring_buffer();
+}
+
+bool RingBufReaderDataT::open(int fd)
+{
+    // Duplicate so close() never invalidates the owner's fd
+    map_fd = dup(fd);
+    if (map_fd < 0)
+    {
+        Logger::error("Invalid ring buffer map fd");
+        return false;
+    }
+
+    map_path = "fd:" + std::to_string(fd);
+    return open_ring_buffer();
+}
+
+bool RingBufReaderDataT::open_ring_buffer()
+{
     rb = ring_buffer__new(map_fd, handle_ringbuf_event, this, nullptr);
     if (!rb)
     {
@@ -62,6 +81,7 @@ int RingBufReaderDataT::handle_ringbuf_event(void *ctx, void *data, size_t size)
     }
 
     data_t *event_data = static_cast<data_t *>(data);
+    reader->stats.events++;
 
     if (reader->user_callback)
     {
@@ -106,11 +126,13 @@ void RingBufReaderDataT::stop_reading()
 
 void RingBufReaderDataT::read_loop()
 {
-    const int timeout_ms = 100;
+    const auto report_interval = std::chrono::seconds(60);
+    auto last_report = std::chrono::steady_clock::now();
+    uint64_t start_switches = RingBufStats::thread_context_switches();
 
     while (running)
     {
-        int err = ring_buffer__poll(rb, timeout_ms);
+        int err = ring_buffer__poll(rb, drain_interval_ms);
 
         if (err < 0)
         {
@@ -120,7 +142,25 @@ void RingBufReaderDataT::read_loop()
                 break;
             }
         }
+        else if (err > 0)
+        {
+            stats.wakeups++;
+        }
+        else if (ring_buffer__consume(rb) > 0)
+        {
+            // No wakeup within the interval, drained records below the watermark
+            stats.timer_drains++;
+        }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= report_interval)
+        {
+            stats.context_switches = RingBufStats::thread_context_switches() - start_switches;
+            stats.report(map_path);
+            last_report = now;
+        }
     }
+
+    // RUSAGE_THREAD only sees this thread, sample here for the final report
+    stats.context_switches = RingBufStats::thread_context_switches() - start_switches;
 }
\ No newline at end of file
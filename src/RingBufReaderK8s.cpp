@@ -13,7 +13,8 @@ RingBufReaderK8s::RingBufReaderK8s(const std::string &cpu_pinned_path,
       memory_map_fd(-1),
       syscall_latency_map_fd(-1),
       rb(nullptr),
-      running(false)
+      running(false),
+      drain_interval_ms(100)
 {
 }
 
@@ -33,31 +34,57 @@ bool RingBufReaderK8s::open()
         return false;
     }
 
-    rb = ring_buffer__new(cpu_map_fd, handle_cpu_event, this, nullptr);
-    if (!rb)
-    {
-        Logger::error("Failed to create ring buffer");
-        ::close(cpu_map_fd);
-        cpu_map_fd = -1;
-        return false;
-    }
-
-    int err = 0;
-
     memory_map_fd = bpf_obj_get(memory_map_path.c_str());
     syscall_latency_map_fd = bpf_obj_get(syscall_latency_map_path.c_str());
 
-    
-    err = ring_buffer__add(rb, memory_map_fd, handle_memory_event, NULL);
-    if (err) {
-        Logger::error("Failed to add memory_map_fd");
+    return open_ring_buffers();
+}
+
+bool RingBufReaderK8s::open(int cpu_fd, int memory_fd, int syscall_latency_fd)
+{
+    // Duplicate so close() never invalidates the owner's fds; probes not loaded pass -1
+    cpu_map_fd = cpu_fd >= 0 ? dup(cpu_fd) : -1;
+    memory_map_fd = memory_fd >= 0 ? dup(memory_fd) : -1;
+    syscall_latency_map_fd = syscall_latency_fd >= 0 ? dup(syscall_latency_fd) : -1;
+    if (cpu_map_fd < 0 && memory_map_fd < 0 && syscall_latency_map_fd < 0)
+    {
+        Logger::error("No valid ring buffer map fd");
         return false;
     }
 
-    err = ring_buffer__add(rb, syscall_latency_map_fd, handle_syscall_latency_event, NULL);
-    if (err) {
-        Logger::error("Failed to add syscall_latency_map_fd");
-        return false;
+    return open_ring_buffers();
+}
+
+bool RingBufReaderK8s::open_ring_buffers()
+{
+    const struct
+    {
+        int fd;
+        ring_buffer_sample_fn handler;
+        const char *name;
+    } rings[] = {
+        {cpu_map_fd, handle_cpu_event, "CPU"},
+        {memory_map_fd, handle_memory_event, "memory"},
+        {syscall_latency_map_fd, handle_syscall_latency_event, "syscall latency"},
+    };
+
+    for (const auto &ring : rings)
+    {
+        if (ring.fd < 0)
+            continue;
+
+        // Every handler gets the reader as context
+        int err = 0;
+        if (!rb)
+            rb = ring_buffer__new(ring.fd, ring.handler, this, nullptr);
+        else
+            err = ring_buffer__add(rb, ring.fd, ring.handler, this);
+        if (!rb || err)
+        {
+            Logger::error(std::string("Failed to add the ") + ring.name + " ring buffer");
+            close();
+            return false;
+        }
     }
 
     Logger::info("Ring buffers opened successfully");
@@ -100,6 +127,7 @@ int RingBufReaderK8s::handle_cpu_event(void *ctx, void *data, size_t size)
     }
 
     cpu_event *event_data = static_cast<cpu_event *>(data);
+    reader->stats.events++;
 
     if (reader->cpu_callback)
     {
@@ -121,6 +149,7 @@ int RingBufReaderK8s::handle_memory_event(void *ctx, void *data, size_t size)
     }
 
     memory_event *event_data = static_cast<memory_event *>(data);
+    reader->stats.events++;
 
     if (reader->memory_callback)
     {
@@ -142,6 +171,7 @@ int RingBufReaderK8s::handle_syscall_latency_event(void *ctx, void *data, size_t
     }
 
     syscall_latency_event *event_data = static_cast<syscall_latency_event *>(data);
+    reader->stats.events++;
 
     if (reader->syscall_latency_callback)
     {
@@ -175,6 +205,33 @@ void RingBufReaderK8s::start_reading(CpuEventCallback cpu_cb,
     Logger::info("Ring buffer reader started");
 }
 
+void RingBufReaderK8s::set_callbacks(CpuEventCallback cpu_cb,
+                                     MemoryEventCallback memory_cb,
+                                     SyscallLatencyCallback syscall_latency_cb)
+{
+    cpu_callback = cpu_cb;
+    memory_callback = memory_cb;
+    syscall_latency_callback = syscall_latency_cb;
+}
+
+int RingBufReaderK8s::epoll_fd() const
+{
+    return rb ? ring_buffer__epoll_fd(rb) : -1;
+}
+
+void RingBufReaderK8s::consume()
+{
+    if (!rb)
+        return;
+
+    if (ring_buffer__consume(rb) > 0)
+        stats.wakeups++;
+    if (tick_callback)
+    {
+        tick_callback();
+    }
+}
+
 void RingBufReaderK8s::stop_reading()
 {
     if (running)
@@ -190,14 +247,45 @@ void RingBufReaderK8s::stop_reading()
 
 void RingBufReaderK8s::read_loop()
 {
-    const int timeout_ms = 100;
+    const auto report_interval = std::chrono::seconds(60);
+    auto last_report = std::chrono::steady_clock::now();
+    uint64_t start_switches = RingBufStats::thread_context_switches();
 
     while (running)
     {
-        int err = ring_buffer__poll(rb, timeout_ms);
-        if (err < 0 && err != -EINTR)
+        int err = ring_buffer__poll(rb, drain_interval_ms);
+        if (err > 0)
+        {
+            stats.wakeups++;
+        }
+        else if (err == 0)
+        {
+            // No wakeup within the interval, drain records below the watermark
+            if (ring_buffer__consume(rb) > 0)
+                stats.timer_drains++;
+        }
+        else if (err != -EINTR)
+        {
             Logger::error("Error polling ring buffer: " + std::to_string(err));
+        }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (tick_callback)
+        {
+            tick_callback();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= report_interval)
+        {
+            stats.context_switches = RingBufStats::thread_context_switches() - start_switches;
+            stats.report("K8s");
+            last_report = now;
+        }
     }
+
+    // Drain whatever is left before stopping
+    ring_buffer__consume(rb);
+
+    // RUSAGE_THREAD only sees this thread, sample here for the final report
+    stats.context_switches = RingBufStats::thread_context_switches() - start_switches;
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "RunqueueLatencyReader.hpp"
+#include "Logger.hpp"
+#include <bpf/libbpf.h>
+#include <unistd.h>
+#include <cstring>
+
+void runqueue_histogram::merge(const runqueue_histogram &other)
+{
+    for (int i = 0; i < RUNQUEUE_LATENCY_SLOTS; i++)
+    {
+        slots[i] += other.slots[i];
+    }
+    count += other.count;
+    sum_ns += other.sum_ns;
+}
+
+double runqueue_histogram::percentile_us(double q) const
+{
+    if (count == 0)
+        return 0;
+
+    double rank = q * count;
+    double seen = 0;
+    for (int i = 0; i < RUNQUEUE_LATENCY_SLOTS; i++)
+    {
+        if (slots[i] == 0)
+            continue;
+        if (seen + slots[i] >= rank)
+        {
+            double low = i == 0 ? 0 : static_cast<double>(1ULL << i);
+            double high = static_cast<double>(1ULL << (i + 1));
+            return low + (high - low) * (rank - seen) / slots[i];
+        }
+        seen += slots[i];
+    }
+    return static_cast<double>(1ULL << RUNQUEUE_LATENCY_SLOTS);
+}
+
+RunqueueLatencyReader::RunqueueLatencyReader(int histogram_fd)
+    : map_fd(histogram_fd >= 0 ? dup(histogram_fd) : -1)
+{
+    // Per-CPU maps return one value per possible CPU
+    int cpus = libbpf_num_possible_cpus();
+    percpu_values.resize(cpus > 0 ? cpus : 1);
+}
+
+RunqueueLatencyReader::~RunqueueLatencyReader()
+{
+    if (map_fd >= 0)
+        ::close(map_fd);
+}
+
+bool RunqueueLatencyReader::read(__u64 cgroup_id, runqueue_histogram &total)
+{
+    if (bpf_map_lookup_elem(map_fd, &cgroup_id, percpu_values.data()) != 0)
+        return false;
+
+    memset(&total, 0, sizeof(total));
+    for (const auto &value : percpu_values)
+    {
+        total.merge(value);
+    }
+    return true;
+}
+
+std::unordered_map<__u64, runqueue_histogram> RunqueueLatencyReader::sample()
+{
+    std::unordered_map<__u64, runqueue_histogram> deltas;
+    if (map_fd < 0)
+        return deltas;
+
+    std::vector<__u64> idle;
+    std::unordered_map<__u64, runqueue_histogram> current;
+    __u64 key = 0;
+    __u64 next_key = 0;
+    void *prev_key = nullptr;
+
+    while (bpf_map_get_next_key(map_fd, prev_key, &next_key) == 0)
+    {
+        key = next_key;
+        prev_key = &key;
+
+        runqueue_histogram total;
+        if (!read(key, total))
+            continue;
+
+        runqueue_histogram delta = total;
+        auto it = previous.find(key);
+        if (it != previous.end())
+        {
+            for (int i = 0; i < RUNQUEUE_LATENCY_SLOTS; i++)
+            {
+                delta.slots[i] -= it->second.slots[i];
+            }
+            delta.count -= it->second.count;
+            delta.sum_ns -= it->second.sum_ns;
+        }
+
+        if (delta.count == 0)
+        {
+            idle.push_back(key);
+            continue;
+        }
+        current.emplace(key, total);
+        deltas.emplace(key, delta);
+    }
+
+    // Removing while iterating would restart get_next_key
+    for (__u64 cgroup_id : idle)
+    {
+        bpf_map_delete_elem(map_fd, &cgroup_id);
+    }
+    previous.swap(current);
+
+    LOG_DEBUG("Run-queue latency: {} active cgroups, {} idle removed", deltas.size(), idle.size());
+    return deltas;
+}
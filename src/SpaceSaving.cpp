@@ -0,0 +1,137 @@
+#include "SpaceSaving.hpp"
+#include <algorithm>
+
+SpaceSaving::SpaceSaving(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)), total_(0)
+{
+    heap_.reserve(capacity_);
+    index_.reserve(capacity_);
+}
+
+void SpaceSaving::swap_entries(size_t a, size_t b)
+{
+    std::swap(heap_[a], heap_[b]);
+    index_[heap_[a].key] = a;
+    index_[heap_[b].key] = b;
+}
+
+void SpaceSaving::sift_down(size_t i)
+{
+    // Counts only grow, so an updated entry can only move away from the root
+    while (true)
+    {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < heap_.size() && heap_[left].count < heap_[smallest].count)
+            smallest = left;
+        if (right < heap_.size() && heap_[right].count < heap_[smallest].count)
+            smallest = right;
+        if (smallest == i)
+            return;
+        swap_entries(i, smallest);
+        i = smallest;
+    }
+}
+
+void SpaceSaving::add(const std::string &key, double weight)
+{
+    total_ += weight;
+
+    auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        heap_[it->second].count += weight;
+        sift_down(it->second);
+        return;
+    }
+
+    if (heap_.size() < capacity_)
+    {
+        // New entries start at the bottom and move up to their place
+        heap_.push_back({key, weight, 0});
+        size_t i = heap_.size() - 1;
+        index_[key] = i;
+        while (i > 0 && heap_[(i - 1) / 2].count > heap_[i].count)
+        {
+            swap_entries(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+
+    // Replace the minimum, which becomes the new key's overestimation
+    Entry &minimum = heap_[0];
+    index_.erase(minimum.key);
+    minimum.error = minimum.count;
+    minimum.count += weight;
+    minimum.key = key;
+    index_[key] = 0;
+    sift_down(0);
+}
+
+double SpaceSaving::floor() const
+{
+    // Untracked keys of a full summary weigh at most its smallest count
+    return heap_.size() >= capacity_ ? heap_[0].count : 0;
+}
+
+void SpaceSaving::merge(const SpaceSaving &other)
+{
+    double own_floor = floor();
+    double other_floor = other.floor();
+
+    std::unordered_map<std::string, Entry> combined;
+    for (const auto &entry : heap_)
+    {
+        combined.emplace(entry.key, Entry{entry.key, entry.count + other_floor, entry.error + other_floor});
+    }
+    for (const auto &entry : other.heap_)
+    {
+        auto [it, inserted] = combined.try_emplace(entry.key, Entry{entry.key, entry.count + own_floor,
+                                                                    entry.error + own_floor});
+        if (!inserted)
+        {
+            // Tracked by both, the floor added above was not needed
+            it->second.count += entry.count - other_floor;
+            it->second.error += entry.error - other_floor;
+        }
+    }
+
+    // Keep the largest, an ascending array is a valid min-heap
+    heap_.clear();
+    for (auto &[key, entry] : combined)
+    {
+        heap_.push_back(std::move(entry));
+    }
+    std::sort(heap_.begin(), heap_.end(), [](const Entry &a, const Entry &b)
+              { return a.count > b.count; });
+    if (heap_.size() > capacity_)
+        heap_.resize(capacity_);
+    std::reverse(heap_.begin(), heap_.end());
+
+    index_.clear();
+    for (size_t i = 0; i < heap_.size(); i++)
+    {
+        index_[heap_[i].key] = i;
+    }
+    total_ += other.total_;
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::top(size_t k) const
+{
+    std::vector<Entry> entries = heap_;
+    size_t n = std::min(k, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + static_cast<long>(n), entries.end(),
+                      [](const Entry &a, const Entry &b)
+                      { return a.count > b.count; });
+    entries.resize(n);
+    return entries;
+}
+
+void SpaceSaving::clear()
+{
+    heap_.clear();
+    index_.clear();
+    total_ = 0;
+}
@@ -0,0 +1,82 @@
+#include "SyscallFrequencyModule.hpp"
+#include "Logger.hpp"
+#include "LineBatch.hpp"
+#include <chrono>
+
+bool SyscallFrequencyModule::start(AgentContext &context)
+{
+    context_ = &context;
+    if (!bpf_loader_.load(BPF_PROBE_SYSCALL_FREQUENCY))
+    {
+        Logger::error("Failed to load syscall frequency probe");
+        return false;
+    }
+
+    try
+    {
+        reader_ = std::make_unique<BpfSyscallFrequencyReader>(bpf_loader_.syscall_counts_fd(),
+                                                              bpf_loader_.cgroup_syscall_counts_fd(),
+                                                              bpf_loader_.syscall_counts_config_fd());
+    }
+    catch (const std::exception &e)
+    {
+        Logger::error("Failed to open syscall frequency maps: " + std::string(e.what()));
+        bpf_loader_.destroy();
+        return false;
+    }
+
+    // Cgroups resolve to pods through the shared metadata cache
+    per_cgroup_ = reader_->enablePerCgroup(true);
+    if (!per_cgroup_)
+    {
+        Logger::warn("Per-cgroup syscall counting unavailable");
+    }
+
+    return context.loop.add_timer(std::chrono::milliseconds(SYSCALL_FREQUENCY_INTERVAL_MS), [this]()
+                                  { sample(); });
+}
+
+void SyscallFrequencyModule::sample()
+{
+    uint64_t timestamp = context_->influx.timestamp(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count()));
+
+    std::vector<std::string> lines;
+    for (const auto &[key, freq] : reader_->sample())
+    {
+        lines.push_back("syscall_counts,syscall=" + reader_->getSyscallName(key) +
+                        " count=" + std::to_string(freq.count) + ",rate=" + std::to_string(freq.rate_per_sec) +
+                        " " + std::to_string(timestamp));
+    }
+
+    if (per_cgroup_)
+    {
+        for (const auto &[cgroup_id, counts] : reader_->readPerCgroup())
+        {
+            PodInfoPtr info = context_->metadata.for_cgroup(cgroup_id);
+            std::string series = "syscall_counts_cgroup,cgroup_id=" + std::to_string(cgroup_id) +
+                                 ",pod=" + escape_tag(info->pod) + ",container=" + escape_tag(info->container) +
+                                 ",syscall=";
+            for (const auto &[key, count] : counts)
+            {
+                lines.push_back(series + reader_->getSyscallName(key) + " count=" + std::to_string(count) +
+                                " " + std::to_string(timestamp));
+            }
+        }
+    }
+
+    if (!lines.empty())
+        context_->sinks.publish(std::move(lines), true);
+}
+
+void SyscallFrequencyModule::stop()
+{
+    if (reader_)
+    {
+        reader_->enablePerCgroup(false);
+        reader_.reset();
+    }
+    bpf_loader_.destroy();
+}
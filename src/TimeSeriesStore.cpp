@@ -0,0 +1,337 @@
+#include "TimeSeriesStore.hpp"
+#include <bit>
+#include <cstring>
+#include <algorithm>
+
+// Reads a block's bit stream from the front
+class BitReader
+{
+private:
+    const uint8_t *data_;
+    size_t position_;
+
+public:
+    explicit BitReader(const uint8_t *data) : data_(data), position_(0) {}
+
+    uint64_t read(int bits)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bits; i++)
+        {
+            value = (value << 1) | ((data_[position_ >> 3] >> (7 - (position_ & 7))) & 1);
+            position_++;
+        }
+        return value;
+    }
+};
+
+void TimeSeriesBlock::reset()
+{
+    data_.fill(0);
+    bits_ = 0;
+    count_ = 0;
+    first_ms_ = 0;
+    last_ms_ = 0;
+    last_delta_ = 0;
+    last_value_ = 0;
+    last_leading_ = 0xff;
+    last_trailing_ = 0;
+}
+
+void TimeSeriesBlock::write_bits(uint64_t value, int bits)
+{
+    for (int i = bits - 1; i >= 0; i--)
+    {
+        if ((value >> i) & 1)
+            data_[bits_ >> 3] |= static_cast<uint8_t>(0x80 >> (bits_ & 7));
+        bits_++;
+    }
+}
+
+bool TimeSeriesBlock::append(int64_t ms, double value)
+{
+    if (bits_ + TIME_SERIES_MAX_POINT_BITS > TIME_SERIES_BLOCK_BYTES * 8)
+        return false;
+
+    uint64_t value_bits = std::bit_cast<uint64_t>(value);
+
+    // The first point is stored raw
+    if (count_ == 0)
+    {
+        write_bits(static_cast<uint64_t>(ms), 64);
+        write_bits(value_bits, 64);
+        first_ms_ = last_ms_ = ms;
+        last_value_ = value_bits;
+        count_ = 1;
+        return true;
+    }
+
+    // Timestamp: delta of deltas, small ones take a few bits
+    int64_t delta = ms - last_ms_;
+    int64_t dod = delta - last_delta_;
+    if (dod == 0)
+    {
+        write_bits(0, 1);
+    }
+    else if (dod >= -63 && dod <= 64)
+    {
+        write_bits(0b10, 2);
+        write_bits(static_cast<uint64_t>(dod + 63), 7);
+    }
+    else if (dod >= -255 && dod <= 256)
+    {
+        write_bits(0b110, 3);
+        write_bits(static_cast<uint64_t>(dod + 255), 9);
+    }
+    else if (dod >= -2047 && dod <= 2048)
+    {
+        write_bits(0b1110, 4);
+        write_bits(static_cast<uint64_t>(dod + 2047), 12);
+    }
+    else
+    {
+        write_bits(0b1111, 4);
+        write_bits(static_cast<uint64_t>(dod), 64);
+    }
+
+    // Value: XOR with the previous one, reusing its meaningful bit window
+    uint64_t x = value_bits ^ last_value_;
+    if (x == 0)
+    {
+        write_bits(0, 1);
+    }
+    else
+    {
+        uint8_t leading = static_cast<uint8_t>(std::min(std::countl_zero(x), 31));
+        uint8_t trailing = static_cast<uint8_t>(std::countr_zero(x));
+        if (last_leading_ != 0xff && leading >= last_leading_ && trailing >= last_trailing_)
+        {
+            write_bits(0b10, 2);
+            write_bits(x >> last_trailing_, 64 - last_leading_ - last_trailing_);
+        }
+        else
+        {
+            int meaningful = 64 - leading - trailing;
+            write_bits(0b11, 2);
+            write_bits(leading, 5);
+            write_bits(static_cast<uint64_t>(meaningful & 63), 6); // 64 is stored as 0
+            write_bits(x >> trailing, meaningful);
+            last_leading_ = leading;
+            last_trailing_ = trailing;
+        }
+    }
+
+    last_delta_ = delta;
+    last_ms_ = ms;
+    last_value_ = value_bits;
+    count_++;
+    return true;
+}
+
+void TimeSeriesBlock::for_each(const std::function<void(int64_t ms, double value)> &callback) const
+{
+    if (count_ == 0)
+        return;
+
+    BitReader reader(data_.data());
+    int64_t ms = static_cast<int64_t>(reader.read(64));
+    uint64_t value = reader.read(64);
+    int64_t delta = 0;
+    int leading = 0;
+    int trailing = 0;
+    callback(ms, std::bit_cast<double>(value));
+
+    for (uint32_t i = 1; i < count_; i++)
+    {
+        int64_t dod;
+        if (reader.read(1) == 0)
+            dod = 0;
+        else if (reader.read(1) == 0)
+            dod = static_cast<int64_t>(reader.read(7)) - 63;
+        else if (reader.read(1) == 0)
+            dod = static_cast<int64_t>(reader.read(9)) - 255;
+        else if (reader.read(1) == 0)
+            dod = static_cast<int64_t>(reader.read(12)) - 2047;
+        else
+            dod = static_cast<int64_t>(reader.read(64));
+        delta += dod;
+        ms += delta;
+
+        if (reader.read(1) == 1)
+        {
+            if (reader.read(1) == 1)
+            {
+                leading = static_cast<int>(reader.read(5));
+                int meaningful = static_cast<int>(reader.read(6));
+                if (meaningful == 0)
+                    meaningful = 64;
+                trailing = 64 - leading - meaningful;
+            }
+            value ^= reader.read(64 - leading - trailing) << trailing;
+        }
+        callback(ms, std::bit_cast<double>(value));
+    }
+}
+
+TimeSeriesStore::TimeSeriesStore(size_t blocks_per_series, size_t max_series)
+    : blocks_per_series_(std::max<size_t>(blocks_per_series, 1)), max_series_(max_series),
+      resolution_ms_(0), retention_ms_(0), rejected_series_(0)
+{
+}
+
+void TimeSeriesStore::configure(size_t blocks_per_series, std::chrono::milliseconds resolution,
+                                std::chrono::seconds retention)
+{
+    // Existing series keep their points, they are recycled in the new limits
+    blocks_per_series_ = std::max<size_t>(blocks_per_series, 1);
+    resolution_ms_ = resolution.count();
+    retention_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(retention).count();
+}
+
+bool TimeSeriesStore::add(const std::string &key, Clock::time_point time, double value)
+{
+    auto it = series_.find(key);
+    if (it == series_.end())
+    {
+        if (series_.size() >= max_series_)
+        {
+            rejected_series_++;
+            return false;
+        }
+        it = series_.emplace(key, Series()).first;
+    }
+    Series &series = it->second;
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+
+    if (resolution_ms_ <= 0)
+    {
+        store(series, ms, value);
+    }
+    else
+    {
+        int64_t bucket = ms - ms % resolution_ms_;
+        if (series.bucket_count > 0 && bucket != series.bucket_ms)
+        {
+            store(series, series.bucket_ms, series.bucket_sum / series.bucket_count);
+            series.bucket_count = 0;
+            series.bucket_sum = 0;
+        }
+        series.bucket_ms = bucket;
+        series.bucket_sum += value;
+        series.bucket_count++;
+    }
+
+    if (retention_ms_ > 0)
+        expire(series, ms);
+    return true;
+}
+
+void TimeSeriesStore::store(Series &series, int64_t ms, double value)
+{
+    if (!series.blocks.empty())
+    {
+        size_t newest = (series.oldest + series.blocks.size() - 1) % series.blocks.size();
+        if (series.blocks[newest].append(ms, value))
+            return;
+    }
+
+    // Grow the ring up to its limit, then recycle the oldest block
+    if (series.blocks.size() < blocks_per_series_)
+    {
+        series.blocks.insert(series.blocks.begin() + static_cast<long>(series.oldest), TimeSeriesBlock());
+        size_t newest = series.oldest;
+        series.oldest = (series.oldest + 1) % series.blocks.size();
+        series.blocks[newest].append(ms, value);
+        return;
+    }
+
+    TimeSeriesBlock &recycled = series.blocks[series.oldest];
+    recycled.reset();
+    recycled.append(ms, value);
+    series.oldest = (series.oldest + 1) % series.blocks.size();
+}
+
+void TimeSeriesStore::expire(Series &series, int64_t now_ms)
+{
+    // Reset whole blocks whose newest point is past the retention, never the newest block
+    for (size_t i = 0; i + 1 < series.blocks.size(); i++)
+    {
+        TimeSeriesBlock &block = series.blocks[(series.oldest + i) % series.blocks.size()];
+        if (block.count() == 0)
+            continue;
+        if (block.last_ms() >= now_ms - retention_ms_)
+            break;
+        block.reset();
+    }
+}
+
+void TimeSeriesStore::visit(const Series &series, int64_t from_ms, int64_t to_ms,
+                            const PointCallback &callback, size_t *points) const
+{
+    for (size_t i = 0; i < series.blocks.size(); i++)
+    {
+        const TimeSeriesBlock &block = series.blocks[(series.oldest + i) % series.blocks.size()];
+        if (block.count() == 0 || block.last_ms() < from_ms || block.first_ms() > to_ms)
+            continue;
+
+        block.for_each([&](int64_t ms, double value)
+                       {
+            if (ms >= from_ms && ms <= to_ms)
+            {
+                callback(Clock::time_point(std::chrono::milliseconds(ms)), value);
+                (*points)++;
+            } });
+    }
+
+    // The open downsampling bucket is visible with its running mean
+    if (series.bucket_count > 0 && series.bucket_ms >= from_ms && series.bucket_ms <= to_ms)
+    {
+        callback(Clock::time_point(std::chrono::milliseconds(series.bucket_ms)),
+                 series.bucket_sum / series.bucket_count);
+        (*points)++;
+    }
+}
+
+size_t TimeSeriesStore::query(const std::string &key, Clock::time_point from, Clock::time_point to,
+                              const PointCallback &callback) const
+{
+    auto it = series_.find(key);
+    if (it == series_.end())
+        return 0;
+
+    int64_t from_ms = std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count();
+    int64_t to_ms = std::chrono::duration_cast<std::chrono::milliseconds>(to.time_since_epoch()).count();
+    size_t points = 0;
+    visit(it->second, from_ms, to_ms, callback, &points);
+    return points;
+}
+
+std::vector<std::string> TimeSeriesStore::keys() const
+{
+    std::vector<std::string> result;
+    result.reserve(series_.size());
+    for (const auto &[key, series] : series_)
+    {
+        result.push_back(key);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void TimeSeriesStore::clear(const std::string &key)
+{
+    if (key.empty())
+        series_.clear();
+    else
+        series_.erase(key);
+}
+
+size_t TimeSeriesStore::memory_bytes() const
+{
+    size_t bytes = 0;
+    for (const auto &[key, series] : series_)
+    {
+        bytes += key.size() + sizeof(Series) + series.blocks.capacity() * sizeof(TimeSeriesBlock);
+    }
+    return bytes;
+}
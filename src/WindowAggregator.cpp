@@ -0,0 +1,151 @@
+#include "WindowAggregator.hpp"
+#include <algorithm>
+#include <limits>
+
+void RollupCounters::merge(const RollupCounters &other)
+{
+    cpu_ns += other.cpu_ns;
+    syscalls += other.syscalls;
+    syscall_latency_ns += other.syscall_latency_ns;
+    io_ops += other.io_ops;
+    io_latency_ns += other.io_latency_ns;
+    memory_alloc_kb += other.memory_alloc_kb;
+    memory_free_kb += other.memory_free_kb;
+}
+
+WindowAggregator::WindowAggregator()
+    : closed_until_ns_(0), first_ns_(-1), newest_ns_(0), late_events_(0)
+{
+}
+
+void WindowAggregator::configure(std::vector<std::chrono::seconds> durations)
+{
+    levels_.clear();
+    durations.erase(std::remove_if(durations.begin(), durations.end(),
+                                   [](std::chrono::seconds d)
+                                   { return d.count() <= 0; }),
+                    durations.end());
+    if (durations.empty())
+        return;
+
+    std::sort(durations.begin(), durations.end());
+    int64_t base = std::chrono::duration_cast<std::chrono::nanoseconds>(durations.front()).count();
+    for (auto duration : durations)
+    {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        ns = (ns + base - 1) / base * base;
+        if (levels_.empty() || levels_.back().duration_ns != ns)
+            levels_.push_back({ns, {}});
+    }
+}
+
+std::vector<std::chrono::seconds> WindowAggregator::durations() const
+{
+    std::vector<std::chrono::seconds> result;
+    for (const auto &level : levels_)
+    {
+        result.push_back(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::nanoseconds(level.duration_ns)));
+    }
+    return result;
+}
+
+RollupCounters &WindowAggregator::at(int64_t time_ns, const std::string &pod, const std::string &container,
+                                     const std::string &namespace_name)
+{
+    if (time_ns < closed_until_ns_)
+    {
+        late_events_++;
+        time_ns = closed_until_ns_;
+    }
+    if (first_ns_ < 0)
+        first_ns_ = time_ns;
+    newest_ns_ = std::max(newest_ns_, time_ns);
+
+    int64_t base = levels_[0].duration_ns;
+    auto &series = levels_[0].open[time_ns - time_ns % base];
+
+    std::string key = pod + '/' + container + '/' + namespace_name;
+    auto it = series.find(key);
+    if (it == series.end())
+        it = series.emplace(std::move(key), RollupSeries{pod, container, namespace_name, {}}).first;
+    return it->second.counters;
+}
+
+int64_t WindowAggregator::covered(int64_t start_ns, int64_t duration_ns, int64_t limit_ns) const
+{
+    int64_t from = std::max(start_ns, first_ns_);
+    int64_t to = std::min(start_ns + duration_ns, limit_ns);
+    return std::max<int64_t>(to - from, 1000000);
+}
+
+void WindowAggregator::close_base(int64_t start_ns, std::unordered_map<std::string, RollupSeries> &series,
+                                  int64_t limit_ns, const WindowCallback &callback)
+{
+    int64_t base = levels_[0].duration_ns;
+    callback({start_ns, base, covered(start_ns, base, limit_ns), series});
+
+    // Longer windows only see closed base windows
+    for (size_t i = 1; i < levels_.size(); i++)
+    {
+        int64_t duration = levels_[i].duration_ns;
+        auto &target = levels_[i].open[start_ns - start_ns % duration];
+        for (const auto &[key, entry] : series)
+        {
+            auto it = target.find(key);
+            if (it == target.end())
+                target.emplace(key, entry);
+            else
+                it->second.counters.merge(entry.counters);
+        }
+    }
+    closed_until_ns_ = std::max(closed_until_ns_, start_ns + base);
+}
+
+void WindowAggregator::close_levels(int64_t until_ns, int64_t limit_ns, const WindowCallback &callback)
+{
+    for (size_t i = 1; i < levels_.size(); i++)
+    {
+        Level &level = levels_[i];
+        while (!level.open.empty() && level.open.begin()->first + level.duration_ns <= until_ns)
+        {
+            auto node = level.open.extract(level.open.begin());
+            callback({node.key(), level.duration_ns, covered(node.key(), level.duration_ns, limit_ns), node.mapped()});
+        }
+    }
+}
+
+void WindowAggregator::advance(int64_t now_ns, const WindowCallback &callback)
+{
+    if (levels_.empty())
+        return;
+
+    int64_t base = levels_[0].duration_ns;
+    int64_t cutoff = now_ns - WINDOW_GRACE_NS;
+    auto &open = levels_[0].open;
+    while (!open.empty() && open.begin()->first + base <= cutoff)
+    {
+        auto node = open.extract(open.begin());
+        close_base(node.key(), node.mapped(), std::numeric_limits<int64_t>::max(), callback);
+    }
+
+    // Time passes without events too, windows then close empty or with what they got
+    if (first_ns_ >= 0)
+        closed_until_ns_ = std::max(closed_until_ns_, cutoff - cutoff % base);
+    close_levels(closed_until_ns_, std::numeric_limits<int64_t>::max(), callback);
+}
+
+void WindowAggregator::flush(const WindowCallback &callback)
+{
+    if (levels_.empty())
+        return;
+
+    // Partial windows cover up to the newest event
+    int64_t limit = newest_ns_ + 1;
+    auto &open = levels_[0].open;
+    while (!open.empty())
+    {
+        auto node = open.extract(open.begin());
+        close_base(node.key(), node.mapped(), limit, callback);
+    }
+    close_levels(std::numeric_limits<int64_t>::max(), limit, callback);
+}
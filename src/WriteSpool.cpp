@@ -0,0 +1,443 @@
+#include "WriteSpool.hpp"
+#include "InfluxClient.hpp"
+#include "Logger.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <zlib.h>
+
+static const char *segment_prefix = "segment-";
+static const char *segment_suffix = ".spool";
+
+// Seconds to wait before retrying an unreachable backend
+static const std::chrono::seconds replay_backoff(5);
+
+static size_t padded_record_size(size_t payload)
+{
+    return (sizeof(spool_record_header) + payload + 7) & ~static_cast<size_t>(7);
+}
+
+// writev() everything, resuming after short writes and splitting at IOV_MAX
+static bool write_all(int fd, std::vector<struct iovec> &iov)
+{
+    size_t first = 0;
+    while (first < iov.size())
+    {
+        int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        ssize_t written = writev(fd, &iov[first], count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        size_t left = static_cast<size_t>(written);
+        while (first < iov.size() && left >= iov[first].iov_len)
+        {
+            left -= iov[first].iov_len;
+            first++;
+        }
+        if (left > 0)
+        {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + left;
+            iov[first].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+WriteSpool::WriteSpool(const std::string &dir, size_t max_bytes, size_t segment_bytes)
+    : dir_(dir),
+      max_bytes_(max_bytes),
+      segment_bytes_(std::min(segment_bytes, max_bytes)),
+      active_fd_(-1),
+      next_seq_(1),
+      total_bytes_(0),
+      replaying_seq_(0),
+      replaying_(false),
+      spooled_batches_(0),
+      replayed_batches_(0),
+      dropped_bytes_(0),
+      dropped_records_(0)
+{
+}
+
+WriteSpool::~WriteSpool()
+{
+    close();
+}
+
+std::string WriteSpool::segment_path(uint64_t seq) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s%020llu%s", segment_prefix,
+             static_cast<unsigned long long>(seq), segment_suffix);
+    return dir_ + "/" + name;
+}
+
+bool WriteSpool::open()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec)
+    {
+        Logger::error("Failed to create spool directory " + dir_ + ": " + ec.message());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Segments from a previous run are sealed and replayed first
+    for (const auto &entry : std::filesystem::directory_iterator(dir_, ec))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind(segment_prefix, 0) != 0 || !name.ends_with(segment_suffix))
+            continue;
+
+        uint64_t seq = std::strtoull(name.c_str() + strlen(segment_prefix), nullptr, 10);
+        if (seq == 0)
+            continue;
+
+        size_t bytes = entry.file_size(ec);
+        segments_.push_back({seq, entry.path().string(), ec ? 0 : bytes, 0});
+        total_bytes_ += segments_.back().bytes;
+        next_seq_ = std::max(next_seq_, seq + 1);
+    }
+    std::sort(segments_.begin(), segments_.end(), [](const Segment &a, const Segment &b)
+              { return a.seq < b.seq; });
+
+    if (!segments_.empty())
+    {
+        Logger::info("Found " + std::to_string(segments_.size()) + " spool segments (" +
+                     std::to_string(total_bytes_) + " bytes) in " + dir_);
+    }
+    return true;
+}
+
+void WriteSpool::close()
+{
+    stop_replay();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    seal_active_segment();
+}
+
+void WriteSpool::seal_active_segment()
+{
+    if (active_fd_ >= 0)
+    {
+        fdatasync(active_fd_);
+        ::close(active_fd_);
+        active_fd_ = -1;
+    }
+}
+
+bool WriteSpool::roll_segment()
+{
+    seal_active_segment();
+
+    uint64_t seq = next_seq_++;
+    std::string path = segment_path(seq);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        Logger::error("Failed to create spool segment " + path + ": " + strerror(errno));
+        return false;
+    }
+
+    active_fd_ = fd;
+    segments_.push_back({seq, path, 0, 0});
+    return true;
+}
+
+bool WriteSpool::make_room(size_t bytes)
+{
+    // Drop the oldest data first; the segment being replayed stays
+    auto it = segments_.begin();
+    while (total_bytes_ + bytes > max_bytes_ && it != segments_.end())
+    {
+        if (it->seq == replaying_seq_)
+        {
+            ++it;
+            continue;
+        }
+
+        if (active_fd_ >= 0 && it->seq == segments_.back().seq)
+            seal_active_segment();
+
+        Logger::warn("Spool full, dropping " + std::to_string(it->bytes) + " bytes from " + it->path);
+        unlink(it->path.c_str());
+        total_bytes_ -= it->bytes;
+        dropped_bytes_ += it->bytes;
+        it = segments_.erase(it);
+    }
+    return total_bytes_ + bytes <= max_bytes_;
+}
+
+bool WriteSpool::append(std::span<const std::string> chunks, bool newline_terminated, bool gzip,
+                        InfluxClient::Precision precision)
+{
+    static const char newline = '\n';
+    static const char padding[8] = {};
+
+    spool_record_header header = {};
+    header.magic = SPOOL_RECORD_MAGIC;
+    header.flags = (gzip ? SPOOL_RECORD_GZIP : 0) |
+                   (static_cast<uint32_t>(precision) << SPOOL_RECORD_PRECISION_SHIFT);
+
+    // Gather the chunks in place, the body is never assembled in memory
+    std::vector<struct iovec> iov;
+    iov.reserve(chunks.size() * (newline_terminated ? 2 : 1) + 2);
+    iov.push_back({&header, sizeof(header)});
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (const auto &chunk : chunks)
+    {
+        iov.push_back({const_cast<char *>(chunk.data()), chunk.size()});
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(chunk.data()), static_cast<uInt>(chunk.size()));
+        header.length += chunk.size();
+        if (newline_terminated)
+        {
+            iov.push_back({const_cast<char *>(&newline), 1});
+            crc = crc32(crc, reinterpret_cast<const Bytef *>(&newline), 1);
+            header.length++;
+        }
+    }
+    header.crc = static_cast<uint32_t>(crc);
+
+    size_t record_bytes = padded_record_size(header.length);
+    size_t pad = record_bytes - sizeof(header) - header.length;
+    if (pad > 0)
+        iov.push_back({const_cast<char *>(padding), pad});
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!make_room(record_bytes))
+    {
+        Logger::error("Spool cannot hold a " + std::to_string(record_bytes) + " byte batch, dropping it");
+        dropped_bytes_ += record_bytes;
+        return false;
+    }
+
+    if (active_fd_ < 0 || (segments_.back().bytes > 0 && segments_.back().bytes + record_bytes > segment_bytes_))
+    {
+        if (!roll_segment())
+            return false;
+    }
+
+    Segment &segment = segments_.back();
+    if (!write_all(active_fd_, iov))
+    {
+        Logger::error("Failed to write spool segment " + segment.path + ": " + strerror(errno));
+
+        // A torn record ends the segment, continue in a fresh one
+        struct stat st;
+        if (fstat(active_fd_, &st) == 0)
+        {
+            total_bytes_ += static_cast<size_t>(st.st_size) - segment.bytes;
+            segment.bytes = static_cast<size_t>(st.st_size);
+        }
+        seal_active_segment();
+        return false;
+    }
+
+    segment.bytes += record_bytes;
+    total_bytes_ += record_bytes;
+    spooled_batches_++;
+    cv_.notify_all();
+    return true;
+}
+
+size_t WriteSpool::size_bytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_bytes_;
+}
+
+void WriteSpool::start_replay(InfluxClient &client, size_t bytes_per_sec)
+{
+    if (replaying_)
+        return;
+
+    replaying_ = true;
+    replay_thread_ = std::thread(&WriteSpool::replay_loop, this, std::ref(client), bytes_per_sec);
+}
+
+void WriteSpool::stop_replay()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replaying_ = false;
+    }
+    cv_.notify_all();
+    if (replay_thread_.joinable())
+    {
+        replay_thread_.join();
+    }
+}
+
+bool WriteSpool::wait_for(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_until(lock, deadline, [this]()
+                   { return !replaying_; });
+    return replaying_;
+}
+
+void WriteSpool::replay_loop(InfluxClient &client, size_t bytes_per_sec)
+{
+    while (replaying_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]()
+                     { return !replaying_ || !segments_.empty(); });
+            if (!replaying_)
+                break;
+        }
+
+        if (!client.ping())
+        {
+            wait_for(std::chrono::steady_clock::now() + replay_backoff);
+            continue;
+        }
+
+        Segment segment;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (segments_.empty())
+                continue;
+
+            // Seal the segment being appended to so it can be replayed as a whole
+            if (active_fd_ >= 0 && segments_.size() == 1)
+                seal_active_segment();
+
+            segment = segments_.front();
+            replaying_seq_ = segment.seq;
+        }
+
+        bool done = replay_segment(client, segment, bytes_per_sec);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            replaying_seq_ = 0;
+            if (done && !segments_.empty() && segments_.front().seq == segment.seq)
+            {
+                unlink(segment.path.c_str());
+                total_bytes_ -= segments_.front().bytes;
+                segments_.pop_front();
+                Logger::info("Replayed spool segment " + segment.path);
+            }
+        }
+
+        if (!done)
+        {
+            wait_for(std::chrono::steady_clock::now() + replay_backoff);
+        }
+    }
+}
+
+// Resend the records of one sealed segment. Progress is only kept in memory,
+// so a segment interrupted by a restart is resent from the start; the points
+// carry their own timestamps, which makes the duplicate writes idempotent.
+bool WriteSpool::replay_segment(InfluxClient &client, Segment segment, size_t bytes_per_sec)
+{
+    int fd = ::open(segment.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        Logger::error("Failed to open spool segment " + segment.path + ": " + strerror(errno));
+        return true;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        Logger::error("Failed to map spool segment " + segment.path + ": " + strerror(errno));
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char *base = static_cast<const char *>(map);
+    size_t offset = segment.replayed;
+    bool done = true;
+    auto next_send = std::chrono::steady_clock::now();
+
+    while (offset + sizeof(spool_record_header) <= size)
+    {
+        const auto *header = reinterpret_cast<const spool_record_header *>(base + offset);
+        const char *payload = base + offset + sizeof(spool_record_header);
+        size_t available = size - offset - sizeof(spool_record_header);
+
+        if (header->magic != SPOOL_RECORD_MAGIC || header->length > available ||
+            crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(payload),
+                  static_cast<uInt>(header->length)) != header->crc)
+        {
+            Logger::warn("Discarding torn or corrupt tail of spool segment " + segment.path);
+            break;
+        }
+
+        // Pace the resend so a backlog does not swamp a recovering backend
+        if (!wait_for(next_send))
+        {
+            done = false;
+            break;
+        }
+
+        auto precision = static_cast<InfluxClient::Precision>((header->flags >> SPOOL_RECORD_PRECISION_SHIFT) & 0xff);
+        auto outcome = client.writeEncoded(std::string_view(payload, header->length),
+                                           header->flags & SPOOL_RECORD_GZIP, precision);
+        if (outcome == InfluxClient::WriteOutcome::RETRY)
+        {
+            done = false;
+            break;
+        }
+
+        // A record the backend refuses would otherwise block the segment forever
+        if (outcome == InfluxClient::WriteOutcome::OK)
+        {
+            replayed_batches_++;
+        }
+        else
+        {
+            dropped_records_++;
+            dropped_bytes_ += header->length;
+            Logger::warn("Dropping spooled batch of " + std::to_string(header->length) + " bytes from " +
+                         segment.path + ": " + (outcome == InfluxClient::WriteOutcome::TOO_LARGE ? "too large" : "rejected"));
+        }
+        offset += padded_record_size(header->length);
+        if (bytes_per_sec > 0)
+        {
+            next_send = std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(header->length * 1000000 / bytes_per_sec);
+        }
+    }
+
+    munmap(map, size);
+
+    if (!done)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &s : segments_)
+        {
+            if (s.seq == segment.seq)
+                s.replayed = offset;
+        }
+    }
+    return done;
+}
@@ -0,0 +1,173 @@
+#include <csignal>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
+#include "AgentLoop.hpp"
+#include "PodMetadataCache.hpp"
+#include "ProbeModule.hpp"
+#include "InfluxClient.hpp"
+#include "MetricSink.hpp"
+#include "WriteSpool.hpp"
+#include "Logger.hpp"
+
+#define AGENT_METADATA_REFRESH_MS 30000
+#define AGENT_DEFAULT_SPOOL_DIR "/var/lib/ebpf-agent/spool"
+
+static AgentLoop *agentLoop = nullptr;
+
+static void onSignal(int)
+{
+    // stop() only sets a flag and writes an eventfd, both signal safe
+    if (agentLoop)
+        agentLoop->stop();
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(LogLevel::INFO);
+    Logger::enableAsync(true);
+
+    std::string influxHost = argc > 1 ? argv[1] : "localhost";
+    std::string database = argc > 3 ? argv[3] : "k8s_performance";
+
+    // InfluxDB port, write spool size bound and replay rate; bad values stop the agent
+    int influxPort = 8086;
+    size_t maxMb = 512;
+    size_t replayKbps = 1024;
+    try
+    {
+        if (argc > 2)
+            influxPort = std::stoi(argv[2]);
+        if (const char *value = std::getenv("AGENT_SPOOL_MAX_MB"))
+            maxMb = std::stoull(value);
+        if (const char *value = std::getenv("AGENT_SPOOL_REPLAY_KBPS"))
+            replayKbps = std::stoull(value);
+    }
+    catch (const std::exception &e)
+    {
+        Logger::error("Invalid InfluxDB port, AGENT_SPOOL_MAX_MB or AGENT_SPOOL_REPLAY_KBPS: " + std::string(e.what()));
+        return 1;
+    }
+
+    // One exporter for every module
+    InfluxClient influx("http", influxHost, influxPort, database);
+    if (!influx.ping())
+    {
+        Logger::warn("InfluxDB connection test failed - check if InfluxDB is running");
+    }
+    if (!influx.createDatabase(database))
+    {
+        Logger::warn("Failed to create database, it might already exist");
+    }
+
+    // Write spool for InfluxDB outages, AGENT_SPOOL_DIR="" disables it.
+    // The failed write handler has to be in place before async mode starts.
+    const char *spoolDir = std::getenv("AGENT_SPOOL_DIR");
+    std::unique_ptr<WriteSpool> spool;
+    if (!spoolDir || *spoolDir)
+    {
+        spool = std::make_unique<WriteSpool>(spoolDir ? spoolDir : AGENT_DEFAULT_SPOOL_DIR, maxMb * 1024 * 1024);
+        if (spool->open())
+        {
+            WriteSpool *spoolPtr = spool.get();
+            influx.setFailedWriteHandler([spoolPtr, &influx](std::span<const std::string> chunks, bool newlineTerminated, bool gzip)
+                                         { spoolPtr->append(chunks, newlineTerminated, gzip, influx.precision()); });
+            spool->start_replay(influx, replayKbps * 1024);
+        }
+        else
+        {
+            Logger::warn("Write spool unavailable, batches are dropped while InfluxDB is down");
+            spool.reset();
+        }
+    }
+
+    if (!influx.enableAsync())
+    {
+        Logger::warn("Async InfluxDB writes unavailable, writing synchronously");
+    }
+
+    // Metric sinks: comma separated influx, stdout, file:<path>, prometheus[:<port>]
+    MetricFanout sinks;
+    const char *sinkSpec = std::getenv("AGENT_SINKS");
+    const char *metricsGzip = std::getenv("AGENT_METRICS_GZIP");
+    if (!add_sinks_from_spec(sinks, sinkSpec ? sinkSpec : "influx,prometheus:9400", influx,
+                             !metricsGzip || std::string(metricsGzip) != "0") ||
+        sinks.empty())
+    {
+        Logger::error("Invalid AGENT_SINKS");
+        return 1;
+    }
+    if (!sinks.start())
+    {
+        Logger::warn("Some metric sinks failed to start, their metrics are dropped");
+    }
+
+    AgentLoop loop;
+    if (!loop.open())
+    {
+        return 1;
+    }
+
+    // Pod metadata resolved once for every module
+    PodMetadataCache metadata;
+    metadata.refresh();
+    loop.add_timer(std::chrono::milliseconds(AGENT_METADATA_REFRESH_MS), [&metadata]()
+                   { metadata.refresh(); });
+
+    // Enabled probe modules, comma separated: cpu, memory, syscall_latency, runqueue_latency, syscall_frequency
+    const char *moduleSpec = std::getenv("AGENT_MODULES");
+    std::vector<std::unique_ptr<ProbeModule>> modules;
+    if (!make_probe_modules(moduleSpec ? moduleSpec : "cpu,memory,syscall_latency,runqueue_latency,syscall_frequency", modules) ||
+        modules.empty())
+    {
+        Logger::error("Invalid AGENT_MODULES");
+        return 1;
+    }
+
+    AgentContext context{loop, metadata, influx, sinks};
+    size_t started = 0;
+    for (auto &module : modules)
+    {
+        if (module->start(context))
+        {
+            Logger::info(std::string("Started probe module ") + module->name());
+            started++;
+        }
+        else
+        {
+            Logger::error(std::string("Failed to start probe module ") + module->name());
+        }
+    }
+
+    if (started > 0)
+    {
+        agentLoop = &loop;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+
+        Logger::info("eBPF agent running " + std::to_string(started) + " modules. Press Ctrl+C to stop...");
+        loop.run();
+        agentLoop = nullptr;
+    }
+
+    // Modules publish their last metrics before the sinks drain
+    for (auto &module : modules)
+    {
+        module->stop();
+    }
+    sinks.stop();
+    sinks.report();
+    influx.disableAsync();
+    if (spool)
+    {
+        spool->close(); // Whatever is left is replayed on the next start
+        Logger::info("Write spool: " + std::to_string(spool->spooled_batches()) + " batches spooled, " +
+                     std::to_string(spool->replayed_batches()) + " replayed, " +
+                     std::to_string(spool->dropped_records()) + " refused, " +
+                     std::to_string(spool->size_bytes()) + " bytes pending");
+    }
+    loop.close();
+
+    Logger::info("eBPF agent stopped");
+    return started > 0 ? 0 : 1;
+}
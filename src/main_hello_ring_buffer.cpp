@@ -1,16 +1,28 @@
+#include "BpfLoader.hpp"
 #include "RingBufReaderDataT.hpp"
 #include "Logger.hpp"
 #include "InfluxClient.hpp"
+#include "MetricSink.hpp"
+#include "MetricBatcher.hpp"
 #include <thread>
 #include <chrono>
+#include <cstdlib>
 
 int main()
 {
     Logger::setLogLevel(LogLevel::INFO);
-    RingBufReaderDataT ringBufReader("/sys/fs/bpf/output");
+    BpfLoader bpfLoader;
+    RingBufReaderDataT ringBufReader;
     InfluxClient influxClient("http", "localhost", 8086, "hello_ring_buffer");
 
-    if (!ringBufReader.open())
+    // Load and attach the embedded hello ring buffer probe
+    if (!bpfLoader.load(BPF_PROBE_HELLO_RING_BUFFER))
+    {
+        Logger::error("Failed to load hello ring buffer probe");
+        return 1;
+    }
+
+    if (!ringBufReader.open(bpfLoader.hello_output_fd()))
     {
         Logger::error("Failed to open ring buffer reader");
         return 1;
@@ -22,21 +34,30 @@ int main()
         return 1;
     }
 
+    // Pipeline writes instead of blocking the ring buffer thread per event
+    influxClient.enableAsync();
+
+    // Metric sinks: comma separated influx, stdout, file:<path>, prometheus[:<port>]
+    MetricFanout sinks;
+    const char *sinkSpec = std::getenv("HELLO_RING_BUFFER_SINKS");
+    if (!add_sinks_from_spec(sinks, sinkSpec ? sinkSpec : "influx", influxClient) || sinks.empty())
+    {
+        Logger::error("Invalid HELLO_RING_BUFFER_SINKS");
+        return 1;
+    }
+    sinks.start();
+
+    // Events become one write per batch, at most a second late
+    MetricBatcher batcher(sinks);
+    batcher.start();
+
     auto eventCallback = [&](const data_t &event)
     {
-        Logger::debug(std::format("PID: {}, UID: {}, Command: {}, Message: {}",
-                                  event.pid, event.uid, event.command, event.message));
-
-        std::string line = std::format("hello_events,pid={},uid={},command={} message=\"{}\"",
-                                       event.pid, event.uid, event.command, event.message);
-        if (influxClient.writeRaw(line))
-        {
-            Logger::debug("Successfully wrote event to InfluxDB");
-        }
-        else
-        {
-            Logger::error("Failed to write event to InfluxDB");
-        }
+        LOG_DEBUG("PID: {}, UID: {}, Command: {}, Message: {}",
+                  event.pid, event.uid, event.command, event.message);
+
+        batcher.add(std::format("hello_events,pid={},uid={},command={} message=\"{}\"",
+                                event.pid, event.uid, event.command, event.message));
     };
 
     ringBufReader.start_reading(eventCallback);
@@ -49,6 +70,12 @@ int main()
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
     ringBufReader.stop_reading();
+    ringBufReader.get_stats().report("Hello");
     ringBufReader.close();
+    batcher.stop();
+    batcher.report("Hello events");
+    sinks.stop();
+    sinks.report();
+    influxClient.disableAsync();
     return 0;
 }
\ No newline at end of file
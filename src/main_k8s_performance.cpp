@@ -1,6 +1,7 @@
 #include <iostream>
 #include <csignal>
 #include <atomic>
+#include <cstdlib>
 #include "K8sPerformanceCollector.hpp"
 #include "Logger.hpp"
 
@@ -9,6 +10,16 @@ int main(int argc, char *argv[])
 
     Logger::setLogLevel(LogLevel::INFO);
 
+    // Format and write log lines off the event processing thread, K8S_LOG_ASYNC=0 disables
+    const char *log_async = std::getenv("K8S_LOG_ASYNC");
+    Logger::enableAsync(!log_async || std::string(log_async) != "0");
+
+    // Binary log file rendered offline with ebpf-log-decoder, replaces text output
+    if (const char *log_binary = std::getenv("K8S_LOG_BINARY"))
+    {
+        Logger::enableBinaryOutput(log_binary);
+    }
+
     try
     {
         // Configure from command line or environment variables
@@ -24,6 +35,60 @@ int main(int argc, char *argv[])
             database = argv[3];
 
         K8sPerformanceCollector collector("http", influx_host, influx_port, database);
+        collector.configure_from_env();
+
+        // InfluxDB v2: a token selects /api/v2/write, the bucket defaults to the database name
+        if (const char *token = std::getenv("K8S_INFLUX_TOKEN"))
+        {
+            const char *org = std::getenv("K8S_INFLUX_ORG");
+            const char *bucket = std::getenv("K8S_INFLUX_BUCKET");
+            collector.use_influx_v2(org ? org : "", bucket ? bucket : database, token);
+            Logger::info("Using the InfluxDB v2 write API");
+        }
+
+        // Timestamp precision: s, ms, us or ns (default)
+        if (const char *precision = std::getenv("K8S_INFLUX_PRECISION"))
+        {
+            InfluxClient::Precision value;
+            if (InfluxClient::parsePrecision(precision, &value))
+                collector.set_timestamp_precision(value);
+            else
+                Logger::warn("Ignoring unknown K8S_INFLUX_PRECISION " + std::string(precision));
+        }
+
+        // Optional gzip level (1-9) for InfluxDB write payloads
+        if (const char *level = std::getenv("K8S_INFLUX_GZIP_LEVEL"))
+        {
+            collector.set_compression_level(std::stoi(level));
+        }
+
+        // Metric sinks: comma separated influx, stdout, file:<path>, prometheus[:<port>].
+        // Defaults to InfluxDB plus the Prometheus endpoint on K8S_METRICS_PORT (0 disables it)
+        std::string sinks = "influx";
+        const char *metrics_port = std::getenv("K8S_METRICS_PORT");
+        if (!metrics_port || std::stoi(metrics_port) > 0)
+            sinks += ",prometheus:" + std::string(metrics_port ? metrics_port : "9400");
+        if (const char *value = std::getenv("K8S_SINKS"))
+            sinks = value;
+        // The Prometheus endpoint gzips its snapshots unless K8S_METRICS_GZIP=0
+        const char *metrics_gzip = std::getenv("K8S_METRICS_GZIP");
+        if (!add_sinks_from_spec(collector.sinks(), sinks, collector.influx_client(),
+                                 !metrics_gzip || std::string(metrics_gzip) != "0"))
+        {
+            Logger::warn("Ignoring invalid entries in K8S_SINKS " + sinks);
+        }
+
+        // Write spool for InfluxDB outages: directory ("" disables), size bound and replay rate
+        if (const char *spool_dir = std::getenv("K8S_SPOOL_DIR"))
+        {
+            size_t max_mb = 512;
+            size_t replay_kbps = 1024;
+            if (const char *value = std::getenv("K8S_SPOOL_MAX_MB"))
+                max_mb = std::stoull(value);
+            if (const char *value = std::getenv("K8S_SPOOL_REPLAY_KBPS"))
+                replay_kbps = std::stoull(value);
+            collector.set_spool(spool_dir, max_mb * 1024 * 1024, replay_kbps * 1024);
+        }
 
         Logger::info("Starting Kubernetes Performance Monitor");
         Logger::info("InfluxDB: " + influx_host + ":" + std::to_string(influx_port) + "/" + database);
@@ -0,0 +1,285 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <variant>
+#include <unordered_map>
+#include <algorithm>
+#include <ctime>
+#include <bit>
+#include <cstring>
+#include "BinaryLog.hpp"
+
+// Renders binary logs written by Logger::enableBinaryOutput() as text
+
+struct LogSite
+{
+    uint8_t level;
+    uint32_t line;
+    std::string types;
+    std::string format;
+    std::string file;
+};
+
+using LogArgument = std::variant<int64_t, uint64_t, double, std::string>;
+
+static const char *level_names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+class Reader
+{
+private:
+    std::vector<char> data_;
+    size_t pos_ = 0;
+
+public:
+    explicit Reader(std::vector<char> data) : data_(std::move(data)) {}
+
+    bool available(size_t bytes) const { return pos_ + bytes <= data_.size(); }
+    bool done() const { return pos_ >= data_.size(); }
+
+    template <typename T>
+    bool read(T *value)
+    {
+        if (!available(sizeof(T)))
+            return false;
+        memcpy(value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool skip(size_t bytes)
+    {
+        if (!available(bytes))
+            return false;
+        pos_ += bytes;
+        return true;
+    }
+
+    bool read(std::string *value, size_t length)
+    {
+        if (!available(length))
+            return false;
+        value->assign(data_.data() + pos_, length);
+        pos_ += length;
+        return true;
+    }
+};
+
+// Format one replacement field, e.g. "{:.1f}", with its own specification
+static std::string format_argument(const std::string &field, const LogArgument &argument)
+{
+    return std::visit([&field](const auto &value)
+                      { return std::vformat(field, std::make_format_args(value)); },
+                      argument);
+}
+
+static std::string render(const std::string &format, const std::vector<LogArgument> &arguments)
+{
+    std::string text;
+    size_t next = 0;
+
+    for (size_t i = 0; i < format.size(); i++)
+    {
+        char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c)
+        {
+            text += c;
+            i++;
+            continue;
+        }
+        if (c != '{')
+        {
+            text += c;
+            continue;
+        }
+
+        size_t end = format.find('}', i);
+        if (end == std::string::npos)
+        {
+            text += format.substr(i);
+            break;
+        }
+
+        // Arguments are consumed in order, explicit indexes are not supported
+        size_t colon = format.find(':', i);
+        std::string field = colon < end ? "{" + format.substr(colon, end - colon) + "}" : "{}";
+        if (next < arguments.size())
+        {
+            try
+            {
+                text += format_argument(field, arguments[next]);
+            }
+            catch (const std::format_error &)
+            {
+                text += format_argument("{}", arguments[next]);
+            }
+        }
+        next++;
+        i = end;
+    }
+    return text;
+}
+
+static std::string format_timestamp(uint64_t ns)
+{
+    time_t seconds = static_cast<time_t>(ns / 1000000000);
+    struct tm tm_buf;
+    localtime_r(&seconds, &tm_buf);
+
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    char stamp[48];
+    snprintf(stamp, sizeof(stamp), "%s.%03d", date, static_cast<int>((ns / 1000000) % 1000));
+    return stamp;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log file>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << argv[1] << std::endl;
+        return 1;
+    }
+    Reader reader(std::vector<char>(std::istreambuf_iterator<char>(file), {}));
+
+    binlog_file_header header;
+    if (!reader.read(&header) || header.magic != BINLOG_MAGIC || header.version != BINLOG_VERSION)
+    {
+        std::cerr << argv[1] << " is not a binary log (version " << BINLOG_VERSION << ")" << std::endl;
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, LogSite> sites;
+    std::string out;
+    uint64_t unknown_records = 0;
+
+    // Lines of the current drain pass by timestamp; a pass writes one thread
+    // buffer after another, so they are sorted like the text async path does
+    std::vector<std::pair<uint64_t, std::string>> pass;
+    uint64_t last_timestamp = 0;
+    auto end_pass = [&pass, &out]()
+    {
+        std::stable_sort(pass.begin(), pass.end(), [](const auto &a, const auto &b)
+                         { return a.first < b.first; });
+        for (const auto &[timestamp, line] : pass)
+        {
+            out += line;
+        }
+        pass.clear();
+    };
+
+    while (!reader.done())
+    {
+        uint8_t kind;
+        reader.read(&kind);
+
+        if (kind == BINLOG_ENTRY_PAD)
+            continue;
+
+        if (kind == BINLOG_ENTRY_DRAIN)
+        {
+            end_pass();
+        }
+        else if (kind == BINLOG_ENTRY_SITE)
+        {
+            uint32_t id;
+            LogSite site;
+            uint8_t nargs;
+            uint16_t format_length, file_length;
+            if (!reader.read(&id) || !reader.read(&site.level) || !reader.read(&site.line) ||
+                !reader.read(&nargs) || !reader.read(&format_length) || !reader.read(&file_length) ||
+                !reader.read(&site.types, nargs) || !reader.read(&site.format, format_length) ||
+                !reader.read(&site.file, file_length))
+                break;
+            sites[id] = std::move(site);
+        }
+        else if (kind == BINLOG_ENTRY_RECORD)
+        {
+            uint32_t id;
+            uint32_t arg_bytes;
+            uint64_t timestamp;
+            if (!reader.read(&id) || !reader.read(&arg_bytes) || !reader.read(&timestamp))
+                break;
+
+            // The argument length lets the rest of the file be decoded without the site
+            auto it = sites.find(id);
+            if (it == sites.end())
+            {
+                if (!reader.skip(arg_bytes))
+                    break;
+                unknown_records++;
+                continue;
+            }
+            const LogSite &site = it->second;
+
+            std::vector<LogArgument> arguments;
+            bool complete = true;
+            for (char type : site.types)
+            {
+                if (type == 's')
+                {
+                    uint16_t length;
+                    std::string value;
+                    complete = reader.read(&length) && reader.read(&value, length);
+                    arguments.emplace_back(std::move(value));
+                }
+                else
+                {
+                    uint64_t raw;
+                    complete = reader.read(&raw);
+                    if (type == 'i')
+                        arguments.emplace_back(static_cast<int64_t>(raw));
+                    else if (type == 'd')
+                        arguments.emplace_back(std::bit_cast<double>(raw));
+                    else
+                        arguments.emplace_back(raw);
+                }
+                if (!complete)
+                    break;
+            }
+            if (!complete)
+                break;
+
+            std::string line = "[" + format_timestamp(timestamp) + "] [" +
+                               level_names[std::min<uint8_t>(site.level, 5)] + "] ";
+            line += render(site.format, arguments);
+            line += '\n';
+            pass.emplace_back(timestamp, std::move(line));
+            last_timestamp = timestamp;
+        }
+        else if (kind == BINLOG_ENTRY_DROPPED)
+        {
+            uint64_t dropped;
+            if (!reader.read(&dropped))
+                break;
+            // Follows the records of its thread buffer
+            pass.emplace_back(last_timestamp, "[" + std::to_string(dropped) + " records dropped]\n");
+        }
+        else
+        {
+            std::cerr << "Unknown entry type " << static_cast<int>(kind) << ", stopping" << std::endl;
+            break;
+        }
+
+        if (out.size() > 64 * 1024)
+        {
+            std::cout << out;
+            out.clear();
+        }
+    }
+
+    end_pass(); // A file cut short has no marker after its last pass
+    std::cout << out;
+    if (unknown_records > 0)
+    {
+        std::cerr << "Skipped " << unknown_records << " records with an unknown site" << std::endl;
+    }
+    return 0;
+}
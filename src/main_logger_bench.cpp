@@ -0,0 +1,71 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include "Logger.hpp"
+
+// Cost per LOG_DEBUG statement when the level is disabled and when it is
+// written as text (sync and async) or in binary mode
+
+template <typename Body>
+static double nsPerCall(long iterations, Body body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        body(i);
+    }
+    Logger::flush();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static void report(const std::string &name, double ns)
+{
+    std::printf("%-24s %10.1f ns/call\n", name.c_str(), ns);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+    std::string textPath = argc > 2 ? argv[2] : "/tmp/logger-bench.log";
+    std::string binaryPath = textPath + ".bin";
+    if (iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [iterations] [log file]" << std::endl;
+        return 1;
+    }
+
+    Logger::enableConsoleOutput(false);
+    Logger::enableFileOutput(true, textPath);
+    std::string pod = "pod-0123456789abcdef";
+
+    auto statement = [&pod](long i)
+    { LOG_DEBUG("Processed event {} for {} with latency {:.2f}us", i, pod, i * 0.5); };
+
+    Logger::setLogLevel(LogLevel::INFO);
+    report("disabled", nsPerCall(iterations, statement));
+
+    Logger::setLogLevel(LogLevel::DEBUG);
+    report("enabled, text", nsPerCall(iterations, statement));
+
+    Logger::enableAsync(true);
+    report("enabled, async text", nsPerCall(iterations, statement));
+    Logger::enableAsync(false);
+
+    if (Logger::enableBinaryOutput(binaryPath))
+    {
+        report("enabled, binary", nsPerCall(iterations, statement));
+        Logger::enableBinaryOutput("");
+    }
+    else
+    {
+        std::cerr << "Binary output unavailable: " << binaryPath << std::endl;
+    }
+
+    Logger::enableFileOutput(false);
+    std::remove(textPath.c_str());
+    std::remove(binaryPath.c_str());
+    return 0;
+}
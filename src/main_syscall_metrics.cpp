@@ -1,9 +1,13 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstdlib>
+#include "BpfLoader.hpp"
 #include "BpfSyscallFrequencyReader.hpp"
 #include "Logger.hpp"
 #include "InfluxClient.hpp"
+#include "MetricSink.hpp"
+#include "MetricBatcher.hpp"
 
 int main()
 {
@@ -21,48 +25,96 @@ int main()
         return 1;
     }
 
+    // Metric sinks: comma separated influx, stdout, file:<path>, prometheus[:<port>]
+    MetricFanout sinks;
+    const char *sinkSpec = std::getenv("SYSCALL_METRICS_SINKS");
+    if (!add_sinks_from_spec(sinks, sinkSpec ? sinkSpec : "influx", influxClient) || sinks.empty())
+    {
+        Logger::error("Invalid SYSCALL_METRICS_SINKS");
+        return 1;
+    }
+    sinks.start();
+
+    // Samples are aggregates, every sink takes them; several samples share one write.
+    // SYSCALL_METRICS_MAX_DELAY_MS bounds how long a sample waits (default 10000)
+    long maxDelayMs = 10000;
+    if (const char *value = std::getenv("SYSCALL_METRICS_MAX_DELAY_MS"))
+        maxDelayMs = std::stol(value);
+    MetricBatcher batcher(sinks, true, METRIC_BATCHER_DEFAULT_MAX_LINES, METRIC_BATCHER_DEFAULT_MAX_BYTES,
+                          std::chrono::milliseconds(maxDelayMs));
+    batcher.start();
+
     try
     {
-        BpfSyscallFrequencyReader bpfReader;
+        // Load and attach the embedded syscall frequency probe
+        BpfLoader bpfLoader;
+        if (!bpfLoader.load(BPF_PROBE_SYSCALL_FREQUENCY))
+        {
+            Logger::error("Failed to load syscall frequency probe");
+            return 1;
+        }
+
+        BpfSyscallFrequencyReader bpfReader(bpfLoader.syscall_counts_fd(),
+                                            bpfLoader.cgroup_syscall_counts_fd(),
+                                            bpfLoader.syscall_counts_config_fd());
+
+        // Optional per-cgroup breakdown of the counters
+        bool perCgroup = std::getenv("SYSCALL_METRICS_PER_CGROUP") != nullptr;
+        if (perCgroup && !bpfReader.enablePerCgroup(true))
+        {
+            Logger::warn("Per-cgroup syscall counting unavailable");
+            perCgroup = false;
+        }
 
         Logger::info("Starting eBPF syscall monitor. Press Ctrl+C to stop.");
 
         while (true)
         {
-            auto data = bpfReader.readAll();
+            auto data = bpfReader.sample();
 
             Logger::info("=== Syscall Counts ===");
-            for (const auto &[key, count] : data)
+            double totalRate = 0.0;
+            for (const auto &[key, freq] : data)
             {
                 std::string syscall_name = bpfReader.getSyscallName(key);
-                Logger::info(std::format("{:12}: {}", syscall_name, count));
+                LOG_DEBUG("{:12}: {} ({:.1f}/s)", syscall_name, freq.count, freq.rate_per_sec);
+                totalRate += freq.rate_per_sec;
             }
+            Logger::info(std::format("{} syscalls seen, {:.1f} calls/s", data.size(), totalRate));
             Logger::info("=====================");
 
             // Store in time series for later analysis
-            for (const auto &[key, count] : data)
+            for (const auto &[key, freq] : data)
             {
-                Logger::addTimeSeriesData(
-                    bpfReader.getSyscallName(key),
-                    std::to_string(count));
+                Logger::addTimeSeriesData(bpfReader.getSyscallName(key), static_cast<double>(freq.count));
             }
 
-            // Write to InfluxDB
+            // Export the sample, timestamped since it may share a write with later ones
+            uint64_t timestamp = influxClient.timestamp(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count()));
             std::vector<std::string> lines;
-            for (const auto &[key, count] : data)
+            for (const auto &[key, freq] : data)
             {
                 std::string syscall_name = bpfReader.getSyscallName(key);
-                std::string line = std::format("syscall_counts,syscall={} count={}", syscall_name, count);
+                std::string line = std::format("syscall_counts,syscall={} count={},rate={} {}",
+                                               syscall_name, freq.count, freq.rate_per_sec, timestamp);
                 lines.push_back(line);
             }
-            if (influxClient.writeBatch(lines))
-            {
-                Logger::info("Successfully wrote syscall counts to InfluxDB");
-            }
-            else
+
+            if (perCgroup)
             {
-                Logger::error("Failed to write syscall counts to InfluxDB");
+                for (const auto &[cgroup_id, counts] : bpfReader.readPerCgroup())
+                {
+                    for (const auto &[key, count] : counts)
+                    {
+                        lines.push_back(std::format("syscall_counts_cgroup,cgroup_id={},syscall={} count={} {}",
+                                                    cgroup_id, bpfReader.getSyscallName(key), count, timestamp));
+                    }
+                }
             }
+            batcher.add(std::move(lines));
             std::this_thread::sleep_for(std::chrono::seconds(2));
         }
     }